@@ -142,7 +142,7 @@ void Action(void)
 {
   char sz[cchSzMax];
   int cSequenceLine = us.cSequenceLine, iList, iList2, iLine, i;
-  flag fDoList, fHTML, fHTMLClip;
+  flag fDoList, fHTML, fHTMLClip, fCacheOff = fFalse;
 
   // If the -os switch is in effect, open a file and set a global to
   // internally 'redirect' all screen output to.
@@ -153,7 +153,8 @@ void Action(void)
       sprintf(sz, "File %s can not be created.", is.szFileScreen);
       PrintError(sz);
       is.S = stdout;
-    }
+    } else
+      setvbuf(is.S, NULL, _IOFBF, cchSzOut);
   } else
     is.S = stdout;
   is.cchRow = is.cchCol = is.cchColMax = 0;
@@ -187,6 +188,21 @@ void Action(void)
   fDoList = (us.nListAll > 0 && !us.fGraphics && is.cci > 0 &&
     !(us.nListAll == 3 && is.cci < 2));
   iList = (us.nListAll == 3); iList2 = 0;
+
+  // When looping over pairs of charts, make the cast cache big enough to
+  // hold every chart in the list in each of the two chart slots, so each
+  // chart is only cast once per slot. Each entry is a full set of chart
+  // positions, so the cache is limited to cbCastList bytes. Pairs are gone
+  // through in order, so if the list doesn't fit, charts would always be
+  // replaced before being used again, and the cache is turned off instead.
+  if (fDoList && us.nListAll >= 3) {
+    if (is.cci*2 <= cceListMax)
+      FSizeCastCache(is.cci*2 + cceMax);
+    else if (is.cce >= 0) {
+      is.cce = -1;
+      fCacheOff = fTrue;
+    }
+  }
 LNextList:
   if (fDoList) {
     is.iciIndex1 = iList; is.iciIndex2 = iList2;
@@ -319,6 +335,10 @@ LDone:
       goto LNextList;
     }
     is.iciIndex1 = is.iciIndex2 = -1;
+    if (fCacheOff)
+      is.cce = 0;
+    if (us.nListAll >= 3)
+      FSizeCastCache(cceMax);
   }
 
   if (fHTML) {           // If -kh switch in effect, end the HTML file.
@@ -813,6 +833,12 @@ int NProcessSwitchesRare(int argc, char **argv, int pos,
       FCloneSz(argv[1], &us.szExoList);
       darg++;
       break;
+#ifdef SWISS
+    } else if (ch1 == 'c') {
+      if (!FSwissCompileStars())
+        return tcError;
+      break;
+#endif
     }
     if (FErrorArgc("YU", argc, 2))
       return tcError;
@@ -1202,6 +1228,20 @@ int NProcessSwitchesRare(int argc, char **argv, int pos,
     SwitchF(us.fNoDisplay);
     break;
 
+  case 'N':
+    SwitchF(us.fSearchRefine);
+    break;
+
+  case 'x':
+    if (FErrorArgc("Yx", argc, 1))
+      return tcError;
+    i = NFromSz(argv[1]);
+    if (FErrorValN("Yx", !FBetween(i, 0, MAXTHREADS), i, 0))
+      return tcError;
+    us.nThread = i;
+    darg++;
+    break;
+
   case '5':
     if (ch1 == 'i') {
       if (FErrorArgc("Y5i", argc, 1))
@@ -1249,6 +1289,11 @@ int NProcessSwitchesRare(int argc, char **argv, int pos,
     }
 #endif
 #ifdef ATLAS
+    else if (ch1 == 'c') {
+      if (!FAtlasCompileSnapshot())
+        return tcError;
+      break;
+    }
     i = ch1 - '0';
     if (FErrorArgc("YY", argc, 1 + (i == 1 || i == 2)))
       return tcError;
@@ -1298,6 +1343,11 @@ flag FProcessSwitches(int argc, char **argv)
   char **ppch;
 #endif
 
+  // Switches may change state which charts are cast with, so any charts in
+  // the cast cache may no longer be valid.
+  if (is.cce > 0)
+    is.cce = 0;
+
   argc--; argv++;
   while (argc) {
     ch1 = argv[0][0];
@@ -2045,7 +2095,7 @@ flag FProcessSwitches(int argc, char **argv)
           return fFalse;
         if (!DisplayAtlasLookup(argv[1], 0, &i))
           PrintWarning("City doesn't match anything in atlas.");
-        else if (!DisplayTimezoneChanges(is.rgae[i].izn, 0, &ciCore))
+        else if (!FZoneDstFromIzn(&ciCore, is.rgae[i].izn, fTrue))
           PrintWarning("Couldn't get time zone data!");
         else {
           ciDefa.dst = SS; ciDefa.zon = ZZ;
@@ -3255,12 +3305,17 @@ void FinalizeProgram(flag fSkip)
     DeallocatePIf(szStarCustom[i]);
   for (i = 0; i <= cRing; i++)
     DeallocatePIf(szWheel[i]);
+  DeallocatePIf(is.rgce);
+  DeallocatePIf(is.rglce);
 #ifdef ATLAS
   DeallocatePIf(is.rgae);
+  DeallocatePIf(is.rgnAtlIndex);
+  DeallocatePIf(is.rgnAtlGrid);
   DeallocatePIf(is.rgzc);
   DeallocatePIf(is.rgrun);
   DeallocatePIf(is.rgrue);
   DeallocatePIf(is.rgzonCol);
+  FreeZoneTables();
 #endif
 #ifdef INTERPRET
   for (i = 0; i < objMax; i++)
@@ -3347,6 +3402,7 @@ void FinalizeProgram(flag fSkip)
   DeallocatePIf(gi.bmpRising.rgb);
   DeallocatePIf(gi.rgspace);
   DeallocatePIf(gi.rgConstel);
+  DeallocatePIf(gi.rgfProj);
   DeallocatePIf(gi.szFileOut);
   DeallocatePIf(gs.szSidebar);
   for (i = 0; i <= cRing; i++)
@@ -3368,6 +3424,7 @@ void FinalizeProgram(flag fSkip)
   DeallocatePIf(gs.szStarsLin);
   DeallocatePIf(gs.szStarsLnk);
   DeallocatePIf(is.rgesSort);
+  DeallocatePIf(is.rgxxStar);
 #endif
 #endif // GRAPH
 #ifdef X11
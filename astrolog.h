@@ -90,6 +90,14 @@
 #define ENVIRON /* Comment out this #define if your system doesn't have  */
                 /* environment variables or can't compile calls to them. */
 
+#define THREADS /* Comment out this #define if your compiler can't declare */
+                /* thread local variables, or your system can't run more   */
+                /* than one thread at a time within the same program.      */
+
+#define MMAP /* Comment out this #define if your system can't map files */
+             /* into memory, which is used to read ephemeris files more */
+             /* quickly than reading them a few bytes at a time.        */
+
 //#define ATOF /* Comment out this #define if you have a system in which  */
              /* 'atof' and related functions aren't defined in stdio.h, */
              /* such as most PC's, Linux, VMS compilers, and NeXT's.    */
@@ -232,10 +240,12 @@
 #define SCREENWIDTH 80  // Number of columns to print interpretations in.
 #define MONTHSPACE 3    // Number of spaces between each calendar column.
 #define MAXINDAY 300    // Max number of aspects or transits displayable.
+#define INDAYCHUNK 75   // Number of -d events printed at a time when streaming.
 #define MAXCROSS 750    // Max number of latitude crossings displayable.
 #define BIODAYS 14      // Days to include in graphic biorhythms.
 #define CREDITWIDTH 74  // Number of text columns in the -Hc credit screen.
 #define MAXSWITCHES 100 // Max number of switch parameters per input line.
+#define MAXTHREADS 64   // Max number of threads to search for events with.
 #define PSGUTTER 9      // Points of white space on PostScript page edge.
 
 #ifdef GRAPH            // For graphics, this char affects how bitmaps are
@@ -364,6 +374,18 @@
 #define INLINE inline
 #endif // PC
 
+#ifdef THREADS
+#ifdef PC
+#define TLOCAL __declspec(thread)
+#else
+#define TLOCAL __thread
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#else
+#define TLOCAL
+#endif // THREADS
+
 #ifdef PS
 #define VECTOR
 #endif
@@ -505,6 +527,13 @@
 #define cchSzDef  80
 #define cchSzMax  255
 #define cchSzLine (cchSzMax*4)
+#define cchSzOut  65536
+#define cceMax    16
+#define cbCastList 0x2000000
+#define cceListMax ((int)(cbCastList / sizeof(CE)))
+#define cciPrecast 256
+#define cbOutBuf  32768
+#define lHashInit 2166136261UL
 #define dwCanary  0x87654321
 #define nDegMax   360
 #define nDegHalf  180
@@ -547,6 +576,8 @@
 #define rPCToAU    206264.8062471
 #define rDayInYear 365.24219
 #define rEarthDist 149.59787
+#define rEarthRad  6378136.6
+#define rEarthFlat (1.0/298.25642)
 #define rEpoch2000 -24.736467
 #define rJD2000    2451545.0
 #define rAxis      23.44578889
@@ -1573,6 +1604,13 @@ typedef struct _TransInfo {
   real retT;     // Transiting planet's zodiac position velocity
 } TransInfo;
 
+typedef struct _EventList {
+  pbyte rgev;    // Array of events, which grows as events are added
+  int cbev;      // Size in bytes of each event
+  int cev;       // Number of events in the list
+  int cevMax;    // Number of events there's currently room for
+} EL;
+
 typedef struct _ExoplanetData {
   char *sz;      // The name of the exoplanet
   real ra;       // RA of exoplanet's location
@@ -1624,6 +1662,31 @@ typedef struct _TimezoneRuleEntry {
   int dst;       // Rule applies this Daylight offset (in seconds before UTC)
 } RuleEntry;
 
+typedef struct _TimezoneClock {
+  int mon;   // Month clocks change
+  int day;   // Day clocks change
+  int yea;   // Year clocks change
+  int tim;   // Local time clocks change (in seconds)
+  int dst;   // Daylight offset after change (in seconds)
+  int zon;   // Time zone value after change (in seconds before UTC)
+  int off;   // Total offset after change (zone minus Daylight)
+  int doff;  // Amount clocks change by (in seconds)
+} ZoneClock;
+
+typedef struct _TimezoneTransition {
+  ZoneClock zc;      // State of clocks after transition
+  ZoneClock zcPrev;  // State of clocks before transition
+  int yeaRule;       // Year of rule that transition is from, if any
+} ZoneTrans;
+
+typedef struct _TimezoneTable {
+  ZoneTrans *rgzt;  // List of transitions in order by local time
+  int czt;          // Number of transitions in list
+  flag fSorted;     // Whether transitions are strictly in order
+  int dst;          // Daylight offset after last transition
+  int zon;          // Time zone value after last transition
+} ZoneTable;
+
 typedef struct _ChartInfo {
   int mon;    // Month
   int day;    // Day
@@ -1829,6 +1892,7 @@ typedef struct _UserSettings {
   flag fNoNetwork;     // -0n
   flag fNoExp;         // -0~
   flag fExpOff;        // -~0
+  flag fSearchRefine;  // -YN
 
   // Value settings
   int   nDecanType;    // -v3
@@ -1892,6 +1956,7 @@ typedef struct _UserSettings {
   int   nSignDiv;          // -YRd
   int   iExpADB;           // -~5i
   int   cExpADB;           // -~5i
+  int   nThread;           // -Yx
 
   // AstroExpression hooks
   char *szExpConfig;   // -~g
@@ -1989,9 +2054,14 @@ typedef struct _InternalSettings {
   int cexod;           // Number of exoplanet transit stars loaded from file.
   int cszMacro;        // Number of command switch macro strings in list.
   int cesSort;         // Number of extra star structures in sorted list.
+  int cxxStar;         // Number of extra stars in star position list.
   int cAlloc;          // Number of memory allocations currently allocated.
   int cAllocTotal;     // Total memory allocations allocated this session.
   int cbAllocSize;     // Total bytes in all memory allocations allocated.
+  int cce;             // Number of charts in cast cache, or -1 if disabled.
+  int cceAlloc;        // Number of charts the cast cache can hold.
+  int cCastHit;        // Number of chart casts found in the cast cache.
+  int cCastMiss;       // Number of chart casts not found in the cast cache.
   real rOff;           // Offset between sidereal and tropical zodiacs.
   real rSid;           // Sidereal offset degrees to be added to locations.
   real JD;             // Fractional Julian day for current chart.
@@ -2002,10 +2072,16 @@ typedef struct _InternalSettings {
   RuleName *rgrun;     // List of Daylight Saving change rule names.
   RuleEntry *rgrue;    // List of all Daylight Saving change rule entries.
   real *rgzonCol;      // Cache of time zone offsets for each zone area.
+  ZoneTable *rgztb;    // Compiled time zone transitions for zone areas.
   CI *rgci;            // List of chart information records for chart list.
   ExoData *rgexod;     // List of exoplanet transit stars loaded from file.
   char **rgszMacro;    // List of command switch macro strings.
   ES *rgesSort;        // List of sorted extra stars or extra asteroids.
+  real *rgxxStar;      // List of extra star positions computed at once.
+  int *rgnAtlIndex;    // Trigram index of city names in atlas entries.
+  int *rgnAtlGrid;     // Grid index of atlas entries by location.
+  struct _CastEntry *rgce;  // Cache of recently cast charts and results.
+  dword *rglce;        // Keys of charts in cast cache, for quick lookup.
   FILE *fileIn;        // The switch file currently being read from.
   FILE *S;             // File to write text to.
   real T;              // Julian time for chart.
@@ -2020,6 +2096,41 @@ typedef struct _InternalSettings {
   real rNut;           // Nutation offset.
 } IS;
 
+typedef struct _ChartContext {
+  CI ci;                // Chart information to cast
+  CI ciMain;            // Main chart, whose latitude 3D houses are based on
+  US us;                // User settings to cast the chart with
+  IS is;                // Internal settings to cast the chart with
+  byte ignore[objMax];  // Object restrictions to cast the chart with
+  real force[objMax];   // Forced object positions to cast the chart with
+  CP cp;                // Chart positions to start out with
+} CC;
+
+typedef struct _CastEntry {
+  dword lHash;          // Hash of settings the chart was cast with
+  CI ci;                // Chart information that was cast
+  real JDp;             // Progression time the chart was cast with
+  flag fDst;            // Autodetected Daylight setting cast with
+  real latMain;         // Latitude of main chart when the chart was cast
+  US us;                // Settings the chart was cast with
+  byte ignore[objMax];  // Restrictions the chart was cast with
+  real force[objMax];   // Forced positions the chart was cast with
+  IS is;                // Internal settings, updated by casting the chart
+  CP cp;                // The resulting chart positions
+  int rgobjList[objMax], rgobjList2[objMax], kObjA[objMax];
+  real rStarBright[cStar+1];
+} CE;
+
+typedef struct _SolarShadow {
+  PT3R ptSun;           // Sun as seen from the center of the Earth
+  PT3R ptMoo;           // Moon as seen from the center of the Earth
+  PT3R rgpt[3];         // Shift of both per Earth radius along each axis
+  real rElv;            // Elevation of locations in Earth radii
+  real radiS, radiM;    // Radius of the Sun and Moon in km
+} SH;
+
+typedef void (*PFNJOB)(void *, int);  // Job run by RunJobs()
+
 #ifdef GRAPH
 typedef struct _Bitmap {
   int x;      // Horizontal pixel size of bitmap
@@ -2081,6 +2192,7 @@ typedef struct _GraphicsSettings {
   real rTilt;        // Current vertical tilt of rotating globe (-XG).
   int objTrack;      // Object being telescope tracked, if any (-XZ).
   char chBmpMode;    // Current bitmap file type (-Xb).
+  int nPngLevel;     // Compression level of PNG bitmap files (-YXz).
   real rBackPct;     // Background image transparency percentage (-XI).
   int nBackOrient;   // Background image wallpaper orientation (-XI).
   int nOrient;       // PostScript paper orientation indicator (-YXp).
@@ -2156,6 +2268,14 @@ typedef struct _GraphicsInternal {
   Bitmap bmpBack2;    // Bitmap storing background, at current transparency.
   Bitmap bmpWorld;    // Bitmap storing world map, as loaded from file.
   Bitmap bmpRising;   // Bitmap storing rising chart, as drawn within it.
+  float *rgfProj;     // Earth coordinates of each pixel in globe bitmap.
+  int nModeProj;      // Chart type, window size, and settings it's for.
+  int xProj;
+  int yProj;
+  real rTiltProj;
+  flag fSouthProj;
+  byte rgbOut[cbOutBuf]; // Bytes waiting to be written to graphics file.
+  int ibOut;          // Number of bytes in output buffer so far.
 #ifdef SWISS
   ES *rges;           // List of extra star coordinates (-YXU).
   int cStarsLin;      // Count of extra star coordinates (-YXU).
@@ -880,6 +880,8 @@ flag FEnsureAtlas()
 {
   if (is.rgae != NULL)
     return fTrue;
+  if (FLoadAtlasSnapshot())
+    return fTrue;
   if (!FProcessSwitchFile(DEFAULT_ATLASFILE, NULL))
     return fFalse;
   return is.rgae != NULL;
@@ -894,6 +896,8 @@ flag FEnsureTimezoneChanges()
 {
   if (is.rgzc != NULL && is.rgrun != NULL && is.rgrue != NULL)
     return fTrue;
+  if (FLoadZoneSnapshot())
+    return fTrue;
   if (!FProcessSwitchFile(DEFAULT_TIMECHANGE, NULL))
     return fFalse;
   return is.rgzc != NULL && is.rgrun != NULL && is.rgrue != NULL;
@@ -931,6 +935,14 @@ flag FLoadAtlas(FILE *file, int cae)
     DeallocateP(is.rgae);
     is.rgae = NULL;
   }
+  if (is.rgnAtlIndex != NULL) {
+    DeallocateP(is.rgnAtlIndex);
+    is.rgnAtlIndex = NULL;
+  }
+  if (is.rgnAtlGrid != NULL) {
+    DeallocateP(is.rgnAtlGrid);
+    is.rgnAtlGrid = NULL;
+  }
   is.rgae = RgAllocate(cae, AtlasEntry, "atlas");
   if (is.rgae == NULL)
     return fFalse;
@@ -1013,6 +1025,149 @@ flag FLoadAtlas(FILE *file, int cae)
 }
 
 
+#define cgramAtl 65521  // Number of slots in trigram index of city names
+
+// Return the slot in the atlas index for the three characters at the start
+// of a string. Letters are folded to upper case so lookups ignore case.
+
+int IgramAtl(CONST char *pch)
+{
+  return (int)((((dword)(uchar)ChCap(pch[0]) << 16) |
+    ((dword)(uchar)ChCap(pch[1]) << 8) | (uchar)ChCap(pch[2])) % cgramAtl);
+}
+
+
+// Create the atlas index if it hasn't been created yet. This is a trigram
+// index of city names: For every three character sequence, a list of where
+// it occurs in city names, so cities containing a substring can be found
+// without checking all of them. The first cgramAtl+1 entries are offsets to
+// the start of each slot's list, followed by the lists themselves, with each
+// place encoded as city index * cchSzAtl plus character offset in the name.
+
+flag FEnsureAtlasIndex()
+{
+  int *rgn, cpos = 0, iae, ich, igram;
+  CONST char *sz;
+
+  if (is.rgnAtlIndex != NULL)
+    return fTrue;
+  if (is.cae <= 0)
+    return fFalse;
+  for (iae = 0; iae < is.cae; iae++)
+    cpos += Max(CchSz(is.rgae[iae].szNam) - 2, 0);
+  rgn = RgAllocate(cgramAtl + 1 + cpos, int, "atlas index");
+  if (rgn == NULL)
+    return fFalse;
+
+  // Count places in each slot, then fill in each slot in order by city.
+  ClearB((pbyte)rgn, (cgramAtl + 1) * sizeof(int));
+  for (iae = 0; iae < is.cae; iae++) {
+    sz = is.rgae[iae].szNam;
+    for (ich = 0; sz[ich] && sz[ich+1] && sz[ich+2]; ich++)
+      rgn[IgramAtl(&sz[ich]) + 1]++;
+  }
+  for (igram = 0; igram < cgramAtl; igram++)
+    rgn[igram + 1] += rgn[igram];
+  for (iae = 0; iae < is.cae; iae++) {
+    sz = is.rgae[iae].szNam;
+    for (ich = 0; sz[ich] && sz[ich+1] && sz[ich+2]; ich++)
+      rgn[cgramAtl + 1 + rgn[IgramAtl(&sz[ich])]++] = iae * cchSzAtl + ich;
+  }
+  // Filling in moved each offset to the next slot's start, so shift back.
+  for (igram = cgramAtl; igram > 0; igram--)
+    rgn[igram] = rgn[igram - 1];
+  rgn[0] = 0;
+  is.rgnAtlIndex = rgn;
+  return fTrue;
+}
+
+
+// Look up a string at least three characters long in the atlas index.
+// Return the number of places in city names where it might start, setting
+// *prgpos to the list of them, and *pich to the offset within the string
+// that those places correspond to. Places still need to be checked, since
+// different trigrams may share a slot, but they're in order by city.
+
+int CposLookupAtlas(CONST char *sz, int **prgpos, int *pich)
+{
+  int ich, igram, cpos, cposMin = -1;
+
+  // Use whichever trigram within the string occurs the least often.
+  for (ich = 0; sz[ich] && sz[ich+1] && sz[ich+2]; ich++) {
+    igram = IgramAtl(&sz[ich]);
+    cpos = is.rgnAtlIndex[igram + 1] - is.rgnAtlIndex[igram];
+    if (cposMin < 0 || cpos < cposMin) {
+      cposMin = cpos;
+      *prgpos = &is.rgnAtlIndex[cgramAtl + 1 + is.rgnAtlIndex[igram]];
+      *pich = ich;
+    }
+  }
+  return Max(cposMin, 0);
+}
+
+
+#define cgridLat 90    // Number of latitude bands in atlas location grid
+#define cgridLon 180   // Number of longitude cells in each band
+#define rGridAtl (rDegMax / (real)cgridLon)  // Degree size of each grid cell
+
+// Return the latitude band or longitude column in the atlas grid that a
+// coordinate falls within. Columns wrap around, while bands are clamped.
+
+int YgridAtl(real lat)
+{
+  int y = (int)RFloor((lat + rDegQuad) / rGridAtl);
+  return Min(Max(y, 0), cgridLat-1);
+}
+
+int XgridAtl(real lon)
+{
+  return (int)RFloor((lon + rDegHalf) / rGridAtl);
+}
+
+
+// Create the atlas grid if it hasn't been created yet. This divides the
+// globe into cells a couple degrees on a side, with a list of the cities
+// located in each, so cities near a location can be found without checking
+// all of them. The first cgridLat*cgridLon+1 entries are offsets to the
+// start of each cell's list, followed by the lists of city indexes.
+
+flag FEnsureAtlasGrid()
+{
+  int *rgn, iae, igrid, x;
+
+  if (is.rgnAtlGrid != NULL)
+    return fTrue;
+  if (is.cae <= 0)
+    return fFalse;
+  rgn = RgAllocate(cgridLat*cgridLon + 1 + is.cae, int, "atlas grid");
+  if (rgn == NULL)
+    return fFalse;
+
+  // Count cities in each cell, then fill in each cell in order by city.
+  ClearB((pbyte)rgn, (cgridLat*cgridLon + 1) * sizeof(int));
+  for (iae = 0; iae < is.cae; iae++) {
+    x = XgridAtl(is.rgae[iae].lon);
+    igrid = YgridAtl(is.rgae[iae].lat)*cgridLon +
+      (x % cgridLon + cgridLon) % cgridLon;
+    rgn[igrid + 1]++;
+  }
+  for (igrid = 0; igrid < cgridLat*cgridLon; igrid++)
+    rgn[igrid + 1] += rgn[igrid];
+  for (iae = 0; iae < is.cae; iae++) {
+    x = XgridAtl(is.rgae[iae].lon);
+    igrid = YgridAtl(is.rgae[iae].lat)*cgridLon +
+      (x % cgridLon + cgridLon) % cgridLon;
+    rgn[cgridLat*cgridLon + 1 + rgn[igrid]++] = iae;
+  }
+  // Filling in moved each offset to the next cell's start, so shift back.
+  for (igrid = cgridLat*cgridLon; igrid > 0; igrid--)
+    rgn[igrid] = rgn[igrid - 1];
+  rgn[0] = 0;
+  is.rgnAtlGrid = rgn;
+  return fTrue;
+}
+
+
 // Parse an Hours:Minutes:Seconds (HMS) time value, returning the total
 // number of seconds. For example, -12hr 30min 15sec or "-12:30:15" maps to
 // -(12 hr*60*60 + 30 min*60 + 15 sec) = 45015 seconds total.
@@ -1057,6 +1212,7 @@ flag FLoadZoneRules(FILE *file, int irunMax, int irueMax)
 
   // Free previous rule lists if present, and allocate new lists.
   is.crun = is.crue = 0;
+  FreeZoneTables();
   if (is.rgrun != NULL) {
     DeallocateP(is.rgrun);
     is.rgrun = NULL;
@@ -1231,6 +1387,7 @@ flag FLoadZoneChanges(FILE *file, int izcnMax, int izceMax)
 
   // Free previous zone change entry list if present, and allocate new list.
   is.czcn = is.czce = 0;
+  FreeZoneTables();
   if (is.rgzc != NULL) {
     DeallocateP(is.rgzc);
     is.rgzc = NULL;
@@ -1476,6 +1633,297 @@ flag FLoadZoneLinks(FILE *file, int czl)
 }
 
 
+// Atlas and time zone data can also be loaded from binary snapshots, which
+// are the arrays and indexes the text files get parsed into, saved to disk
+// with -YYc next to the text files they're from. Snapshots are only used if
+// they were made by a compatible build from the exact same text file.
+
+#define szAtlasBinMagic "AstAtlas"
+#define szZoneBinMagic  "AstZones"
+#define nBinEndian  0x01020304
+#define nBinVersion 800
+#define cbinHdr     16
+
+enum _binheader {
+  ibinEndian = 0,  // Byte order marker, to check file from same platform
+  ibinVersion,     // Snapshot format version
+  ibinText,        // Length of text file the snapshot was made from
+  ibinHash,        // Hash of contents of text file
+  ibinIzn,         // Number of time zone areas the snapshot assumes
+  ibinSize1,       // Sizes of the structures in the snapshot
+  ibinSize2,
+  ibinSize3,
+  ibinCount1,      // Number of entries in each array in the snapshot
+  ibinCount2,
+  ibinCount3,
+  ibinCount4,
+};
+
+
+// Given an atlas or time zone text file, determine the path of its binary
+// snapshot, along with the length and a hash of the text file's contents.
+// Return whether the text file could be found and read.
+
+flag FGetSnapshotInfo(CONST char *szText, char *szBin, int *pcb, int *pnHash)
+{
+  char szPath[cchSzMax];
+  byte rgb[4096];
+  FILE *file;
+  dword lHash = lHashInit;
+  int cb = 0, cbRead, i;
+
+  if (FileOpen(szText, 0, szPath) == NULL)
+    return fFalse;
+  i = CchSz(szPath);
+  if (i >= 3 && FEqSzI(&szPath[i-3], ".as"))
+    i -= 3;
+  sprintf(szBin, "%.*s.bin", i, szPath);
+
+  // Compute FNV-1a hash of text file's bytes.
+  file = fopen(szPath, "rb");
+  if (file == NULL)
+    return fFalse;
+  while ((cbRead = (int)fread(rgb, 1, sizeof(rgb), file)) > 0) {
+    lHash = LHashRgb(rgb, cbRead, lHash);
+    cb += cbRead;
+  }
+  fclose(file);
+  *pcb = cb;
+  *pnHash = (int)lHash;
+  return fTrue;
+}
+
+
+// Open a binary snapshot and read its header, checking that it matches a
+// text file and this build. Return the open file positioned after the
+// header, or NULL if the snapshot is missing or out of date.
+
+FILE *FileOpenSnapshot(CONST char *szText, CONST char *szMagic, int *rgn)
+{
+  char szBin[cchSzMax], rgch[9];
+  FILE *file;
+  int cb, nHash;
+
+  if (!FGetSnapshotInfo(szText, szBin, &cb, &nHash))
+    return NULL;
+  file = fopen(szBin, "rb");
+  if (file == NULL)
+    return NULL;
+  rgch[8] = chNull;
+  if (fread(rgch, 1, 8, file) != 8 || !FEqSz(rgch, szMagic) ||
+    fread(rgn, sizeof(int), cbinHdr, file) != cbinHdr ||
+    rgn[ibinEndian] != nBinEndian || rgn[ibinVersion] != nBinVersion ||
+    rgn[ibinText] != cb || rgn[ibinHash] != nHash ||
+    rgn[ibinIzn] != iznMax) {
+    fclose(file);
+    return NULL;
+  }
+  return file;
+}
+
+
+// Allocate an array and read its contents from a binary snapshot.
+
+pbyte PReadSnapshot(FILE *file, int cb, CONST char *szType)
+{
+  pbyte pb;
+
+  pb = PAllocate(Max(cb, 1), szType);
+  if (pb == NULL)
+    return NULL;
+  if ((int)fread(pb, 1, cb, file) != cb) {
+    DeallocateP(pb);
+    return NULL;
+  }
+  return pb;
+}
+
+
+// Load the atlas city list and its indexes from the atlas binary snapshot.
+// Return whether the snapshot was present and valid.
+
+flag FLoadAtlasSnapshot()
+{
+  int rgn[cbinHdr], cae, cIndex;
+  AtlasEntry *rgae;
+  int *rgnIndex, *rgnGrid;
+  FILE *file;
+
+  file = FileOpenSnapshot(DEFAULT_ATLASFILE, szAtlasBinMagic, rgn);
+  if (file == NULL)
+    return fFalse;
+  cae = rgn[ibinCount1]; cIndex = rgn[ibinCount2];
+  if (rgn[ibinSize1] != sizeof(AtlasEntry) || rgn[ibinSize2] != cgramAtl ||
+    rgn[ibinSize3] != cchSzAtl ||
+    rgn[ibinCount3] != cgridLat*cgridLon + 1 + cae) {
+    fclose(file);
+    return fFalse;
+  }
+  rgae = (AtlasEntry *)PReadSnapshot(file, cae * sizeof(AtlasEntry),
+    "atlas");
+  rgnIndex = rgae == NULL ? NULL :
+    (int *)PReadSnapshot(file, cIndex * sizeof(int), "atlas index");
+  rgnGrid = rgnIndex == NULL ? NULL :
+    (int *)PReadSnapshot(file, rgn[ibinCount3] * sizeof(int), "atlas grid");
+  fclose(file);
+  if (rgnGrid == NULL) {
+    DeallocatePIf(rgae);
+    DeallocatePIf(rgnIndex);
+    return fFalse;
+  }
+
+  DeallocatePIf(is.rgae);
+  DeallocatePIf(is.rgnAtlIndex);
+  DeallocatePIf(is.rgnAtlGrid);
+  is.rgae = rgae;
+  is.rgnAtlIndex = rgnIndex;
+  is.rgnAtlGrid = rgnGrid;
+  is.cae = cae;
+  return fTrue;
+}
+
+
+// Load the time zone rules, zone changes, and zone links from the time zone
+// binary snapshot. Return whether the snapshot was present and valid.
+
+flag FLoadZoneSnapshot()
+{
+  int rgn[cbinHdr], crun, crue, czcn, czce;
+  RuleName *rgrun;
+  RuleEntry *rgrue;
+  ZoneChange *rgzc;
+  int *rgnLinks;
+  FILE *file;
+
+  file = FileOpenSnapshot(DEFAULT_TIMECHANGE, szZoneBinMagic, rgn);
+  if (file == NULL)
+    return fFalse;
+  crun = rgn[ibinCount1]; crue = rgn[ibinCount2];
+  czcn = rgn[ibinCount3]; czce = rgn[ibinCount4];
+  if (rgn[ibinSize1] != sizeof(RuleName) ||
+    rgn[ibinSize2] != sizeof(RuleEntry) ||
+    rgn[ibinSize3] != sizeof(ZoneChange) || !FBetween(czcn, 0, iznMax)) {
+    fclose(file);
+    return fFalse;
+  }
+  rgrun = (RuleName *)PReadSnapshot(file, (crun+1) * sizeof(RuleName),
+    "timezone rule names");
+  rgrue = rgrun == NULL ? NULL : (RuleEntry *)PReadSnapshot(file,
+    crue * sizeof(RuleEntry), "timezone rule entries");
+  rgzc = rgrue == NULL ? NULL : (ZoneChange *)PReadSnapshot(file,
+    czce * sizeof(ZoneChange), "timezone changes");
+  rgnLinks = rgzc == NULL ? NULL : (int *)PReadSnapshot(file,
+    (iznMax*3+1) * sizeof(int), "timezone links");
+  fclose(file);
+  if (rgnLinks == NULL) {
+    DeallocatePIf(rgrun);
+    DeallocatePIf(rgrue);
+    DeallocatePIf(rgzc);
+    return fFalse;
+  }
+
+  FreeZoneTables();
+  DeallocatePIf(is.rgrun);
+  DeallocatePIf(is.rgrue);
+  DeallocatePIf(is.rgzc);
+  is.rgrun = rgrun; is.crun = crun;
+  is.rgrue = rgrue; is.crue = crue;
+  is.rgzc = rgzc; is.czcn = czcn; is.czce = czce;
+  CopyRgb((pbyte)rgnLinks, (pbyte)rgznChange, iznMax * sizeof(int));
+  CopyRgb((pbyte)&rgnLinks[iznMax], (pbyte)rgizcChange,
+    (iznMax+1) * sizeof(int));
+  CopyRgb((pbyte)&rgnLinks[iznMax*2+1], (pbyte)mpznzc, iznMax * sizeof(int));
+  DeallocateP(rgnLinks);
+  return fTrue;
+}
+
+
+// Write the header of a binary snapshot, returning the open file.
+
+FILE *FileCreateSnapshot(CONST char *szText, CONST char *szMagic, int *rgn)
+{
+  char szBin[cchSzMax], sz[cchSzMax*2];
+  FILE *file;
+
+  if (!FGetSnapshotInfo(szText, szBin, &rgn[ibinText], &rgn[ibinHash])) {
+    sprintf(sz, "File '%s' not found.", szText);
+    PrintError(sz);
+    return NULL;
+  }
+  file = fopen(szBin, "wb");
+  if (file == NULL) {
+    sprintf(sz, "Couldn't create snapshot file '%s'.", szBin);
+    PrintError(sz);
+    return NULL;
+  }
+  rgn[ibinEndian] = nBinEndian;
+  rgn[ibinVersion] = nBinVersion;
+  rgn[ibinIzn] = iznMax;
+  fwrite(szMagic, 1, 8, file);
+  fwrite(rgn, sizeof(int), cbinHdr, file);
+  return file;
+}
+
+
+// Save the currently loaded atlas and time zone data, along with the atlas
+// indexes, into binary snapshots next to atlas.as and timezone.as, which
+// are loaded instead of the text files from then on until the text files
+// change. Implements the -YYc switch.
+
+flag FAtlasCompileSnapshot()
+{
+  int rgn[cbinHdr], cIndex;
+  FILE *file;
+  flag fRet;
+
+  if (!FEnsureAtlas() || !FEnsureAtlasIndex() || !FEnsureAtlasGrid() ||
+    !FEnsureTimezoneChanges())
+    return fFalse;
+
+  // Write atlas snapshot.
+  ClearB((pbyte)rgn, sizeof(rgn));
+  cIndex = cgramAtl + 1 + is.rgnAtlIndex[cgramAtl];
+  rgn[ibinSize1] = sizeof(AtlasEntry);
+  rgn[ibinSize2] = cgramAtl;
+  rgn[ibinSize3] = cchSzAtl;
+  rgn[ibinCount1] = is.cae;
+  rgn[ibinCount2] = cIndex;
+  rgn[ibinCount3] = cgridLat*cgridLon + 1 + is.cae;
+  file = FileCreateSnapshot(DEFAULT_ATLASFILE, szAtlasBinMagic, rgn);
+  if (file == NULL)
+    return fFalse;
+  fwrite(is.rgae, sizeof(AtlasEntry), is.cae, file);
+  fwrite(is.rgnAtlIndex, sizeof(int), cIndex, file);
+  fwrite(is.rgnAtlGrid, sizeof(int), rgn[ibinCount3], file);
+  fRet = !ferror(file);
+  fclose(file);
+
+  // Write time zone snapshot.
+  ClearB((pbyte)rgn, sizeof(rgn));
+  rgn[ibinSize1] = sizeof(RuleName);
+  rgn[ibinSize2] = sizeof(RuleEntry);
+  rgn[ibinSize3] = sizeof(ZoneChange);
+  rgn[ibinCount1] = is.crun;
+  rgn[ibinCount2] = is.crue;
+  rgn[ibinCount3] = is.czcn;
+  rgn[ibinCount4] = is.czce;
+  file = FileCreateSnapshot(DEFAULT_TIMECHANGE, szZoneBinMagic, rgn);
+  if (file == NULL)
+    return fFalse;
+  fwrite(is.rgrun, sizeof(RuleName), is.crun+1, file);
+  fwrite(is.rgrue, sizeof(RuleEntry), is.crue, file);
+  fwrite(is.rgzc, sizeof(ZoneChange), is.czce, file);
+  fwrite(rgznChange, sizeof(int), iznMax, file);
+  fwrite(rgizcChange, sizeof(int), iznMax+1, file);
+  fwrite(mpznzc, sizeof(int), iznMax, file);
+  fRet &= !ferror(file);
+  fclose(file);
+  if (!fRet)
+    PrintError("Couldn't write atlas snapshot files.");
+  return fRet;
+}
+
+
 // Lookup a city in the atlas. Display a list of matches in text or in a
 // Windows dialog. Implements the -N switch and "Lookup City" button.
 
@@ -1483,9 +1931,10 @@ flag DisplayAtlasLookup(CONST char *szIn, size_t lDialog, int *piae)
 {
   AtlasEntry *pae;
   char szCity[cchSzMax], sz[cchSzMax], *pch1, *pch2, *pch;
-  int rgiae[ilistMax], rgn[ilistMax], ilistHi,
-    clist = 0, icn, istateUS, istateCA, iae, nPower, i, j, nSav, fSav;
-  flag fTimezoneChanges;
+  int rgiae[ilistMax], rgn[ilistMax], ilistHi, *rgpos, cpos, ipos, ichPos,
+    iaePrev = -1, clist = 0, icn, istateUS, istateCA, iae, nPower, i, j,
+    nSav, fSav;
+  flag fTimezoneChanges, fIndex = fFalse;
   real zon;
 #ifdef WIN
   HWND hdlg = (HWND)lDialog;
@@ -1545,17 +1994,35 @@ flag DisplayAtlasLookup(CONST char *szIn, size_t lDialog, int *piae)
       }
   }
 
+  // Use the atlas index to get just those places in city names where the
+  // input string might be, rather than searching every city name.
+  if (CchSz(szCity) >= 3 && FEnsureAtlasIndex()) {
+    cpos = CposLookupAtlas(szCity, &rgpos, &ichPos);
+    fIndex = fTrue;
+  }
+
   // Loop over all cities in atlas, seeing how well they match input string.
-  for (iae = 0; iae < is.cae; iae++) {
+  for (ipos = 0, iae = 0; fIndex ? ipos < cpos : iae < is.cae;
+    ipos++, iae++) {
+    if (fIndex) {
+      // Check the place, and only count the first match in each city name.
+      iae = rgpos[ipos] / cchSzAtl;
+      j = rgpos[ipos] % cchSzAtl - ichPos;
+      if (iae == iaePrev || j < 0 ||
+        !FEqSzSubI(szCity, &is.rgae[iae].szNam[j]))
+        continue;
+      iaePrev = iae;
+    }
     pae = &is.rgae[iae];
     nPower = 0;
     if (FEqSzI(szCity, pae->szNam)) {
       // Exact match of entire name = 10 points.
       nPower = 10;
     } else {
-      for (j = 0; pae->szNam[j]; j++)
-        if (FEqSzSubI(szCity, &pae->szNam[j]))
-          break;
+      if (!fIndex)
+        for (j = 0; pae->szNam[j]; j++)
+          if (FEqSzSubI(szCity, &pae->szNam[j]))
+            break;
       // Substring match = 1 point.
       // Substring match at start and/or end of word = +1 point each.
       if (pae->szNam[j] != chNull)
@@ -1665,10 +2132,10 @@ flag DisplayAtlasNearby(real lon, real lat, size_t lDialog, int *piae,
 {
   AtlasEntry *pae;
   char sz[cchSzMax], *pch;
-  int rgiae[ilistMax], rgn[ilistMax], ilistHi, clist = 0, iae, nDist,
-    i, j, nSav, fSav;
-  flag fTimezoneChanges;
-  real rDist, zon;
+  int rgiae[ilistMax], rgn[ilistMax], ilistHi, clist, iae, nDist,
+    i, j, nSav, fSav, ipos, cpos = 0, igrid, x, y, x1, x2, y1, y2;
+  flag fTimezoneChanges, fGrid;
+  real rDist, zon, rRadius, rLon, rMul;
 #ifdef WIN
   HWND hdlg = (HWND)lDialog;
 #endif
@@ -1678,27 +2145,70 @@ flag DisplayAtlasNearby(real lon, real lat, size_t lDialog, int *piae,
   ilistHi = (lDialog != 0 ? *piae : (piae != NULL ? 1 :
     (us.nAtlasList > 0 ? Min(us.nAtlasList, ilistMax) : ilistMax)));
 
-  // Loop over all cities in atlas, computing their distance to location.
-  for (iae = 0; iae < is.cae; iae++) {
-    pae = &is.rgae[iae];
-    rDist = SphDistance(lon, lat, pae->lon, pae->lat) / 360.0 *
-      (us.fEuroDist ? 40075.0 : 24901.0);
-    nDist = (int)rDist;
-    for (i = 0; i < clist; i++)
-      if (nDist < rgn[i])
-        break;
-    if (i >= ilistHi)
-      continue;
-    // Insert city in list, in order sorted by nearness.
-    if (i < clist)
-      for (j = Min(clist+1, ilistHi-1); j > i; j--) {
-        rgiae[j] = rgiae[j-1];
-        rgn[j] = rgn[j-1];
+  // Check cities in atlas grid cells within a radius of the location,
+  // computing their distance to location. If that doesn't find enough
+  // cities, double the radius and try again. Once the radius reaches a
+  // quarter of the globe, just loop over all cities in the atlas.
+  rMul = (us.fEuroDist ? 40075.0 : 24901.0) / 360.0;
+  fGrid = FEnsureAtlasGrid();
+  for (rRadius = rGridAtl / 2.0;; rRadius *= 2.0) {
+    if (!fGrid || rRadius >= rDegQuad) {
+      fGrid = fFalse;
+      x1 = y1 = 0; x2 = y2 = 0; cpos = is.cae;
+    } else {
+      // Cells are in the latitude range, and within the longitude range
+      // that a circle of the radius spans at that latitude.
+      y1 = YgridAtl(lat - rRadius - rSmall);
+      y2 = YgridAtl(lat + rRadius + rSmall);
+      if (RAbs(lat) + rRadius >= rDegQuad)
+        rLon = rDegHalf;
+      else
+        rLon = RAsinD(RSinD(rRadius) / RCosD(lat)) + rSmall;
+      x1 = XgridAtl(lon - rLon); x2 = XgridAtl(lon + rLon);
+      if (x2 - x1 >= cgridLon) {
+        x1 = 0; x2 = cgridLon-1;
       }
-    rgiae[i] = iae;
-    rgn[i] = nDist;
-    if (clist < ilistHi)
-      clist++;
+    }
+    clist = 0;
+    for (y = y1; y <= y2; y++)
+      for (x = x1; x <= x2; x++) {
+        if (fGrid) {
+          igrid = y*cgridLon + (x % cgridLon + cgridLon) % cgridLon;
+          ipos = is.rgnAtlGrid[igrid];
+          cpos = is.rgnAtlGrid[igrid + 1];
+        } else
+          ipos = 0;
+        for (; ipos < cpos; ipos++) {
+          iae = fGrid ? is.rgnAtlGrid[cgridLat*cgridLon + 1 + ipos] : ipos;
+          pae = &is.rgae[iae];
+          rDist = SphDistance(lon, lat, pae->lon, pae->lat) * rMul;
+          nDist = (int)rDist;
+          // Cities at the same distance are sorted by atlas order.
+          for (i = 0; i < clist; i++)
+            if (nDist < rgn[i] || (nDist == rgn[i] && iae < rgiae[i]))
+              break;
+          if (i >= ilistHi)
+            continue;
+          // Insert city in list, in order sorted by nearness.
+          for (j = Min(clist, ilistHi-1); j > i; j--) {
+            rgiae[j] = rgiae[j-1];
+            rgn[j] = rgn[j-1];
+          }
+          rgiae[i] = iae;
+          rgn[i] = nDist;
+          if (clist < ilistHi)
+            clist++;
+        }
+      }
+    if (!fGrid)
+      break;
+    // Cities outside the radius are at least this far away, so none of
+    // them can be in the list if it's already full of nearer ones, or if
+    // only cities within the astro-graph distance are being displayed.
+    nDist = (int)(rRadius * rMul);
+    if ((clist >= ilistHi && rgn[clist-1] < nDist) ||
+      (fAstroGraph && us.nAstroGraphDist <= nDist))
+      break;
   }
 
   // Display header.
@@ -1800,12 +2310,13 @@ void AdjustTime(int *mon, int *day, int *yea, int *tim)
 
 // Set the Daylight Time and time zone values in a chart, since the period
 // they apply to has been determined. However, if near the endpoints of the
-// period, make sure the time isn't actually ambiguous or invalid.
+// period, make sure the time isn't actually ambiguous or invalid, and warn
+// about it if fWarn set.
 
 flag FSetDstZon(CI *ci, int izn,
   int mon, int day, int yea, int tim, int zon, int doff,
   int monPrev, int dayPrev, int yeaPrev, int timPrev, int dstPrev,
-    int zonPrev, int doffPrev)
+    int zonPrev, int doffPrev, flag fWarn)
 {
   char sz[cchSzMax*2];
 
@@ -1814,7 +2325,7 @@ flag FSetDstZon(CI *ci, int izn,
     (day == ci->day && RTim(tim) > ci->tim)))))))
     return fFalse;
 
-  if (ci->yea == yea && ci->mon == mon && ci->day == day &&
+  if (fWarn && ci->yea == yea && ci->mon == mon && ci->day == day &&
     RTim(tim) - ci->tim <= RTim(NAbs(doff)) && doff < 0) {
     sprintf(sz, "Unknown whether Daylight Time is in effect!\n"
       "On %s at %s local time in zone %s (%s), "
@@ -1826,8 +2337,9 @@ flag FSetDstZon(CI *ci, int izn,
       rgszzn[izn], SzZone(RTim(zon)), SzHMS(doff));
     PrintWarning(sz);
   }
-  if (ci->yea == yeaPrev && ci->mon == monPrev && ci->day == dayPrev &&
-    ci->tim - RTim(timPrev) < RTim(doffPrev) && doffPrev > 0) {
+  if (fWarn && ci->yea == yeaPrev && ci->mon == monPrev &&
+    ci->day == dayPrev && ci->tim - RTim(timPrev) < RTim(doffPrev) &&
+    doffPrev > 0) {
     sprintf(sz, "Unknown whether Daylight Time is in effect!\n"
       "On %s at %s local time in zone %s (%s),"
       "clocks 'spring forward' by %s hour.\n"
@@ -1846,19 +2358,103 @@ flag FSetDstZon(CI *ci, int izn,
 }
 
 
+// Determine the Daylight Saving changes a rule makes within a year, that
+// are within the period covered by a time zone change entry (the one after
+// the entry passed in). Fill out arrays of their dates and rule entries, in
+// order sorted by date/time, and return the number of changes.
+
+int CchngZoneRule(CONST ZoneChange *pzc, int iyea,
+  int *rgmon, int *rgday, int *rgtim, int *rgiru)
+{
+  char sz[cchSzMax];
+  CONST ZoneChange *pzc2 = &pzc[1];
+  CONST RuleEntry *pru;
+  int irue, crue, ici = 0, mon, day, yea, tim, idMon, dd, j, k;
+
+  Assert(pzc2->irun < is.crun);
+  irue = is.rgrun[pzc2->irun].irue;
+  crue = is.rgrun[pzc2->irun + 1].irue - irue;
+
+  // Loop over each entry within rule, checking if it applies this year.
+  for (j = 0; j < crue; j++) {
+    pru = &is.rgrue[irue + j];
+    if (!FBetween(iyea, pru->yea1, pru->yea2))
+      continue;
+    if (ici >= ichngMax) {
+      sprintf(sz, "Zone rule warning: "
+        "Too many changes in rule %s within year %d.\n",
+        is.rgrun[pzc2->irun].szNam, iyea);
+      PrintWarning(sz);
+      break;
+    }
+    yea = iyea;
+    mon = pru->mon;
+    if (pru->daytype <= 0) {
+      day = pru->daynum;
+    } else if (pru->daytype == 1) {
+      idMon = DayInMonth(mon, yea);
+      dd = DayOfWeek(mon, idMon, yea) - pru->dayweek;
+      if (dd < 0)
+        dd += cWeek;
+      day = idMon - dd;
+    } else {
+      idMon = pru->daynum;
+      dd = DayOfWeek(mon, idMon, yea);
+      if (pru->daytype == 2) {
+        dd = pru->dayweek - dd;
+        if (dd < 0)
+          dd += cWeek;
+        day = idMon + dd;
+      } else {
+        dd = dd - pru->dayweek;
+        if (dd < 0)
+          dd += cWeek;
+        day = idMon - dd;
+      }
+    }
+    tim = pru->tim;
+    AdjustTime(&mon, &day, &yea, &tim);
+    // Rule doesn't apply if it's outside ZoneChange endpoint times.
+    if (iyea == pzc->yea && (mon < pzc->mon || (mon == pzc->mon &&
+      (day < pzc->day || (day == pzc->day && tim < pzc->tim)))))
+      continue;
+    if (iyea == pzc2->yea && (mon > pzc2->mon || (mon == pzc2->mon &&
+      (day > pzc2->day || (day == pzc2->day && tim >= pzc2->tim)))))
+      continue;
+    rgmon[ici] = mon; rgday[ici] = day; rgtim[ici] = tim;
+    rgiru[ici] = irue + j;
+    ici++;
+  }
+
+  // Sort the list of changes found in order by date/time.
+  for (j = 1; j < ici; j++) {
+    k = j-1;
+    while (k >= 0 && (rgmon[k] > rgmon[j] ||
+      (rgmon[k] == rgmon[j] && (rgday[k] > rgday[j] ||
+      (rgday[k] == rgday[j] && rgtim[k] > rgtim[j]))))) {
+      SwapN(rgmon[k], rgmon[j]);
+      SwapN(rgday[k], rgday[j]);
+      SwapN(rgtim[k], rgtim[j]);
+      SwapN(rgiru[k], rgiru[j]);
+      k--;
+    }
+  }
+  return ici;
+}
+
+
 // Given a time zone area, display a list of time zone and Daylight Saving
 // time changes within it. Display it in text or within a Windows dialog.
-// Implements the -Nz switch. Can also do the important task of determining
-// the time zone and Daylight Time setting for a particular time.
+// Implements the -Nz switch. If ci is set, rule based changes are listed up
+// to a few years after its date, instead of after the current chart's.
 
 flag DisplayTimezoneChanges(int iznIn, size_t lDialog, CI *ci)
 {
   char sz[cchSzMax*2], sz1[cchSzMax], sz2[cchSzDef], sz3[cchSzDef];
   int rgmon[ichngMax], rgday[ichngMax], rgtim[ichngMax], rgiru[ichngMax],
     izn, izcn, izce, czce,
-    mon, day, yea, tim, dst, zon, off, doff,
-    monPrev, dayPrev, yeaPrev, timPrev, dstPrev, zonPrev, offPrev, doffPrev,
-    iyea, yea2, irue, crue, cn, ici, idMon, dd, i, j, k;
+    mon, day, yea, tim, dst, zon, off, doff, dstPrev, zonPrev, offPrev,
+    iyea, yea2, ici, cn, i, j, k;
   ZoneChange *pzc, *pzc2;
   RuleEntry *pru;
 #ifdef WIN
@@ -1882,7 +2478,7 @@ flag DisplayTimezoneChanges(int iznIn, size_t lDialog, CI *ci)
   if (iznIn < 0 && izn > 0)
     PrintL();
   izcn = mpznzc[izn];
-  if (lDialog == 0 && ci == NULL) {
+  if (lDialog == 0) {
     AnsiColor(kWhiteA);
     sprintf(sz, "Time changes within zone: %s", rgszzn[izn]); PrintSz(sz);
     i = rgznChange[izcn];
@@ -1905,9 +2501,7 @@ flag DisplayTimezoneChanges(int iznIn, size_t lDialog, CI *ci)
 
   // Loop over all time zone change entries within this time zone area.
   for (i = 0; i < czce-1; i++) {
-    monPrev = mon; dayPrev = day; yeaPrev = yea; timPrev = tim;
-    dstPrev = dst; zonPrev = zon;
-    offPrev = off; doffPrev = doff;
+    dstPrev = dst; zonPrev = zon; offPrev = off;
     pzc = &is.rgzc[izce + i];
     pzc2 = &pzc[1];
     mon = pzc->mon; day = pzc->day; yea = pzc->yea; tim = pzc->tim;
@@ -1925,20 +2519,6 @@ flag DisplayTimezoneChanges(int iznIn, size_t lDialog, CI *ci)
     if (doff == 0 && dst == dstPrev && zon == zonPrev)
       goto LSkip;
     cn++;
-    if (ci != NULL && lDialog == 0) {
-      // If ci set, then just set correct time zone and Daylight offset.
-      // If ci date before any time zones were defined, then default to LMT.
-      if (cn <= 1 && (yea > ci->yea || (yea == ci->yea && (mon > ci->mon ||
-        (mon == ci->mon && (day > ci->day ||
-        (day == ci->day && RTim(tim) > ci->tim))))))) {
-        ci->dst = 0.0; ci->zon = zonLMT;
-        return fTrue;
-      }
-      if (FSetDstZon(ci, izn, mon, day, yea, tim, zon, doff,
-        monPrev, dayPrev, yeaPrev, timPrev, dstPrev, zonPrev, doffPrev))
-        return fTrue;
-      goto LSkip;
-    }
 
     // Display when the time zone offset changes.
     if (cn > 1)
@@ -1973,89 +2553,18 @@ LSkip:
       continue;
 
     // A rule applies to this time change entry. Use it to check for changes.
-    Assert(pzc2->irun < is.crun);
-    irue = is.rgrun[pzc2->irun].irue;
-    crue = is.rgrun[pzc2->irun + 1].irue - irue;
     yea2 = Min(pzc2->yea, Max(2030, Min(2080,
       (ci != NULL ? ci->yea : Yea) + 5)));
 
     // Loop over each year within the time change entry.
     for (iyea = pzc->yea; iyea <= yea2; iyea++) {
-      ici = 0;
-
-      // Loop over each entry within rule, checking if it applies this year.
-      for (j = 0; j < crue; j++) {
-        pru = &is.rgrue[irue + j];
-        if (!FBetween(iyea, pru->yea1, pru->yea2))
-          continue;
-        if (ici >= ichngMax) {
-          sprintf(sz, "Zone rule warning: "
-            "Too many changes in rule %s within year %d.\n",
-            is.rgrun[pzc2->irun].szNam, iyea);
-          PrintWarning(sz);
-          break;
-        }
-        yea = iyea;
-        mon = pru->mon;
-        if (pru->daytype <= 0) {
-          day = pru->daynum;
-        } else if (pru->daytype == 1) {
-          idMon = DayInMonth(mon, yea);
-          dd = DayOfWeek(mon, idMon, yea) - pru->dayweek;
-          if (dd < 0)
-            dd += cWeek;
-          day = idMon - dd;
-        } else {
-          idMon = pru->daynum;
-          dd = DayOfWeek(mon, idMon, yea);
-          if (pru->daytype == 2) {
-            dd = pru->dayweek - dd;
-            if (dd < 0)
-              dd += cWeek;
-            day = idMon + dd;
-          } else {
-            dd = dd - pru->dayweek;
-            if (dd < 0)
-              dd += cWeek;
-            day = idMon - dd;
-          }
-        }
-        tim = pru->tim;
-        k = yea;
-        AdjustTime(&mon, &day, &k, &tim);
-        // Rule doesn't apply if it's outside ZoneChange endpoint times.
-        if (yea == pzc->yea && (mon < pzc->mon || (mon == pzc->mon &&
-          (day < pzc->day || (day == pzc->day && tim < pzc->tim)))))
-          continue;
-        if (yea == pzc2->yea && (mon > pzc2->mon || (mon == pzc2->mon &&
-          (day > pzc2->day || (day == pzc2->day && tim >= pzc2->tim)))))
-          continue;
-        rgmon[ici] = mon; rgday[ici] = day; rgtim[ici] = tim;
-        rgiru[ici] = irue + j;
-        ici++;
-      }
-
-      // Sort the list of changes found in order by date/time.
-      for (j = 1; j < ici; j++) {
-        k = j-1;
-        while (k >= 0 && (rgmon[k] > rgmon[j] ||
-          (rgmon[k] == rgmon[j] && (rgday[k] > rgday[j] ||
-          (rgday[k] == rgday[j] && rgtim[k] > rgtim[j]))))) {
-          SwapN(rgmon[k], rgmon[j]);
-          SwapN(rgday[k], rgday[j]);
-          SwapN(rgtim[k], rgtim[j]);
-          SwapN(rgiru[k], rgiru[j]);
-          k--;
-        }
-      }
+      ici = CchngZoneRule(pzc, iyea, rgmon, rgday, rgtim, rgiru);
 
       // Loop over the list of Daylight Saving changes found.
       for (j = 0; j < ici; j++) {
-        monPrev = mon; dayPrev = day; yeaPrev = yea; timPrev = tim;
-        dstPrev = dst; zonPrev = zon;
-        offPrev = off; doffPrev = doff;
+        dstPrev = dst; offPrev = off;
         pru = &is.rgrue[rgiru[j]];
-        mon = rgmon[j]; day = rgday[j]; tim = rgtim[j];
+        mon = rgmon[j]; day = rgday[j]; yea = iyea; tim = rgtim[j];
         dst = pru->dst;
         off = zon - dst;
         if (pru->timtype == 1)
@@ -2064,13 +2573,6 @@ LSkip:
           tim -= (zon - dstPrev);
         AdjustTime(&mon, &day, &yea, &tim);
         doff = offPrev - off;
-        if (ci != NULL && lDialog == 0) {
-          // If ci set, then just set correct time zone and Daylight offset.
-          if (FSetDstZon(ci, izn, mon, day, yea, tim, zon, doff,
-            monPrev, dayPrev, yeaPrev, timPrev, dstPrev, zonPrev, doffPrev))
-            return fTrue;
-          continue;
-        }
         if (doff == 0)
           continue;
 
@@ -2103,15 +2605,250 @@ LSkip:
     }
   } // i
   } // izn
+  return fTrue;
+}
+
+
+// Compile the time zone and Daylight Saving changes for a zone change area
+// into a list of transitions, expanding rules through the last year any
+// query might need. Fills in rgzt if it's set, and returns the number of
+// transitions, along with the offsets in effect after the last of them.
+
+int CztCompileZone(int izcn, ZoneTrans *rgzt, int *pdst, int *pzon)
+{
+  int rgmon[ichngMax], rgday[ichngMax], rgtim[ichngMax], rgiru[ichngMax],
+    izce, czce, iyea, yea2, ici, cn = 0, czt = 0, i, j;
+  ZoneClock zc, zcPrev;
+  ZoneChange *pzc, *pzc2;
+  RuleEntry *pru;
+
+  izce = rgizcChange[izcn];
+  czce = rgizcChange[izcn+1] - izce;
+  zc.off = zc.doff = 0;
+  zc.mon = zc.day = zc.yea = zc.tim = zc.dst = zc.zon = nLarge;
+
+  // Walk the zone change entries the same way -Nz does, recording each
+  // change, along with the clock state before it.
+  for (i = 0; i < czce-1; i++) {
+    zcPrev = zc;
+    pzc = &is.rgzc[izce + i];
+    pzc2 = &pzc[1];
+    zc.mon = pzc->mon; zc.day = pzc->day; zc.yea = pzc->yea;
+    zc.tim = pzc->tim;
+    zc.dst = pzc2->dst < nLarge ? pzc2->dst : 0;
+    zc.zon = pzc2->zon;
+    if (pzc->timtype == 1)
+      zc.tim += zc.dst;
+    else if (pzc->timtype == 2)
+      zc.tim -= (zc.zon - zc.dst);
+    AdjustTime(&zc.mon, &zc.day, &zc.yea, &zc.tim);
+    if (cn <= 0 && zc.zon % (60*15))
+      continue;
+    zc.off = zc.zon - zc.dst;
+    zc.doff = zcPrev.off - zc.off;
+    if (!(zc.doff == 0 && zc.dst == zcPrev.dst && zc.zon == zcPrev.zon)) {
+      cn++;
+      if (rgzt != NULL) {
+        rgzt[czt].zc = zc; rgzt[czt].zcPrev = zcPrev;
+        rgzt[czt].yeaRule = -nLarge;
+      }
+      czt++;
+    }
+    if (pzc2->irun < 0)
+      continue;
+
+    // Expand the rule applying to this entry year by year.
+    yea2 = Min(pzc2->yea, 2080);
+    for (iyea = pzc->yea; iyea <= yea2; iyea++) {
+      ici = CchngZoneRule(pzc, iyea, rgmon, rgday, rgtim, rgiru);
+      for (j = 0; j < ici; j++) {
+        zcPrev = zc;
+        pru = &is.rgrue[rgiru[j]];
+        zc.mon = rgmon[j]; zc.day = rgday[j]; zc.yea = iyea;
+        zc.tim = rgtim[j];
+        zc.dst = pru->dst;
+        zc.off = zc.zon - zc.dst;
+        if (pru->timtype == 1)
+          zc.tim += zcPrev.dst;
+        else if (pru->timtype == 2)
+          zc.tim -= (zc.zon - zcPrev.dst);
+        AdjustTime(&zc.mon, &zc.day, &zc.yea, &zc.tim);
+        zc.doff = zcPrev.off - zc.off;
+        if (rgzt != NULL) {
+          rgzt[czt].zc = zc; rgzt[czt].zcPrev = zcPrev;
+          rgzt[czt].yeaRule = iyea;
+        }
+        czt++;
+      }
+    }
+  }
+  *pdst = zc.dst; *pzon = zc.zon;
+  return czt;
+}
 
-  // If ci date after all time zones are defined, then go with final values.
-  if (ci != NULL && lDialog == 0) {
-    ci->dst = RTim(dst); ci->zon = RTim(zon);
+
+// Return whether a time zone transition happens after a chart's time.
+
+flag FAfterZoneClock(CONST ZoneClock *pzc, CONST CI *ci)
+{
+  return pzc->yea > ci->yea || (pzc->yea == ci->yea && (pzc->mon > ci->mon ||
+    (pzc->mon == ci->mon && (pzc->day > ci->day ||
+    (pzc->day == ci->day && RTim(pzc->tim) > ci->tim)))));
+}
+
+
+// Create the compiled transition table for a zone change area if it hasn't
+// been created yet. Tables are created as needed, since most runs only use
+// the time zone areas of one or two cities.
+
+flag FEnsureZoneTable(int izcn)
+{
+  ZoneTable *pztb;
+  ZoneTrans *rgzt;
+  ZoneClock *pzc1, *pzc2;
+  int czt, dst, zon, izt;
+
+  if (!FEnsureTimezoneChanges() || izcn < 0)
+    return fFalse;
+  if (is.rgztb == NULL) {
+    is.rgztb = RgAllocate(iznMax, ZoneTable, "timezone tables");
+    if (is.rgztb == NULL)
+      return fFalse;
+    ClearB((pbyte)is.rgztb, iznMax * sizeof(ZoneTable));
+  }
+  pztb = &is.rgztb[izcn];
+  if (pztb->rgzt != NULL)
+    return fTrue;
+  czt = CztCompileZone(izcn, NULL, &dst, &zon);
+  rgzt = RgAllocate(Max(czt, 1), ZoneTrans, "timezone table");
+  if (rgzt == NULL)
+    return fFalse;
+  CztCompileZone(izcn, rgzt, &dst, &zon);
+
+  // Binary searching requires transitions be in order. Rules overlapping
+  // each other could in theory break that, so check.
+  pztb->fSorted = fTrue;
+  for (izt = 1; izt < czt; izt++) {
+    pzc1 = &rgzt[izt-1].zc; pzc2 = &rgzt[izt].zc;
+    if (pzc1->yea > pzc2->yea || (pzc1->yea == pzc2->yea &&
+      (pzc1->mon > pzc2->mon || (pzc1->mon == pzc2->mon &&
+      (pzc1->day > pzc2->day || (pzc1->day == pzc2->day &&
+      pzc1->tim > pzc2->tim)))))) {
+      pztb->fSorted = fFalse;
+      break;
+    }
   }
+  pztb->czt = czt;
+  pztb->dst = dst; pztb->zon = zon;
+  pztb->rgzt = rgzt;
   return fTrue;
 }
 
 
+// Free all compiled time zone transition tables, which is done when the
+// time zone data they're based on changes.
+
+void FreeZoneTables()
+{
+  int izcn;
+
+  if (is.rgztb == NULL)
+    return;
+  for (izcn = 0; izcn < iznMax; izcn++)
+    DeallocatePIf(is.rgztb[izcn].rgzt);
+  DeallocateP(is.rgztb);
+  is.rgztb = NULL;
+}
+
+
+// Return the index of the first transition in a compiled time zone table
+// that happens after a chart's time, or the number of transitions if none.
+
+int IztFindZone(CONST ZoneTable *pztb, CONST CI *ci)
+{
+  int izt, iztLo, iztHi;
+
+  if (!pztb->fSorted) {
+    for (izt = 0; izt < pztb->czt; izt++)
+      if (FAfterZoneClock(&pztb->rgzt[izt].zc, ci))
+        break;
+    return izt;
+  }
+  iztLo = 0; iztHi = pztb->czt;
+  while (iztLo < iztHi) {
+    izt = (iztLo + iztHi) >> 1;
+    if (FAfterZoneClock(&pztb->rgzt[izt].zc, ci))
+      iztHi = izt;
+    else
+      iztLo = izt + 1;
+  }
+  return iztLo;
+}
+
+
+// Determine the time zone and Daylight Time setting in effect in a time
+// zone area at the local date and time of a chart, setting them in the
+// chart. This binary searches the zone's compiled transitions, and displays
+// nothing unless fWarn is set and the chart's time is ambiguous or invalid.
+
+flag FZoneDstFromIzn(CI *ci, int izn, flag fWarn)
+{
+  ZoneTable *pztb;
+  ZoneTrans *pzt;
+  int izt;
+
+  if (!FEnsureZoneTable(mpznzc[izn]))
+    return fFalse;
+  pztb = &is.rgztb[mpznzc[izn]];
+  izt = IztFindZone(pztb, ci);
+
+  // If chart is after all time zones are defined, go with final values.
+  if (izt >= pztb->czt) {
+    ci->dst = RTim(pztb->dst); ci->zon = RTim(pztb->zon);
+    return fTrue;
+  }
+  // If chart is before any time zones were defined, then default to LMT.
+  if (izt <= 0) {
+    ci->dst = 0.0; ci->zon = zonLMT;
+    return fTrue;
+  }
+  // Rules are only followed up to a few years after the chart's date, so
+  // if the transition is from further out, use the offsets before it.
+  pzt = &pztb->rgzt[izt];
+  if (pzt->yeaRule > Max(2030, Min(2080, ci->yea + 5))) {
+    ci->dst = RTim(pzt->zcPrev.dst); ci->zon = RTim(pzt->zcPrev.zon);
+    return fTrue;
+  }
+  return FSetDstZon(ci, izn, pzt->zc.mon, pzt->zc.day, pzt->zc.yea,
+    pzt->zc.tim, pzt->zc.zon, pzt->zc.doff, pzt->zcPrev.mon,
+    pzt->zcPrev.day, pzt->zcPrev.yea, pzt->zcPrev.tim, pzt->zcPrev.dst,
+    pzt->zcPrev.zon, pzt->zcPrev.doff, fWarn);
+}
+
+
+// Return how many seconds past a chart's time the next transition in a time
+// zone area is, i.e. how long the setting FZoneDstFromIzn() determines for
+// the chart stays valid as its time advances. Return -1 if that's forever.
+
+long LZoneValid(CONST CI *ci, int izn)
+{
+  ZoneTable *pztb;
+  ZoneClock *pzc;
+  int izt;
+
+  if (!FEnsureZoneTable(mpznzc[izn]))
+    return 0;
+  pztb = &is.rgztb[mpznzc[izn]];
+  izt = IztFindZone(pztb, ci);
+  if (izt >= pztb->czt)
+    return -1;
+  pzc = &pztb->rgzt[izt].zc;
+  return (MdyToJulian(pzc->mon, pzc->day, pzc->yea) -
+    MdyToJulian(ci->mon, ci->day, ci->yea)) * 86400 + pzc->tim -
+    (long)RFloor(ci->tim * 3600.0 + rRound);
+}
+
+
 // Return the default time zone for a time zone area. That means the latest
 // offset in the zone change list corresponding to this time zone area.
 
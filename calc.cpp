@@ -1196,9 +1196,11 @@ void ComputeEphem(real t)
 // This is probably the main routine in all of Astrolog. It generates a chart,
 // calculating the positions of all the celestial bodies and house cusps,
 // based on the current chart information, and saves them for use by any of
-// the display routines.
+// the display routines. If fAll isn't set, only compute what CastObjects()
+// needs, which skips house cusps (unless fHouse is set), Arabic parts, and
+// the house placements of objects.
 
-real CastChart(int nContext)
+real CastChartCore(int nContext, flag fAll, flag fHouse)
 {
   CI ciSav;
   real housetemp[cSign+1], r, r2;
@@ -1236,8 +1238,19 @@ real CastChart(int nContext)
   AA = Min(AA, rDegQuad-rSmall);     // Make sure chart isn't being cast on
   AA = Max(AA, -(rDegQuad-rSmall));  // precise North or South Pole.
 
-  ClearB((pbyte)&cp0, sizeof(CP));     // On ecliptic unless say otherwise.
-  ClearB((pbyte)space, sizeof(space));
+  if (fAll) {
+    ClearB((pbyte)&cp0, sizeof(CP));   // On ecliptic unless say otherwise.
+    ClearB((pbyte)space, sizeof(space));
+  } else {
+    // Only clear the object positions that are about to be recomputed.
+    for (i = 0; i <= is.nObj; i++) {
+      planet[i] = planetalt[i] = ret[i] = retalt[i] = retlen[i] = 0.0;
+      PtZero(space[i]);
+      cp0.dist[i] = 0.0;
+    }
+    if (!FCmSwissAny())
+      fHouse = fTrue;
+  }
 
   is.T = (is.JD + TT/24.0) + (us.rCuspAddition/24.0);
   if (us.fProgress) {
@@ -1272,7 +1285,10 @@ real CastChart(int nContext)
   // Go calculate house cusp and angle positions.
 
 #ifdef SWISS
-  if (FCmSwissAny()) {
+  if (!fHouse) {
+    SwissChartVars(us.fProgress && us.nProgress != ptSolarArc ? is.Tp : is.T,
+      &is.OB, &is.rOff, &is.rNut);
+  } else if (FCmSwissAny()) {
     SwissHouse(us.fProgress && us.nProgress != ptSolarArc ? is.Tp : is.T,
       OO, AA, us.nHouseSystem,
       &is.Asc, &is.MC, &is.RA, &is.Vtx, &is.EP, &is.OB, &is.rOff, &is.rNut);
@@ -1291,8 +1307,10 @@ real CastChart(int nContext)
 #endif
   }
   // This value (often same as is.RA) is frequently used, so compute once.
-  cp0.lonMC = Tropical(is.MC); r = 0.0;
-  EclToEqu(&cp0.lonMC, &r);
+  if (fHouse) {
+    cp0.lonMC = Tropical(is.MC); r = 0.0;
+    EclToEqu(&cp0.lonMC, &r);
+  }
 
 #ifdef MATRIX
   // Go calculate planet, Moon, and North Node positions.
@@ -1338,25 +1356,27 @@ real CastChart(int nContext)
 
   // Fill in "planet" positions corresponding to house cusps.
 
-  planet[oVtx] = is.Vtx; planet[oEP] = is.EP;
-  for (i = 1; i <= cSign; i++)
-    planet[cuspLo-1 + i] = chouse[i];
-  if (!us.fHouseAngle) {
-    planet[oAsc] = is.Asc; planet[oMC] = is.MC;
-    planet[oDes] = Mod(is.Asc + rDegHalf);
-    planet[oNad] = Mod(is.MC + rDegHalf);
-  }
-  for (i = oVtx; i <= cuspHi; i++) {
-    r = FCmSwissAny() ? ret[i] : (rDegMax + 1.0);
-    if (us.fVelocity)
-      r /= (rDegMax + 1.0);
-    ret[i] = r;
+  if (fHouse) {
+    planet[oVtx] = is.Vtx; planet[oEP] = is.EP;
+    for (i = 1; i <= cSign; i++)
+      planet[cuspLo-1 + i] = chouse[i];
+    if (!us.fHouseAngle) {
+      planet[oAsc] = is.Asc; planet[oMC] = is.MC;
+      planet[oDes] = Mod(is.Asc + rDegHalf);
+      planet[oNad] = Mod(is.MC + rDegHalf);
+    }
+    for (i = oVtx; i <= cuspHi; i++) {
+      r = FCmSwissAny() ? ret[i] : (rDegMax + 1.0);
+      if (us.fVelocity)
+        r /= (rDegMax + 1.0);
+      ret[i] = r;
+    }
   }
 
 #ifdef ARABIC
   // Calculate position of Part of Fortune, and custom Arabic parts.
 
-  if (!ignore[oFor]) {
+  if (fHouse && !ignore[oFor]) {
     ComputeArabic(apFor, &planet[oFor], &planetalt[oFor], &ret[oFor],
       &r, &retalt[oFor], &retlen[oFor]);
     if (r != 0.0)
@@ -1365,7 +1385,7 @@ real CastChart(int nContext)
   }
 #ifdef SWISS
   for (i = custLo; i <= custHi; i++) {
-    if (!ignore[i] && rgTypSwiss[i-custLo] == 5) {
+    if (fHouse && !ignore[i] && rgTypSwiss[i-custLo] == 5) {
       ComputeArabic(rgObjSwiss[i-custLo] - 1, &planet[i], &planetalt[i],
         &ret[i], &r, &retalt[i], &retlen[i]);
       if (r != 0.0)
@@ -1488,7 +1508,7 @@ real CastChart(int nContext)
 
   // If -1 or -2 solar chart in effect, then rotate the houses accordingly.
 
-  if (us.objOnAsc) {
+  if (us.objOnAsc && fHouse) {
     r = planet[NAbs(us.objOnAsc)-1];
     if (us.fSolarWhole)
       r = ZFromS(SFromZ(r));
@@ -1540,7 +1560,8 @@ real CastChart(int nContext)
   for (i = 0; i <= is.nObj; i++)
     if (!ignore[i])
       cp0.dist[i] = PtLen(cp0.pt[i]);
-  SortPlanets();
+  if (fAll)
+    SortPlanets();
 
 #ifdef EXPRESS
   // Adjust final planet and house positions with AstroExpressions.
@@ -1575,7 +1596,8 @@ real CastChart(int nContext)
   }
 #endif
 
-  ComputeInHouses();    // Figure out what house everything falls in.
+  if (fAll)
+    ComputeInHouses();  // Figure out what house everything falls in.
 #ifdef EXPRESS
   // Notify AstroExpression a chart has just been cast.
   if (!us.fExpOff && FSzSet(us.szExpCast2))
@@ -1586,16 +1608,586 @@ real CastChart(int nContext)
 }
 
 
+// Return whether the results of casting a chart with the current settings
+// only depend on the chart information and settings, so may be saved in and
+// reused from the cast cache. AstroExpression hooks invoked during a chart
+// cast may look at or change anything, so such charts are always recast.
+
+flag FCastCacheOk()
+{
+  if (is.cce < 0 || FNoTimeOrSpace(ciCore))
+    return fFalse;
+#ifdef EXPRESS
+  if (!us.fExpOff && (FSzSet(us.szExpCast1) || FSzSet(us.szExpCast2) ||
+    FSzSet(us.szExpProg) || FSzSet(us.szExpProg0) || FSzSet(us.szExpObj) ||
+    FSzSet(us.szExpHou) || FSzSet(us.szExpSort)))
+    return fFalse;
+#endif
+  return fTrue;
+}
+
+
+// Return a hash of the settings, restrictions, and custom object definitions
+// a chart is cast with. The settings are hashed as raw bytes, so pointers and
+// padding within them can at worst cause a needless recast. Strings which
+// affect a cast are hashed by their contents, since they may be changed in
+// place. Custom objects are hashed because the Windows dialogs edit them
+// without processing switches. Other state, such as orbital elements and the
+// fixed star catalog, can only be changed by switches, which empty the cast
+// cache.
+
+dword LCastHash()
+{
+  dword lHash = lHashInit;
+
+  lHash = LHashRgb((pbyte)&us, sizeof(US), lHash);
+  lHash = LHashRgb(ignore, sizeof(ignore), lHash);
+  lHash = LHashRgb((pbyte)force, sizeof(force), lHash);
+  if (us.szStarsList != NULL)
+    lHash = LHashRgb((pbyte)us.szStarsList, CchSz(us.szStarsList), lHash);
+#ifdef SWISS
+  lHash = LHashRgb((pbyte)rgObjSwiss, sizeof(rgObjSwiss), lHash);
+  lHash = LHashRgb((pbyte)rgTypSwiss, sizeof(rgTypSwiss), lHash);
+  lHash = LHashRgb((pbyte)rgPntSwiss, sizeof(rgPntSwiss), lHash);
+  lHash = LHashRgb((pbyte)rgFlgSwiss, sizeof(rgFlgSwiss), lHash);
+#endif
+  return lHash;
+}
+
+
+// Return a key for finding the current chart information cast with settings
+// of the given hash in the cast cache. Charts with different keys always
+// differ, while charts with the same key still need their fields compared.
+
+dword LCastKey(dword lHash)
+{
+  lHash = LHashRgb((pbyte)&ciCore.mon, sizeof(int)*3, lHash);
+  lHash = LHashRgb((pbyte)&ciCore.tim, sizeof(real)*5, lHash);
+  lHash = LHashRgb((pbyte)&is.JDp, sizeof(real), lHash);
+  return LHashRgb((pbyte)&is.fDst, sizeof(flag), lHash);
+}
+
+
+// Change the number of charts the cast cache can hold, keeping as many of the
+// charts already in it as still fit. Return whether the cache is usable.
+
+flag FSizeCastCache(int cce)
+{
+  CE *rgce;
+  dword *rgl;
+
+  if (is.cce < 0)
+    return fFalse;
+  if (cce == is.cceAlloc)
+    return fTrue;
+  rgce = RgAllocate(cce, CE, "cast cache");
+  rgl = RgAllocate(cce, dword, "cast cache keys");
+  if (rgce == NULL || rgl == NULL) {
+    DeallocatePIf(rgce);
+    DeallocatePIf(rgl);
+    return is.cceAlloc > 0;
+  }
+  is.cce = Min(is.cce, cce);
+  if (is.cce > 0) {
+    CopyRgb((pbyte)is.rgce, (pbyte)rgce, is.cce * sizeof(CE));
+    CopyRgb((pbyte)is.rglce, (pbyte)rgl, is.cce * sizeof(dword));
+  }
+  DeallocatePIf(is.rgce);
+  DeallocatePIf(is.rglce);
+  is.rgce = rgce; is.rglce = rgl;
+  is.cceAlloc = cce;
+  return fTrue;
+}
+
+
+// Return the index of the entry in the cast cache containing the current
+// chart information cast with settings of the given hash and key, or -1 if
+// the chart isn't in the cache. The settings themselves are also compared,
+// so a hash collision can't return a chart cast with other settings.
+
+int IceFindCast(dword lHash, dword lKey)
+{
+  CE *pce;
+  int ice;
+
+  for (ice = 0; ice < is.cce; ice++) {
+    if (is.rglce[ice] != lKey)
+      continue;
+    pce = &is.rgce[ice];
+    if (pce->lHash == lHash && pce->ci.mon == MM && pce->ci.day == DD &&
+      pce->ci.yea == YY && pce->ci.tim == TT && pce->ci.dst == SS &&
+      pce->ci.zon == ZZ && pce->ci.lon == OO && pce->ci.lat == AA &&
+      pce->JDp == is.JDp && pce->fDst == is.fDst &&
+      (pce->latMain == Lat || !us.fFlip) &&
+      FEqRgb((pbyte)&pce->us, (pbyte)&us, sizeof(US)) &&
+      FEqRgb(pce->ignore, ignore, sizeof(ignore)) &&
+      FEqRgb((pbyte)pce->force, (pbyte)force, sizeof(force)))
+      return ice;
+  }
+  return -1;
+}
+
+
+// Save the chart just cast in the given entry of the cast cache.
+
+void SaveCastEntry(int ice, dword lHash, dword lKey)
+{
+  CE *pce = &is.rgce[ice];
+
+  is.rglce[ice] = lKey;
+  pce->lHash = lHash;
+  pce->ci = ciCore;
+  pce->JDp = is.JDp;
+  pce->fDst = is.fDst;
+  pce->latMain = Lat;
+  CopyRgb((pbyte)&us, (pbyte)&pce->us, sizeof(US));
+  CopyRgb(ignore, pce->ignore, sizeof(ignore));
+  CopyRgb((pbyte)force, (pbyte)pce->force, sizeof(force));
+  pce->is = is;
+  pce->cp = cp0;
+  CopyRgb((pbyte)rgobjList, (pbyte)pce->rgobjList, sizeof(rgobjList));
+  CopyRgb((pbyte)rgobjList2, (pbyte)pce->rgobjList2, sizeof(rgobjList2));
+  CopyRgb((pbyte)kObjA, (pbyte)pce->kObjA, sizeof(kObjA));
+  CopyRgb((pbyte)rStarBright, (pbyte)pce->rStarBright, sizeof(rStarBright));
+}
+
+
+// Cast a full chart based on the current chart information. If the same
+// chart has been recently cast with the same settings, restore the saved
+// results from the cast cache instead of computing them again.
+
+real CastChart(int nContext)
+{
+  CE *pce;
+  dword lHash, lKey;
+  int ice;
+  real T;
+
+  if (!FCastCacheOk() || (is.cceAlloc <= 0 && !FSizeCastCache(cceMax)))
+    return CastChartCore(nContext, fTrue, fTrue);
+
+  // Look for this chart and settings in the cache.
+  lHash = LCastHash();
+  lKey = LCastKey(lHash);
+  ice = IceFindCast(lHash, lKey);
+  if (ice >= 0) {
+    pce = &is.rgce[ice];
+    is.cCastHit++;
+    is.nContext = nContext;
+    is.nHouseSystem = pce->is.nHouseSystem;
+    is.rOff = pce->is.rOff; is.rSid = pce->is.rSid;
+    is.JD = pce->is.JD; is.Tp = pce->is.Tp; is.T = pce->is.T;
+    is.MC = pce->is.MC; is.Asc = pce->is.Asc; is.EP = pce->is.EP;
+    is.Vtx = pce->is.Vtx; is.RA = pce->is.RA; is.OB = pce->is.OB;
+    is.rNut = pce->is.rNut;
+    cp0 = pce->cp;
+    CopyRgb((pbyte)pce->rgobjList, (pbyte)rgobjList, sizeof(rgobjList));
+    CopyRgb((pbyte)pce->rgobjList2, (pbyte)rgobjList2, sizeof(rgobjList2));
+    CopyRgb((pbyte)pce->kObjA, (pbyte)kObjA, sizeof(kObjA));
+    CopyRgb((pbyte)pce->rStarBright, (pbyte)rStarBright,
+      sizeof(rStarBright));
+    // 3D house cusps and house placements depend on the main chart's
+    // latitude, so recompute them if the chart was cast for another one.
+    if (pce->latMain != Lat)
+      ComputeInHouses();
+    return is.T;
+  }
+
+  // Not found, so cast the chart and save it in the cache, over the oldest
+  // entry if the cache is full.
+  is.cCastMiss++;
+  T = CastChartCore(nContext, fTrue, fTrue);
+  ice = is.cce < is.cceAlloc ? is.cce++ : is.cCastMiss % is.cceAlloc;
+  SaveCastEntry(ice, lHash, lKey);
+  return T;
+}
+
+
+// Return whether CastObjects() computes positions of objects the same as a
+// full CastChart() would with the current settings. Chart modifiers which
+// move planets based on other objects, and AstroExpression hooks which may
+// look at or change anything in the chart, require a full chart cast.
+
+flag FCastObjectsOk(flag fHouse)
+{
+  int i;
+
+  if (FNoTimeOrSpace(ciCore) || (us.fProgress && us.nProgress != ptCast) ||
+    us.objRot1 != us.objRot2 || us.fObjRotWhole || us.fFlip)
+    return fFalse;
+  for (i = 0; i <= is.nObj; i++)
+    if (force[i] != 0.0)
+      return fFalse;
+#ifdef SWISS
+  // Custom objects which are Arabic parts depend on the house cusps.
+  if (!fHouse)
+    for (i = custLo; i <= custHi; i++)
+      if (!ignore[i] && rgTypSwiss[i - custLo] == 5)
+        return fFalse;
+#endif
+#ifdef EXPRESS
+  if (!us.fExpOff && (FSzSet(us.szExpCast1) || FSzSet(us.szExpCast2) ||
+    FSzSet(us.szExpProg) || FSzSet(us.szExpObj) || FSzSet(us.szExpHou) ||
+    FSzSet(us.szExpSort) || FSzSet(us.szExpAsp)))
+    return fFalse;
+#endif
+  return fTrue;
+}
+
+
+// Quickly cast a chart for the current chart information, computing just
+// the positions of the unrestricted planets and other bodies, for searches
+// which cast many charts and only compare object positions. House cusps
+// (and objects based on them like the Part of Fortune) are only computed if
+// fHouse is set, and the house placements of objects are never computed.
+// Falls back to a full CastChart() when settings require it.
+
+real CastObjects(int nContext, flag fHouse)
+{
+  if (!FCastObjectsOk(fHouse))
+    return CastChart(nContext);
+  return CastChartCore(nContext, fFalse, fHouse);
+}
+
+
+// Return the tables of chart information and chart positions for each slot
+// in the chart ring, as accessed through rgpci[] and rgpcp[]. The first
+// slots are the thread local ciCore, ciMain, and cp0, so each thread has its
+// own tables pointing at its own copies of them.
+
+CI * CONST *RgpciRing(void)
+{
+  static TLOCAL CI *rgpciT[cRing+1] = {NULL,
+    NULL, &ciTwin, &ciThre, &ciFour, &ciFive, &ciHexa};
+
+  if (rgpciT[0] == NULL) {
+    rgpciT[0] = &ciCore;
+    rgpciT[1] = &ciMain;
+  }
+  return rgpciT;
+}
+
+CP * CONST *RgpcpRing(void)
+{
+  static TLOCAL CP *rgpcpT[cRing+1] = {NULL,
+    &cp1, &cp2, &cp3, &cp4, &cp5, &cp6};
+
+  if (rgpcpT[0] == NULL)
+    rgpcpT[0] = &cp0;
+  return rgpcpT;
+}
+
+
+// Set up a chart context to cast the given chart information, based on a
+// snapshot of the current settings and restrictions of the calling thread.
+
+void InitChartContext(CC *pcc, CONST CI *pci)
+{
+  pcc->ci = *pci;
+  pcc->ciMain = ciMain;
+  pcc->us = us;
+  pcc->is = is;
+  CopyRgb(ignore, pcc->ignore, sizeof(ignore));
+  CopyRgb((pbyte)force, (pbyte)pcc->force, sizeof(force));
+  ClearB((pbyte)&pcc->cp, sizeof(CP));
+}
+
+
+// Switch the working state of the calling thread to that of a context, such
+// that CastChart() will cast the context's chart with the context's settings.
+
+void UseChartContext(CONST CC *pcc)
+{
+  flag fSwissPathSet;
+
+  ciCore = pcc->ci; ciMain = pcc->ciMain;
+  us = pcc->us;
+  // Swiss Ephemeris keeps its file path separately for each thread, so
+  // whether it's been set is a property of this thread, not the context.
+  fSwissPathSet = is.fSwissPathSet;
+  is = pcc->is;
+  is.fSwissPathSet = fSwissPathSet;
+  CopyRgb(pcc->ignore, ignore, sizeof(ignore));
+  CopyRgb((pbyte)pcc->force, (pbyte)force, sizeof(force));
+}
+
+
+// Return whether charts can be cast on multiple threads at the same time
+// with the current settings. Placalc and JPL Horizons queries keep global
+// state, and AstroExpression hooks invoked during a chart cast would share
+// the same variables between threads.
+
+flag FCastThreadSafe()
+{
+#ifdef THREADS
+  int i;
+
+  if (FCmPlacalc() || us.fPlacalcAst || FCmJPLWeb())
+    return fFalse;
+#ifdef SWISS
+  for (i = custLo; i <= custHi; i++)
+    if (!ignore[i] && rgTypSwiss[i - custLo] == 4)
+      return fFalse;
+#endif
+#ifdef EXPRESS
+  if (!us.fExpOff && (FSzSet(us.szExpCast1) || FSzSet(us.szExpCast2) ||
+    FSzSet(us.szExpProg) || FSzSet(us.szExpProg0) || FSzSet(us.szExpObj) ||
+    FSzSet(us.szExpHou) || FSzSet(us.szExpSort) || FSzSet(us.szExpDecan2)))
+    return fFalse;
+#endif
+  return fTrue;
+#else
+  return fFalse;
+#endif
+}
+
+
+// Return the number of threads to split a set of jobs across, as specified
+// with the -Yx switch, in which 0 means one thread for each processor.
+
+int NThreadCount()
+{
+#ifdef THREADS
+  int cThread = us.nThread;
+#ifdef PC
+  SYSTEM_INFO si;
+#endif
+
+  if (cThread <= 0) {
+#ifdef PC
+    GetSystemInfo(&si);
+    cThread = (int)si.dwNumberOfProcessors;
+#else
+    cThread = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  }
+  return Min(Max(cThread, 1), MAXTHREADS);
+#else
+  return 1;
+#endif
+}
+
+
+#ifdef THREADS
+// State for one thread running its share of a set of jobs.
+
+typedef struct _JobThread {
+  PFNJOB pfn;       // Job function to call.
+  void *pv;         // Data passed to each job.
+  int cJob;         // Total number of jobs in the set.
+  int cThread;      // Number of threads the jobs are split across.
+  int iThread;      // This thread, which runs every cThread'th job.
+  CONST CC *pcc;    // Working state each thread starts out with.
+  CONST int *rgobjList, *rgobjList2, *kObjA;  // Calling thread's arrays.
+  CONST real *rStarBright;
+  int cAlloc, cAllocTotal, cbAllocSize;       // Allocations by this thread.
+} JT;
+
+
+// Thread procedure for a thread running jobs. Copy the working state of the
+// thread that started the jobs, run every cThread'th job, then release the
+// ephemeris files this thread opened.
+
+#ifdef PC
+DWORD WINAPI JobThreadProc(LPVOID pv)
+#else
+void *JobThreadProc(void *pv)
+#endif
+{
+  JT *pjt = (JT *)pv;
+  int iJob, cAlloc, cAllocTotal, cbAllocSize;
+
+  UseChartContext(pjt->pcc);
+  is.cce = -1;  // The cast cache belongs to the thread that started jobs.
+  cp0 = pjt->pcc->cp;
+  CopyRgb((pbyte)pjt->rgobjList, (pbyte)rgobjList, sizeof(rgobjList));
+  CopyRgb((pbyte)pjt->rgobjList2, (pbyte)rgobjList2, sizeof(rgobjList2));
+  CopyRgb((pbyte)pjt->kObjA, (pbyte)kObjA, sizeof(kObjA));
+  CopyRgb((pbyte)pjt->rStarBright, (pbyte)rStarBright, sizeof(rStarBright));
+  cAlloc = is.cAlloc; cAllocTotal = is.cAllocTotal;
+  cbAllocSize = is.cbAllocSize;
+
+  for (iJob = pjt->iThread; iJob < pjt->cJob; iJob += pjt->cThread)
+    (*pjt->pfn)(pjt->pv, iJob);
+
+  pjt->cAlloc = is.cAlloc - cAlloc;
+  pjt->cAllocTotal = is.cAllocTotal - cAllocTotal;
+  pjt->cbAllocSize = is.cbAllocSize - cbAllocSize;
+#ifdef SWISS
+  SwissClose();
+#endif
+  return 0;
+}
+#endif // THREADS
+
+
+// Run a set of jobs, calling the given function once for each job index from
+// 0 to cJob-1, splitting them across multiple threads if allowed. Each thread
+// starts with a copy of the calling thread's working state, so job functions
+// may cast charts with CastChart(), and only need to make sure they write
+// their results to different locations. Returns once all jobs are done.
+
+void RunJobs(PFNJOB pfn, void *pv, int cJob)
+{
+  int cThread, iJob;
+#ifdef THREADS
+  JT rgjt[MAXTHREADS];
+  CC *pcc;
+  int cStarted = 0, i;
+#ifdef PC
+  HANDLE rgh[MAXTHREADS];
+#else
+  pthread_t rgth[MAXTHREADS];
+#endif
+#endif
+
+  cThread = Min(NThreadCount(), cJob);
+  if (cThread > 1 && !FCastThreadSafe())
+    cThread = 1;
+#ifdef THREADS
+  if (cThread > 1) {
+    pcc = (CC *)PAllocate(sizeof(CC), "chart context");
+    if (pcc == NULL)
+      cThread = 1;
+  }
+  if (cThread > 1) {
+    InitChartContext(pcc, &ciCore);
+    pcc->cp = cp0;
+    for (i = 0; i < cThread; i++) {
+      rgjt[i].pfn = pfn; rgjt[i].pv = pv;
+      rgjt[i].cJob = cJob; rgjt[i].cThread = cThread; rgjt[i].iThread = i;
+      rgjt[i].pcc = pcc;
+      rgjt[i].rgobjList = rgobjList; rgjt[i].rgobjList2 = rgobjList2;
+      rgjt[i].kObjA = kObjA; rgjt[i].rStarBright = rStarBright;
+#ifdef PC
+      rgh[i] = CreateThread(NULL, 0, JobThreadProc, &rgjt[i], 0, NULL);
+      if (rgh[i] == NULL)
+        break;
+#else
+      if (pthread_create(&rgth[i], NULL, JobThreadProc, &rgjt[i]) != 0)
+        break;
+#endif
+      cStarted++;
+    }
+
+    // Wait for all threads to finish. If any thread couldn't be started,
+    // run its share of the jobs on this thread instead.
+    for (i = 0; i < cStarted; i++) {
+#ifdef PC
+      WaitForSingleObject(rgh[i], INFINITE);
+      CloseHandle(rgh[i]);
+#else
+      pthread_join(rgth[i], NULL);
+#endif
+      is.cAlloc += rgjt[i].cAlloc;
+      is.cAllocTotal += rgjt[i].cAllocTotal;
+      is.cbAllocSize += rgjt[i].cbAllocSize;
+    }
+    DeallocateP(pcc);
+    for (i = cStarted; i < cThread; i++)
+      for (iJob = i; iJob < cJob; iJob += cThread)
+        (*pfn)(pv, iJob);
+    return;
+  }
+#endif // THREADS
+
+  // Run all jobs in order on this thread.
+  for (iJob = 0; iJob < cJob; iJob++)
+    (*pfn)(pv, iJob);
+}
+
+
+// Charts in the chart list to cast ahead of time by PrecastCIList().
+
+typedef struct _PrecastJobs {
+  CONST int *rgici;  // Index in chart list of each chart to cast
+  CONST int *rgice;  // Entry in cast cache to save each chart in
+  dword lHash;       // Hash of settings the charts are cast with
+  flag fMain;        // Whether each chart is the main chart when cast
+} PJS;
+
+// Cast one chart in the chart list and save it in its reserved entry in the
+// cast cache, as called by RunJobs() from PrecastCIList().
+
+void PrecastJob(void *pv, int iJob)
+{
+  PJS *ppjs = (PJS *)pv;
+  CI ciCoreSav = ciCore, ciMainSav = ciMain;
+  CP cpSav = cp0;
+
+  // RunJobs() may run a job on the calling thread instead of a worker, so
+  // leave its current chart as it was found.
+  ciCore = is.rgci[ppjs->rgici[iJob]];
+  if (ppjs->fMain)
+    ciMain = ciCore;
+  CastChartCore(-1, fTrue, fTrue);
+  SaveCastEntry(ppjs->rgice[iJob], ppjs->lHash, LCastKey(ppjs->lHash));
+  ciCore = ciCoreSav; ciMain = ciMainSav;
+  cp0 = cpSav;
+}
+
+
+// Cast up to cciPrecast charts in the chart list ahead of time, splitting
+// them across multiple threads, and save them in the cast cache. When the
+// caller then casts each of them in turn with CastChart(), as when sorting or
+// filtering the chart list by AstroExpression, the results are restored from
+// the cache. The AstroExpressions themselves share the same variables, so
+// are still evaluated one chart at a time on the calling thread.
+
+void PrecastCIList(CONST int *rgici, int cici, flag fMain)
+{
+  PJS pjs;
+  CI ciCoreSav = ciCore, ciMainSav = ciMain;
+  int rgiciJob[cciPrecast], rgice[cciPrecast], i, cJob = 0;
+
+  if (cici < 2 || NThreadCount() <= 1 || !FCastThreadSafe() ||
+    !FSizeCastCache(cciPrecast + cceMax))
+    return;
+  cici = Min(cici, cciPrecast);
+  pjs.lHash = LCastHash();
+
+  // Reserve an entry in the cache for each chart not already in it. Empty
+  // the cache first if needed, so no two charts are given the same entry.
+  if (is.cce + cici > is.cceAlloc)
+    is.cce = 0;
+  for (i = 0; i < cici; i++) {
+    ciCore = is.rgci[rgici[i]];
+    if (fMain)
+      ciMain = ciCore;
+    if (!FCastCacheOk() || IceFindCast(pjs.lHash, LCastKey(pjs.lHash)) >= 0)
+      continue;
+    rgiciJob[cJob] = rgici[i];
+    rgice[cJob] = is.cce++;
+    cJob++;
+  }
+  ciCore = ciCoreSav; ciMain = ciMainSav;
+  is.cCastMiss += cJob;
+
+  pjs.rgici = rgiciJob; pjs.rgice = rgice;
+  pjs.fMain = fMain;
+  RunJobs(PrecastJob, &pjs, cJob);
+}
+
+
+// A rising or setting event found when computing Gauquelin sectors.
+
+typedef struct _SectorEvent {
+  int source;  // Planet rising or setting
+  int type;    // 1 if rising, or 2 if setting
+  real time;   // Minutes after the start of the search the event happens
+} SE;
+
 // Calculate the position of each planet with respect to the Gauquelin
 // sectors. This is used by the sector charts. Fill out the planet position
 // array where one degree means 1/10 the way across one of the 36 sectors.
 
 void CastSectors()
 {
-  int source[MAXINDAY], type[MAXINDAY], occurcount, division, div,
-    i, j, s1, s2, iSav, fSav;
-  real time[MAXINDAY], rgalt1[objMax], rgalt2[objMax],
-    azi1, azi2, alt1, alt2, mc1, mc2, d, k;
+  SE *pse, seT;
+  EL el;
+  int occurcount, division, div, i, j, s1, s2, iSav, fSav;
+  real rgalt1[objMax], rgalt2[objMax], azi1, azi2, alt1, alt2, mc1, mc2,
+    d, k;
   CP cpA, cpB;
 
   // If the -l0 approximate sectors flag is set, we can quickly get rough
@@ -1617,7 +2209,7 @@ void CastSectors()
 
   fSav = us.fSidereal; us.fSidereal = fFalse;
   division = us.nDivision * 4;
-  occurcount = 0;
+  InitEventList(&el, sizeof(SE));
 
   // Start scanning from 18 hours before to 18 hours after the time of the
   // chart in question, to find the closest rising and setting times.
@@ -1667,23 +2259,23 @@ void CastSectors()
         k = Mod(azi1 + d*MinDifference(azi1, azi2));
         j = 1 + (MinDistance(k, rDegHalf) < rDegQuad);
       }
-      if (j && occurcount < MAXINDAY) {
-        source[occurcount] = i;
-        type[occurcount] = j;
-        time[occurcount] = 36.0*((real)(div-1)+d)/(real)division*60.0;
-        occurcount++;
+      if (j) {
+        seT.source = i;
+        seT.type = j;
+        seT.time = 36.0*((real)(div-1)+d)/(real)division*60.0;
+        FAppendEvents(&el, (pbyte)&seT, 1);
       }
     }
   }
 
   // Sort each event in order of time when it happens during the day.
 
+  pse = (SE *)el.rgev;
+  occurcount = el.cev;
   for (i = 1; i < occurcount; i++) {
     j = i-1;
-    while (j >= 0 && time[j] > time[j+1]) {
-      SwapN(source[j], source[j+1]);
-      SwapN(type[j], type[j+1]);
-      SwapR(&time[j], &time[j+1]);
+    while (j >= 0 && pse[j].time > pse[j+1].time) {
+      seT = pse[j]; pse[j] = pse[j+1]; pse[j+1] = seT;
       j--;
     }
   }
@@ -1693,7 +2285,7 @@ void CastSectors()
   for (i = 0; i <= is.nObj; i++) if (!ignore[i]) {
     planet[i] = 0.0;
     // Search for the first rising or setting event of our planet.
-    for (s2 = 0; s2 < occurcount && source[s2] != i; s2++)
+    for (s2 = 0; s2 < occurcount && pse[s2].source != i; s2++)
       ;
     if (s2 == occurcount) {
 LFail:
@@ -1705,24 +2297,27 @@ LFail:
 LRetry:
     // One rising or setting event was found. Now search for the next one.
     s1 = s2;
-    for (s2 = s1 + 1; s2 < occurcount && source[s2] != i; s2++)
+    for (s2 = s1 + 1; s2 < occurcount && pse[s2].source != i; s2++)
       ;
     if (s2 == occurcount)
       goto LFail;
     // Reject the two events if either (1) they're both the same, i.e. both
     // rising or both setting, or (2) they don't bracket the chart's time.
-    if (type[s2] == type[s1] || time[s1] > 18.0*60.0 || time[s2] < 18.0*60.0)
+    if (pse[s2].type == pse[s1].type || pse[s1].time > 18.0*60.0 ||
+      pse[s2].time < 18.0*60.0)
       goto LRetry;
     // Cool, found the rising/setting bracket. The sector position is the
     // proportion the chart time is between the two event times.
-    planet[i] = (18.0*60.0 - time[s1])/(time[s2] - time[s1])*rDegHalf;
-    if (type[s1] == 2)
+    planet[i] = (18.0*60.0 - pse[s1].time)/(pse[s2].time - pse[s1].time)*
+      rDegHalf;
+    if (pse[s1].type == 2)
       planet[i] += rDegHalf;
     planet[i] = Mod(rDegMax - planet[i]);
   }
 
   // Restore original chart info since have overwritten it.
 
+  FreeEventList(&el);
   ciCore = ciMain;
   us.fSidereal = fSav;
 }
@@ -2238,6 +2833,19 @@ int NCheckEclipse(int obj1, int obj2, real *prPct)
     if (angDiff < 0.0)
       angDiff = 0.0;
   }
+  return NCheckEclipseDisks(angDiff, ang1, ang2, radi1, radi2, len1, len2,
+    prPct);
+}
+
+
+// Given the angular distance between two objects as seen from somewhere, and
+// their angular sizes, radii, and distances in km, return whether the disk
+// of one overlaps the other, and if so by what percentage of distance
+// overlap. Helper function for NCheckEclipse() and NCheckSolarShadow().
+
+int NCheckEclipseDisks(real angDiff, real ang1, real ang2, real radi1,
+  real radi2, real len1, real len2, real *prPct)
+{
   if (ang1 + ang2 <= angDiff)
     return etNone;
 
@@ -2341,55 +2949,96 @@ int NCheckEclipseAny(int obj1, int asp, int obj2, real *prEclipse)
 
 
 #ifdef SWISS
-// Check whether a solar eclipse is taking place at a particular location upon
-// the Earth. Detects partial, annular, and total solar eclipses. Called from
-// BmpDarkenKv() to darken parts on the globe that are under a solar eclipse.
+// Compute the position of the Sun as seen from a particular location upon
+// the Earth, at the time of the current chart.
 
-int NCheckEclipseSolarLoc(real lon, real lat, real *prPct)
+flag FSunFromLoc(real lon, real lat, PT3R *ppt)
 {
   CI ciSav;
-  PT3R ptSav[oMoo+1], ptDiff;
-  real obj[oMoo+1], alt[oMoo+1], r1, r2, r3, r4, r5, r6;
-  int i, et = etUndefined;
-  flag fSav1, fSav2;
+  real r1, r2, r3, r4, r5, r6;
+  flag fSav, fRet;
 
-  // Save existing chart settings to be restored later.
   ciSav = ciCore;
-  fSav1 = us.fEclipseAny; us.fEclipseAny = fFalse;
-  fSav2 = us.fTopoPos; us.fTopoPos = 2;
-  for (i = oSun; i <= oMoo; i++) {
-    ptSav[i] = space[i];
-    obj[i] = planet[i]; alt[i] = planetalt[i];
-  }
-
-  // Compute the topocentric position of the Sun at a particular location.
-  i = oSun;
+  fSav = us.fTopoPos; us.fTopoPos = 2;
   OO = lon; AA = lat;
-  if (!FSwissPlanet(i, JulianDayFromTime(is.T), us.objCenter,
-    &r1, &r2, &r3, &r4, &r5, &r6))
-    goto LDone;
-  planet[i] = Mod(r1 + is.rSid); planetalt[i] = r2;
-  SphToRec(r4, planet[i], planetalt[i],
-    &space[i].x, &space[i].y, &space[i].z);
+  fRet = FSwissPlanet(oSun, JulianDayFromTime(is.T), us.objCenter,
+    &r1, &r2, &r3, &r4, &r5, &r6);
+  if (fRet)
+    SphToRec(r4, Mod(r1 + is.rSid), r2, &ppt->x, &ppt->y, &ppt->z);
+  ciCore = ciSav;
+  us.fTopoPos = fSav;
+  return fRet;
+}
 
-  // For the Moon, for speed just apply the vector between the Sun positions.
-  i = oMoo;
-  ptDiff = space[oSun]; PtSub2(ptDiff, ptSav[oSun]);
-  PtAdd2(space[i], ptDiff);
-  RecToSph3(space[i].x, space[i].y, space[i].z, &planet[i], &planetalt[i]);
 
-  et = NCheckEclipse(oSun, oMoo, prPct);
+// Set up the geometry of a solar eclipse upon the Earth at the time of the
+// current chart, for NCheckSolarShadow() to check many locations with. The
+// Sun as seen from a location is shifted from where it's seen from the
+// Earth's center by a linear function of the location's offset from the
+// center, which can be determined by computing the Sun from four locations.
+// The Moon is shifted by the same vector as the Sun.
 
-LDone:
-  // Restore chart settings saved earlier.
-  ciCore = ciSav;
-  us.fEclipseAny = fSav1;
-  us.fTopoPos = fSav2;
-  for (i = oSun; i <= oMoo; i++) {
-    planet[i] = obj[i]; planetalt[i] = alt[i];
-    space[i] = ptSav[i];
-  }
-  return et;
+flag FInitSolarShadow(SH *psh)
+{
+  PT3R pt0, pt90, pt180, ptPole;
+  real rEqu, rPole;
+
+  if (!FSunFromLoc(0.0, 0.0, &pt0) || !FSunFromLoc(-rDegQuad, 0.0, &pt90) ||
+    !FSunFromLoc(rDegHalf, 0.0, &pt180) ||
+    !FSunFromLoc(0.0, rDegQuad, &ptPole))
+    return fFalse;
+  psh->rElv = us.elvDef / rEarthRad;
+  rEqu = 1.0 + psh->rElv;
+  rPole = 1.0 - rEarthFlat + psh->rElv;
+  psh->ptSun = pt0; PtAdd2(psh->ptSun, pt180); PtDiv(psh->ptSun, 2.0);
+  PtVec(psh->rgpt[0], pt180, pt0); PtDiv(psh->rgpt[0], rEqu * 2.0);
+  PtVec(psh->rgpt[1], psh->ptSun, pt90); PtDiv(psh->rgpt[1], rEqu);
+  PtVec(psh->rgpt[2], psh->ptSun, ptPole); PtDiv(psh->rgpt[2], rPole);
+  psh->ptMoo = space[oMoo]; PtSub2(psh->ptMoo, space[oSun]);
+  PtAdd2(psh->ptMoo, psh->ptSun);
+  psh->radiS = RObjDiam(oSun) / 2.0;
+  psh->radiM = RObjDiam(oMoo) / 2.0;
+  return fTrue;
+}
+
+
+// Check whether a solar eclipse is taking place at a particular location upon
+// the Earth, given its geometry from FInitSolarShadow(). Detects partial,
+// annular, and total solar eclipses. Called from BmpDarkenKv() to darken
+// parts on the globe that are under a solar eclipse.
+
+int NCheckSolarShadow(CONST SH *psh, real lon, real lat, real *prPct)
+{
+  PT3R ptSun, ptMoo, ptT;
+  real rSin, rCos, rN, x, y, z, len1, len2, angDiff;
+
+  // Determine offset of location from Earth's center, in Earth radii.
+  rSin = RSinD(lat); rCos = RCosD(lat);
+  rN = 1.0 / RSqr(1.0 - rEarthFlat * (2.0 - rEarthFlat) * Sq(rSin));
+  x = (rN + psh->rElv) * rCos;
+  y = -x * RSinD(lon);
+  x *= RCosD(lon);
+  z = (rN * Sq(1.0 - rEarthFlat) + psh->rElv) * rSin;
+
+  // Shift the Sun and Moon to where they're seen from the location.
+  ptT = psh->rgpt[0]; PtMul(ptT, x);
+  ptSun = psh->ptSun; PtAdd2(ptSun, ptT);
+  ptMoo = psh->ptMoo; PtAdd2(ptMoo, ptT);
+  ptT = psh->rgpt[1]; PtMul(ptT, y);
+  PtAdd2(ptSun, ptT); PtAdd2(ptMoo, ptT);
+  ptT = psh->rgpt[2]; PtMul(ptT, z);
+  PtAdd2(ptSun, ptT); PtAdd2(ptMoo, ptT);
+
+  // Compare the Sun and Moon's disks as seen from the location.
+  len1 = PtLen(ptSun);
+  len2 = PtLen(ptMoo);
+  angDiff = PtDot(ptSun, ptMoo) / (len1 * len2);
+  angDiff = RAcosD(Min(angDiff, 1.0));
+  if (us.objCenter == oEar && angDiff > 0.75)
+    return etNone;
+  len1 *= rAUToKm; len2 *= rAUToKm;
+  return NCheckEclipseDisks(angDiff, RAtnD(psh->radiS / len1),
+    RAtnD(psh->radiM / len2), psh->radiS, psh->radiM, len1, len2, prPct);
 }
 #endif
 
@@ -2568,7 +3217,7 @@ flag FSwissPlanet(int ind, real jd, int indCent,
   int iobj, iobjCent, iflag, nRet, nTyp, nPnt = 0, nFlg = 0, ix;
   double jde, xx[6], xnasc[6], xndsc[6], xperi[6], xaphe[6], *px;
   char serr[AS_MAXCH], szErr[AS_MAXCH + cchSzDef];
-  static int nSwissEph = 0;
+  static TLOCAL int nSwissEph = 0;
   flag fHelio = (indCent != oEar);
 
   // Reset Swiss Ephemeris if changing computation method.
@@ -2757,6 +3406,30 @@ flag FSwissPlanet(int ind, real jd, int indCent,
 }
 
 
+// Compute the obliquity of the ecliptic, nutation, and sidereal offset for a
+// given Julian Day time, without computing any house cusps. This returns the
+// same values SwissHouse() does, for charts which only want planets.
+
+void SwissChartVars(real jd, real *ob, real *off, real *nut)
+{
+  double eps, nutlo[2], tjde;
+
+  jd = JulianDayFromTime(jd);
+  if (jd != is.jdDeltaT) {
+    is.jdDeltaT = jd;
+    is.rDeltaT = swe_deltat(jd);
+  }
+  tjde = jd + (us.rDeltaT == rInvalid ? is.rDeltaT : us.rDeltaT/86400.0);
+  eps = swi_epsiln(tjde, 0) * RADTODEG;
+  swi_nutation(tjde, 0, nutlo);
+  *off = -swe_get_ayanamsa(tjde);
+  is.rSid = (us.fSidereal ? *off + us.rZodiacOffset : 0.0) +
+    us.rZodiacOffsetAll;
+  *ob  = eps;
+  *nut = nutlo[0] * RADTODEG;
+}
+
+
 // Compute house cusps and related variables like the Ascendant. Given a
 // Julian Day time, location, and house system, call Swiss Ephemeris to
 // compute them. This is similar to FSwissPlanet() in that it knows about
@@ -2950,13 +3623,14 @@ flag SwissComputeStar(real jd, ES *pes)
 {
   char serr[AS_MAXCH], *pch, *pchT, chT;
   int iflag, isz = 0, i;
-  double xx[6], dist1, dist2;
-  static real lonPrev = 0.0, latPrev = 0.0;
-  static int istar = 1;
+  double *xx, dist1, dist2;
+  static real lonPrev = 0.0, latPrev = 0.0, jdStar = 0.0;
+  static int istar = 1, cstar = -1;
 
   // Calling with empty parameters means initialize to first star.
   if (pes == NULL) {
     istar = 1;
+    cstar = -1;
 #ifdef GRAPH
     if (gi.rges != NULL)
       ClearB((pbyte)gi.rges, sizeof(ES) * gi.cStarsLin);
@@ -2980,18 +3654,40 @@ flag SwissComputeStar(real jd, ES *pes)
     iflag |= SEFLG_TRUEPOS;
   if (us.fNoNutation)
     iflag |= SEFLG_NONUT;
-LNext:
-  sprintf(pes->sz, "%d", istar);
 
-  // Compute the star coordinates and get the star's brightness.
-  if (us.fStarMagDist) {
-    if (swe_fixstar2(pes->sz, rJD2000,
-      SEFLG_SPEED | SEFLG_SWIEPH | SEFLG_HELCTR, xx, serr) < 0)
+  // Compute all the stars at once the first time through, since the
+  // frame of reference for the date only needs to be set up once.
+  if (cstar < 0 || jd != jdStar) {
+    cstar = swe_fixstar2_batch(1, 0, jd, iflag, NULL, serr);
+    if (cstar <= 0)
+      return fFalse;
+    if (cstar > is.cxxStar) {
+      if (is.rgxxStar != NULL)
+        DeallocateP(is.rgxxStar);
+      is.rgxxStar = RgAllocate(cstar * 12, real, "star positions");
+      is.cxxStar = 0;
+      if (is.rgxxStar == NULL)
+        return fFalse;
+      is.cxxStar = cstar;
+    }
+    if (us.fStarMagDist && swe_fixstar2_batch(1, cstar, rJD2000,
+      SEFLG_SPEED | SEFLG_SWIEPH | SEFLG_HELCTR, is.rgxxStar + cstar*6,
+      serr) < 0)
       return fFalse;
-    dist1 = xx[2];
+    cstar = swe_fixstar2_batch(1, cstar, jd, iflag, is.rgxxStar, serr);
+    if (cstar < 0)
+      return fFalse;
+    jdStar = jd;
   }
-  if (swe_fixstar2(pes->sz, jd, iflag, xx, serr) < 0)
+LNext:
+  if (istar > cstar)
     return fFalse;
+  sprintf(pes->sz, "%d", istar);
+
+  // Get the star coordinates and the star's brightness.
+  if (us.fStarMagDist)
+    dist1 = is.rgxxStar[(cstar + istar-1)*6 + 2];
+  xx = &is.rgxxStar[(istar-1)*6];
   pes->lon = Mod(xx[0] + (us.fSidereal ? us.rZodiacOffset : 0.0) +
     us.rZodiacOffsetAll);
   pes->lat = xx[1];
@@ -3207,6 +3903,24 @@ flag SwissTestStar(char *sz)
 }
 
 
+// Compile sefstars.txt into the binary star catalog sefstars.bin, written to
+// the same directory. Swiss Ephemeris loads the binary file when present,
+// which is much faster than parsing the text file each run.
+
+flag FSwissCompileStars()
+{
+  char serr[AS_MAXCH], sz[cchSzMax];
+
+  SwissEnsurePath();
+  if (swe_fixstar2_write_bin(NULL, serr) < 0) {
+    sprintf(sz, "%s", serr);
+    PrintError(sz);
+    return fFalse;
+  }
+  return fTrue;
+}
+
+
 #ifdef GRAPH
 // Compute one asteroid location. Given an asteroid number and time, call
 // Swiss Ephemeris to compute it. This is similar to SwissComputeStar().
@@ -3507,6 +4221,15 @@ real SwissLatLmt(real jd)
 }
 
 
+// Wrapper around Swiss Ephemeris function to close ephemeris files and free
+// memory, which are kept separately for each thread.
+
+void SwissClose()
+{
+  swe_close();
+}
+
+
 // Wrappers around Swiss Ephemeris Julian Day conversion routines.
 
 real SwissJulDay(int month, int day, int year, real hour, int gregflag)
@@ -602,6 +602,7 @@ void DisplaySwitchesRare(void)
   PrintS(" _Yv: Display distance in metric instead of imperial units.");
   PrintS(" _Yr: Round positions to nearest unit instead of crop fraction.");
   PrintS(" _Yw <num>: Set velocity for planets to be considered stationary.");
+  PrintS(" _YN: Refine times of events found by _d by solving for them.");
   PrintS(" _YC: Automatically ignore insignificant house cusp aspects.");
   PrintS(" _YO: Automatically adjust settings when exporting and printing.");
   PrintS(" _Y8: Clip text charts at the rightmost (e.g. 80th) column.");
@@ -665,6 +666,9 @@ void DisplaySwitchesRare(void)
   PrintS(
     " _YUb0: Set brightness to distance independent absolute magnitude.");
   PrintS(" _YUx <exolist>: Set filter string of exoplanet names.");
+#ifdef SWISS
+  PrintS(" _YUc: Compile sefstars.txt into faster loading sefstars.bin.");
+#endif
   PrintS(" _YS <obj> <size>: Set diameter of object to be specified size.");
   PrintS(
     " _YR <obj1> <obj2> <flag1>..<flag2>: Set restrictions for object range.");
@@ -767,6 +771,7 @@ void DisplaySwitchesRare(void)
   PrintS(" _YXU1: Set lines to depict all 88 astronomical constellations.");
 #endif
   PrintS(" _YXW <num>: Draw triangles or cubes grid over world maps.");
+  PrintS(" _YXz <0-9>: Set compression level of PNG bitmap files.");
   PrintS(
     " _YXf <0-d><0-d><0-d><0-d><0-d><0-d>: Set font usage in graphic charts");
   PrintS("  for text, signs, houses, planets, aspects, and Nakshatras.");
@@ -777,6 +782,7 @@ void DisplaySwitchesRare(void)
   PrintS("\nSwitches to access obscure system options:");
   PrintS(" _YB: Make a beep sound at the time this switch is processed.");
   PrintS(" _Y0: Disable all chart text output.");
+  PrintS(" _Yx <threads>: Set threads to search with, or 0 for all CPUs.");
   PrintS(
     " _Y5[2-4]: Enumerate all charts in chart list via ~5Y AstroExpression.");
   PrintS(" _Y5i <string>: Set filter string for ADB XML file format load.");
@@ -787,6 +793,7 @@ void DisplaySwitchesRare(void)
   PrintS(" _YY2 <zones> <entries>: Load time zone change lists from file.");
   PrintS(
     " _YY3 <rows>: Load atlas time zone to zone change mappings from file.");
+  PrintS(" _YYc: Save atlas and time zones as faster loading .bin snapshots.");
   PrintS(" _YYt <text>: Output formatted text string in current context.");
   PrintS(" _YYT <text>: Popup formatted text string in current context.");
   PrintS(" _YYI <text>: Output text string in interpretation context.");
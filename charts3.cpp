@@ -236,394 +236,656 @@ void PrintInDays(InDayInfo *pid, int occurcount, int counttotal, flag fProg)
 }
 
 
-// Search through a day or longer period, and print out the times of exact
-// aspects among planets during that day, as specified with the -d switch,
-// as well as times when planets changes sign or direction. To do this, cast
-// charts for the beginning and end of the day (or a part of a day) and do a
-// linear equation check to see if anything happens during the interval.
+// Cast the chart for a time within a day being searched for events by the
+// -d switch, which may be a progressed chart, leaving the positions in cp0.
+// Only object positions are computed, along with house cusps if they're
+// searched too.
 
-void ChartInDaySearch(flag fProg)
+void CastInDay(int mon, int day, int yea, real hrs, flag fProg)
 {
-  InDayInfo id[MAXINDAY], idT, *pid = id;
-  int yea0, yea1, yea2, mon0, mon1, mon2, day0, day1, day2, counttotal = 0,
-    occurcount, maxinday = MAXINDAY, division, div, divSign,
-    i, j, k, l, s1, s2;
-  real divsiz, d1, d2, e1, e2, f1, f2, g;
-  flag fYear, fVoid, fPrint = fTrue;
-  CP cpA, cpB;
+  SetCI(ciCore, mon, day, yea, hrs, Dst, Zon, Lon, Lat);
+  if (fProg) {
+    is.JDp = MdytszToJulian(mon, day, yea, TT, Dst, Zon);
+    ciCore = ciMain;
+  }
+  CastObjects(-1, fProg || us.fGraphAll);
+}
 
-  // If parameter 'fProg' is set, look for changes in a progressed chart.
 
-#ifdef GRAPH
-  fPrint &= (RgzCalendar() == NULL);
-#endif
-  fYear = us.fInDayMonth && us.fInDayYear;
-  fVoid = !FIgnore(oMoo) && !us.fIgnoreSign && us.fInDayMonth;
-  division = (fYear || fProg) ? (us.nDivision + 9) / 10 : us.nDivision;
-  divsiz = 24.0 / (real)division*60.0;
-  divSign = cSign * us.nSignDiv;
-  if (us.fListAuto)
-    is.cci = 0;
+// Return the declination (or latitude, if -sr0 is in effect) of an object
+// in a chart, as compared for parallel aspects in the -d switch.
 
-  // If -dY in effect, then search through a range of years.
+real RInDayDecl(CONST CP *pcp, int obj)
+{
+  real lon = pcp->obj[obj], lat = pcp->alt[obj];
 
-  yea1 = yea2 = !fProg ? Yea : YeaT;
-  if (fYear && us.nEphemYears != 0) {
-    if (us.nEphemYears < 0)
-      yea1 += (us.nEphemYears + 1);
-    else
-      yea2 += (us.nEphemYears - 1);
+  if (!us.fEquator2 && !us.fParallel2)
+    EclToEqu(&lon, &lat);
+  else if (us.fEquator2 && us.fParallel2)
+    EquToEcl(&lon, &lat);
+  return lat;
+}
+
+
+// Return the value of a function of a chart, which crosses zero at the time
+// the given event found by the -d switch takes place. For sign and degree
+// changes rTarget is the longitude crossed, and for aspects it's the offset
+// between the two planets at which the aspect is exact.
+
+real RInDayEvent(CONST CP *pcp, CONST InDayInfo *pid, real rTarget)
+{
+  int i = pid->source, j = pid->dest;
+  real r;
+
+  switch (pid->aspect) {
+  case aSig:
+  case aDeg: return MinDifference(rTarget, pcp->obj[i]);
+  case aDir: return pcp->dir[i];
+  case aAlt: return pcp->diralt[i];
+  case aLen: return pcp->dirlen[i];
+  case aNod: return pcp->alt[i];
+  case aDis: return pcp->dist[i] - pcp->dist[j];
   }
-  for (yea0 = yea1; yea0 <= yea2; yea0++) {
+  if (!us.fParallel)
+    return MinDifference(Mod(pcp->obj[i] + rTarget), pcp->obj[j]);
+  r = RInDayDecl(pcp, j);
+  return RInDayDecl(pcp, i) - (pid->aspect == aOpp ? -r : r);
+}
 
-  // If -dy in effect, then search through the whole year, month by month.
 
-  if (fYear) {
-    mon1 = 1; mon2 = 12;
-  } else
-    mon1 = mon2 = !fProg ? Mon : MonT;
+// Refine the time of an event found by the -d switch within the segment of
+// a day between the two given charts, which was estimated by assuming the
+// planets move linearly within the segment. Iterate toward when the event's
+// function crosses zero, using the false position method with the Illinois
+// modification, which converges about as fast as the secant method while
+// always keeping the root bracketed. Only the objects involved in the event
+// are computed, and the current chart is left as it was.
 
-  // Start searching the month or months in question for exciting events.
+void RefineInDayEvent(InDayInfo *pid, CONST CP *pcpA, CONST CP *pcpB,
+  real tA, real tB, flag fProg)
+{
+  int i = pid->source, j = pid->dest, s1, s2, nSide = 0, n, k;
+  real rTarget = 0.0, fA, fB, f, t = pid->time, tPrev, JDpSav;
+  byte ignoreSav[objMax];
+  flag fTwo = (pid->aspect > 0 || pid->aspect == aDis);
+  CI ciSav;
+  CP cpSav;
+
+  // Determine longitude crossed, or which side of the aspect is being made.
+  if (pid->aspect == aSig) {
+    s1 = SFromZ(pcpA->obj[i])-1;
+    s2 = SFromZ(pcpB->obj[i])-1;
+    rTarget = (real)(pcpA->dir[i] >= 0.0 ? s2 : s1) * 30.0;
+  } else if (pid->aspect == aDeg)
+    rTarget = (real)j * (rDegMax / (real)(cSign * us.nSignDiv));
+  else if (pid->aspect > 0 && !us.fParallel) {
+    rTarget = rAspAngle[pid->aspect];
+    fA = RInDayEvent(pcpA, pid, -rTarget);
+    fB = RInDayEvent(pcpB, pid, -rTarget);
+    if (RSgn(fA) != RSgn(fB) && RAbs(fA) < rDegQuad && RAbs(fB) < rDegQuad)
+      neg(rTarget);
+  }
+  fA = RInDayEvent(pcpA, pid, rTarget);
+  fB = RInDayEvent(pcpB, pid, rTarget);
+  if (RSgn(fA) == RSgn(fB) || RAbs(fA - fB) >= rDegHalf)
+    return;
+
+  // Restrict all other objects while casting charts within the segment.
+  ciSav = ciCore; cpSav = cp0; JDpSav = is.JDp;
+  CopyRgb(ignore, ignoreSav, sizeof(ignore));
+  for (k = 0; k <= is.nObj; k++)
+    ignore[k] = (k != i && !(fTwo && k == j));
+
+  // Iterate until the time is known to within a fraction of a second.
+  for (n = 0; n < 25; n++) {
+    tPrev = t;
+    t = (tA*fB - tB*fA) / (fB - fA);
+    CastInDay(pid->mon, pid->day, pid->yea, t / 60.0, fProg);
+    f = RInDayEvent(&cp0, pid, rTarget);
+    if (f == 0.0)
+      break;
+    if (RSgn(f) == RSgn(fB)) {
+      tB = t; fB = f;
+      if (nSide > 0)
+        fA /= 2.0;
+      nSide = 1;
+    } else {
+      tA = t; fA = f;
+      if (nSide < 0)
+        fB /= 2.0;
+      nSide = -1;
+    }
+    if (tB - tA < 1.0/600.0 || (n > 0 && RAbs(t - tPrev) < 1.0/600.0))
+      break;
+  }
+  pid->time = t;
+
+  // Update positions of the planets to those at the refined time.
+  switch (pid->aspect) {
+  case aSig:
+  case aDeg:
+    break;
+  case aAlt:
+    pid->pos1 = pid->pos2 = cp0.alt[i];
+    break;
+  case aDir:
+  case aLen:
+  case aNod:
+    pid->pos1 = pid->pos2 = cp0.obj[i];
+    break;
+  default:
+    if (pid->aspect > 0 && us.fParallel) {
+      pid->pos1 = RInDayDecl(&cp0, i);
+      pid->pos2 = RInDayDecl(&cp0, j);
+      pid->ret1 = cp0.diralt[i];
+      pid->ret2 = cp0.diralt[j];
+    } else {
+      pid->pos1 = cp0.obj[i];
+      pid->pos2 = cp0.obj[j];
+      pid->ret1 = cp0.dir[i];
+      pid->ret2 = cp0.dir[j];
+    }
+  }
+  CopyRgb(ignoreSav, ignore, sizeof(ignore));
+  ciCore = ciSav; cp0 = cpSav; is.JDp = JDpSav;
+}
 
-  for (mon0 = mon1; mon0 <= mon2; mon0++) {
-    if (us.fInDayMonth) {
-      day1 = 1;
-      day2 = DayInMonth(mon0, yea0);
-    } else
-      day1 = day2 = !fProg ? Day : DayT;
 
-  // Start searching the day or days in question for exciting events.
+// Ensure there's room for another event in a list of events found by the -d
+// switch, which already contains the given number of events, and return
+// where the list is in case it was moved to grow it.
 
-  for (day0 = day1; day0 <= day2; day0 = AddDay(mon0, day0, yea0, 1)) {
-    occurcount = 0;
-    maxinday = MAXINDAY - (int)(pid - id);
+flag FEnsureInDay(EL *pel, int cev, InDayInfo **ppid)
+{
+  pel->cev = cev;
+  if (!FEnsureEvents(pel, cev + 1))
+    return fFalse;
+  *ppid = (InDayInfo *)pel->rgev;
+  return fTrue;
+}
 
-    // Cast chart for beginning of day and store it for future use.
 
-    SetCI(ciCore, mon0, day0, yea0, 0.0, Dst, Zon, Lon, Lat);
-    us.fProgress = fProg;
-    if (fProg) {
-      is.JDp = MdytszToJulian(mon0, day0, yea0, 0.0, Dst, Zon);
-      ciCore = ciMain;
-    }
-    CastChart(-1);
-    cpB = cp0;
+// Search one day for exact aspects and other events, as part of the -d
+// switch. Cast charts for the beginning and end of each part of the day, and
+// do a linear equation check to see if anything happens during the interval.
+// The list is emptied, events are stored in it in the order found, and the
+// number found is returned.
 
-    // Now divide the day into segments and search each segment in turn.
-    // More segments is slower, but has slightly better time accuracy.
+int NInDaySearchDay(EL *pel, int mon0, int day0, int yea0, int division,
+  flag fProg)
+{
+  InDayInfo *pid = (InDayInfo *)pel->rgev;
+  int occurcount = 0, occurdiv, div, divSign, i, j, k, l, s1, s2;
+  real divsiz, d1, d2, e1, e2, f1, f2, g;
+  CP cpA, cpB;
 
-    for (div = 1; div <= division; div++) {
+  divsiz = 24.0 / (real)division*60.0;
+  divSign = cSign * us.nSignDiv;
 
-      // Cast the chart for the ending time of the present segment. The
-      // beginning time chart is copied from the previous end time chart.
+  // Cast chart for beginning of day and store it for future use.
 
-      SetCI(ciCore, mon0, day0, yea0,
-        24.0*(real)div/(real)division, Dst, Zon, Lon, Lat);
-      if (fProg) {
-        is.JDp = MdytszToJulian(mon0, day0, yea0, TT, Dst, Zon);
-        ciCore = ciMain;
-      }
-      CastChart(-1);
-      cpA = cpB; cpB = cp0;
+  us.fProgress = fProg;
+  CastInDay(mon0, day0, yea0, 0.0, fProg);
+  cpB = cp0;
 
-      // Now search through the present segment for anything exciting.
+  // Now divide the day into segments and search each segment in turn.
+  // More segments is slower, but has slightly better time accuracy.
 
-      for (i = 0; i <= is.nObj; i++)
-        if (!FIgnore(i) && (fProg || us.fGraphAll || FThing(i))) {
-        s1 = SFromZ(cpA.obj[i])-1;
-        s2 = SFromZ(cpB.obj[i])-1;
+  for (div = 1; div <= division; div++) {
 
-        // Does the current planet change into the next or previous sign?
+    // Cast the chart for the ending time of the present segment. The
+    // beginning time chart is copied from the previous end time chart.
 
-        if (!us.fIgnoreSign && FAllow(i) && occurcount < maxinday) {
-          l = NAbs(s1-s2);
-          if (s1 != s2 && (l == 1 || l == cSign-1)) {
-            pid[occurcount].source = i;
-            pid[occurcount].aspect = aSig;
-            pid[occurcount].dest = s2+1;
-            pid[occurcount].time = MinDistance(cpA.obj[i],
-              (real)(cpA.dir[i] >= 0.0 ? s2 : s1) * 30.0) / MinDistance(
-              cpA.obj[i], cpB.obj[i])*divsiz + (real)(div-1)*divsiz;
-            pid[occurcount].pos1 = pid[occurcount].pos2 = ZFromS(s1+1);
-            pid[occurcount].ret1 = cpA.dir[i];
-            pid[occurcount].ret2 = cpB.dir[i];
-            pid[occurcount].mon = mon0;
-            pid[occurcount].day = day0;
-            pid[occurcount].yea = yea0;
-            occurcount++;
+    CastInDay(mon0, day0, yea0, 24.0*(real)div/(real)division, fProg);
+    cpA = cpB; cpB = cp0;
+    occurdiv = occurcount;
 
-          // Does the current planet change into next or previous degree?
-
-          } else if (us.nSignDiv > 1) {
-            j = (int)(cpA.obj[i] / (rDegMax / (real)divSign));
-            k = (int)(cpB.obj[i] / (rDegMax / (real)divSign));
-            l = NAbs(j-k);
-            if (j != k && (l == 1 || l == divSign-1)) {
-              l = k;
-              if (j == k+1 || j == k-(divSign-1))
-                l = j;
-              pid[occurcount].source = i;
-              pid[occurcount].aspect = aDeg;
-              pid[occurcount].dest = l;
-              pid[occurcount].time = MinDistance(cpA.obj[i],
-                (real)l * (rDegMax / (real)divSign)) / MinDistance(cpA.obj[i],
-                cpB.obj[i])*divsiz + (real)(div-1)*divsiz;
-              pid[occurcount].pos1 = pid[occurcount].pos2 = cpA.obj[i];
-              pid[occurcount].ret1 = pid[occurcount].ret2 =
-                (l == k) ? 1.0 : -1.0;
-              pid[occurcount].mon = mon0;
-              pid[occurcount].day = day0;
-              pid[occurcount].yea = yea0;
-              occurcount++;
-            }
-          }
-        }
+    // Now search through the present segment for anything exciting.
 
-        // Does the current planet go retrograde or direct?
+    for (i = 0; i <= is.nObj; i++)
+      if (!FIgnore(i) && (fProg || us.fGraphAll || FThing(i))) {
+      s1 = SFromZ(cpA.obj[i])-1;
+      s2 = SFromZ(cpB.obj[i])-1;
 
-        if (!us.fIgnoreDir && (cpA.dir[i] < 0.0) != (cpB.dir[i] < 0.0) &&
-          FAllow(i) && occurcount < maxinday) {
+      // Does the current planet change into the next or previous sign?
+
+      if (!us.fIgnoreSign && FAllow(i) && FEnsureInDay(pel, occurcount, &pid)) {
+        l = NAbs(s1-s2);
+        if (s1 != s2 && (l == 1 || l == cSign-1)) {
           pid[occurcount].source = i;
-          pid[occurcount].aspect = aDir;
-          pid[occurcount].dest = cpB.dir[i] < 0.0;
-          pid[occurcount].time = RAbs(cpA.dir[i])/(RAbs(cpA.dir[i])+
-            RAbs(cpB.dir[i]))*divsiz + (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            RAbs(cpA.dir[i])/(RAbs(cpA.dir[i])+RAbs(cpB.dir[i])) *
-            (cpB.obj[i]-cpA.obj[i]) + cpA.obj[i];
-          pid[occurcount].ret1 = pid[occurcount].ret2 = 0.0;
+          pid[occurcount].aspect = aSig;
+          pid[occurcount].dest = s2+1;
+          pid[occurcount].time = MinDistance(cpA.obj[i],
+            (real)(cpA.dir[i] >= 0.0 ? s2 : s1) * 30.0) / MinDistance(
+            cpA.obj[i], cpB.obj[i])*divsiz + (real)(div-1)*divsiz;
+          pid[occurcount].pos1 = pid[occurcount].pos2 = ZFromS(s1+1);
+          pid[occurcount].ret1 = cpA.dir[i];
+          pid[occurcount].ret2 = cpB.dir[i];
           pid[occurcount].mon = mon0;
           pid[occurcount].day = day0;
           pid[occurcount].yea = yea0;
           occurcount++;
-        }
 
-        // Does the current planet reach maximum or minimum latitude?
+        // Does the current planet change into next or previous degree?
 
-        if (!us.fIgnoreDiralt && (cpA.diralt[i] < 0.0) != (cpB.diralt[i] < 0.0)
-          && FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aAlt;
-          pid[occurcount].dest = cpB.diralt[i] < 0.0;
-          pid[occurcount].time = RAbs(cpA.diralt[i])/(RAbs(cpA.diralt[i])+
-            RAbs(cpB.diralt[i]))*divsiz + (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            RAbs(cpA.diralt[i])/(RAbs(cpA.diralt[i])+RAbs(cpB.diralt[i])) *
-            (cpB.alt[i]-cpA.alt[i]) + cpA.alt[i];
-          pid[occurcount].ret1 = cpA.dir[i]; pid[occurcount].ret2 = cpB.dir[i];
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
+        } else if (us.nSignDiv > 1) {
+          j = (int)(cpA.obj[i] / (rDegMax / (real)divSign));
+          k = (int)(cpB.obj[i] / (rDegMax / (real)divSign));
+          l = NAbs(j-k);
+          if (j != k && (l == 1 || l == divSign-1)) {
+            l = k;
+            if (j == k+1 || j == k-(divSign-1))
+              l = j;
+            pid[occurcount].source = i;
+            pid[occurcount].aspect = aDeg;
+            pid[occurcount].dest = l;
+            pid[occurcount].time = MinDistance(cpA.obj[i],
+              (real)l * (rDegMax / (real)divSign)) / MinDistance(cpA.obj[i],
+              cpB.obj[i])*divsiz + (real)(div-1)*divsiz;
+            pid[occurcount].pos1 = pid[occurcount].pos2 = cpA.obj[i];
+            pid[occurcount].ret1 = pid[occurcount].ret2 =
+              (l == k) ? 1.0 : -1.0;
+            pid[occurcount].mon = mon0;
+            pid[occurcount].day = day0;
+            pid[occurcount].yea = yea0;
+            occurcount++;
+          }
         }
+      }
 
-        // Does the current planet reach maximum or minimum distance?
+      // Does the current planet go retrograde or direct?
+
+      if (!us.fIgnoreDir && (cpA.dir[i] < 0.0) != (cpB.dir[i] < 0.0) &&
+        FAllow(i) && FEnsureInDay(pel, occurcount, &pid)) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aDir;
+        pid[occurcount].dest = cpB.dir[i] < 0.0;
+        pid[occurcount].time = RAbs(cpA.dir[i])/(RAbs(cpA.dir[i])+
+          RAbs(cpB.dir[i]))*divsiz + (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          RAbs(cpA.dir[i])/(RAbs(cpA.dir[i])+RAbs(cpB.dir[i])) *
+          (cpB.obj[i]-cpA.obj[i]) + cpA.obj[i];
+        pid[occurcount].ret1 = pid[occurcount].ret2 = 0.0;
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
 
-        if (!us.fIgnoreDirlen && (cpA.dirlen[i] < 0.0) != (cpB.dirlen[i] < 0.0)
-          && FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aLen;
-          pid[occurcount].dest = (cpB.dirlen[i] < 0.0);
-          pid[occurcount].time = RAbs(cpA.dirlen[i])/(RAbs(cpA.dirlen[i])+
-            RAbs(cpB.dirlen[i]))*divsiz + (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            RAbs(cpA.dirlen[i])/(RAbs(cpA.dirlen[i])+RAbs(cpB.dirlen[i])) *
-            (cpB.obj[i]-cpA.obj[i]) + cpA.obj[i];
-          pid[occurcount].ret1 = cpA.dir[i]; pid[occurcount].ret2 = cpB.dir[i];
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
-        }
+      // Does the current planet reach maximum or minimum latitude?
+
+      if (!us.fIgnoreDiralt && (cpA.diralt[i] < 0.0) != (cpB.diralt[i] < 0.0)
+        && FAllow(i) && FEnsureInDay(pel, occurcount, &pid)) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aAlt;
+        pid[occurcount].dest = cpB.diralt[i] < 0.0;
+        pid[occurcount].time = RAbs(cpA.diralt[i])/(RAbs(cpA.diralt[i])+
+          RAbs(cpB.diralt[i]))*divsiz + (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          RAbs(cpA.diralt[i])/(RAbs(cpA.diralt[i])+RAbs(cpB.diralt[i])) *
+          (cpB.alt[i]-cpA.alt[i]) + cpA.alt[i];
+        pid[occurcount].ret1 = cpA.dir[i]; pid[occurcount].ret2 = cpB.dir[i];
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
 
-        // Does the current planet cross zero latitude?
+      // Does the current planet reach maximum or minimum distance?
+
+      if (!us.fIgnoreDirlen && (cpA.dirlen[i] < 0.0) != (cpB.dirlen[i] < 0.0)
+        && FAllow(i) && FEnsureInDay(pel, occurcount, &pid)) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aLen;
+        pid[occurcount].dest = (cpB.dirlen[i] < 0.0);
+        pid[occurcount].time = RAbs(cpA.dirlen[i])/(RAbs(cpA.dirlen[i])+
+          RAbs(cpB.dirlen[i]))*divsiz + (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          RAbs(cpA.dirlen[i])/(RAbs(cpA.dirlen[i])+RAbs(cpB.dirlen[i])) *
+          (cpB.obj[i]-cpA.obj[i]) + cpA.obj[i];
+        pid[occurcount].ret1 = cpA.dir[i]; pid[occurcount].ret2 = cpB.dir[i];
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
 
-        if (!us.fIgnoreAlt0 && ((cpA.alt[i] < 0.0 && cpB.alt[i] >= 0.0) ||
-          (cpA.alt[i] >= 0.0 && cpB.alt[i] < 0.0)) &&
-          FAllow(i) && occurcount < maxinday) {
-          pid[occurcount].source = i;
-          pid[occurcount].aspect = aNod;
-          pid[occurcount].dest = (cpA.alt[i] >= 0.0);
-          pid[occurcount].time = cpA.alt[i]/(cpA.alt[i]-cpB.alt[i])*divsiz +
-            (real)(div-1)*divsiz;
-          pid[occurcount].pos1 = pid[occurcount].pos2 =
-            Mod(cpA.obj[i] + cpA.alt[i]/(cpA.alt[i]-cpB.alt[i]) *
-            MinDifference(cpA.obj[i], cpB.obj[i]));
-          pid[occurcount].ret1 = cpA.dir[i]; pid[occurcount].ret2 = cpB.dir[i];
-          pid[occurcount].mon = mon0;
-          pid[occurcount].day = day0;
-          pid[occurcount].yea = yea0;
-          occurcount++;
-        }
+      // Does the current planet cross zero latitude?
+
+      if (!us.fIgnoreAlt0 && ((cpA.alt[i] < 0.0 && cpB.alt[i] >= 0.0) ||
+        (cpA.alt[i] >= 0.0 && cpB.alt[i] < 0.0)) &&
+        FAllow(i) && FEnsureInDay(pel, occurcount, &pid)) {
+        pid[occurcount].source = i;
+        pid[occurcount].aspect = aNod;
+        pid[occurcount].dest = (cpA.alt[i] >= 0.0);
+        pid[occurcount].time = cpA.alt[i]/(cpA.alt[i]-cpB.alt[i])*divsiz +
+          (real)(div-1)*divsiz;
+        pid[occurcount].pos1 = pid[occurcount].pos2 =
+          Mod(cpA.obj[i] + cpA.alt[i]/(cpA.alt[i]-cpB.alt[i]) *
+          MinDifference(cpA.obj[i], cpB.obj[i]));
+        pid[occurcount].ret1 = cpA.dir[i]; pid[occurcount].ret2 = cpB.dir[i];
+        pid[occurcount].mon = mon0;
+        pid[occurcount].day = day0;
+        pid[occurcount].yea = yea0;
+        occurcount++;
+      }
 
-        // Now search for anything making an aspect to the current planet.
+      // Now search for anything making an aspect to the current planet.
 
-        for (j = i+1; j <= is.nObj; j++)
-          if (!FIgnore(j) && (fProg || us.fGraphAll || FThing(j))) {
-          if (!us.fParallel) {
+      for (j = i+1; j <= is.nObj; j++)
+        if (!FIgnore(j) && (fProg || us.fGraphAll || FThing(j))) {
+        if (!us.fParallel) {
 
-          for (k = 1; k <= us.nAsp; k++) if (FAcceptAspect(i, -k, j)) {
-            d1 = cpA.obj[i]; d2 = cpB.obj[i];
-            e1 = cpA.obj[j]; e2 = cpB.obj[j];
-            if (MinDistance(d1, d2) < MinDistance(e1, e2)) {
-              SwapR(&d1, &e1);
-              SwapR(&d2, &e2);
-            }
+        for (k = 1; k <= us.nAsp; k++) if (FAcceptAspect(i, -k, j)) {
+          d1 = cpA.obj[i]; d2 = cpB.obj[i];
+          e1 = cpA.obj[j]; e2 = cpB.obj[j];
+          if (MinDistance(d1, d2) < MinDistance(e1, e2)) {
+            SwapR(&d1, &e1);
+            SwapR(&d2, &e2);
+          }
 
-            // Search each potential aspect in turn. First subtract the size
-            // of the aspect from the angular difference, so can then treat it
-            // like a conjunction.
+          // Search each potential aspect in turn. First subtract the size
+          // of the aspect from the angular difference, so can then treat it
+          // like a conjunction.
 
-            if (MinDistance(e1, Mod(d1-rAspAngle[k])) <
-                MinDistance(e2, Mod(d2+rAspAngle[k]))) {
-              e1 = Mod(e1+rAspAngle[k]);
-              e2 = Mod(e2+rAspAngle[k]);
-            } else {
-              e1 = Mod(e1-rAspAngle[k]);
-              e2 = Mod(e2-rAspAngle[k]);
-            }
+          if (MinDistance(e1, Mod(d1-rAspAngle[k])) <
+              MinDistance(e2, Mod(d2+rAspAngle[k]))) {
+            e1 = Mod(e1+rAspAngle[k]);
+            e2 = Mod(e2+rAspAngle[k]);
+          } else {
+            e1 = Mod(e1-rAspAngle[k]);
+            e2 = Mod(e2-rAspAngle[k]);
+          }
 
-            // Check to see if the aspect actually occurs during this segment,
-            // making sure to take into account if one or both planets are
-            // retrograde or if they cross the Aries point.
+          // Check to see if the aspect actually occurs during this segment,
+          // making sure to take into account if one or both planets are
+          // retrograde or if they cross the Aries point.
+
+          f1 = e1-d1;
+          if (RAbs(f1) > rDegHalf)
+            f1 -= RSgn(f1)*rDegMax;
+          f2 = e2-d2;
+          if (RAbs(f2) > rDegHalf)
+            f2 -= RSgn(f2)*rDegMax;
+          if (MinDistance(Midpoint(d1, d2), Midpoint(e1, e2)) < rDegQuad &&
+            RSgn(f1) != RSgn(f2) && FEnsureInDay(pel, occurcount, &pid)) {
+            pid[occurcount].source = i;
+            pid[occurcount].aspect = k;
+            pid[occurcount].dest = j;
+            pid[occurcount].mon = mon0;
+            pid[occurcount].day = day0;
+            pid[occurcount].yea = yea0;
 
-            f1 = e1-d1;
+            // Horray! The aspect occurs sometime during the interval. Now
+            // just have to solve an equation in two variables to find out
+            // where their "lines" of motion cross, i.e. the aspect's time.
+
+            f1 = d2-d1;
             if (RAbs(f1) > rDegHalf)
               f1 -= RSgn(f1)*rDegMax;
-            f2 = e2-d2;
+            f2 = e2-e1;
             if (RAbs(f2) > rDegHalf)
               f2 -= RSgn(f2)*rDegMax;
-            if (MinDistance(Midpoint(d1, d2), Midpoint(e1, e2)) < rDegQuad &&
-              RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
-              pid[occurcount].source = i;
-              pid[occurcount].aspect = k;
-              pid[occurcount].dest = j;
-              pid[occurcount].mon = mon0;
-              pid[occurcount].day = day0;
-              pid[occurcount].yea = yea0;
-
-              // Horray! The aspect occurs sometime during the interval. Now
-              // just have to solve an equation in two variables to find out
-              // where their "lines" of motion cross, i.e. the aspect's time.
-
-              f1 = d2-d1;
-              if (RAbs(f1) > rDegHalf)
-                f1 -= RSgn(f1)*rDegMax;
-              f2 = e2-e1;
-              if (RAbs(f2) > rDegHalf)
-                f2 -= RSgn(f2)*rDegMax;
-              g = (RAbs(d1-e1) > rDegHalf ?
-                (d1-e1)-RSgn(d1-e1)*rDegMax : d1-e1)/(f2-f1);
-              pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
-              pid[occurcount].pos1 = Mod(cpA.obj[i] +
-                RSgn(cpB.obj[i]-cpA.obj[i])*
-                (RAbs(cpB.obj[i]-cpA.obj[i]) > rDegHalf ? -1 : 1)*
-                RAbs(g)*MinDistance(cpA.obj[i], cpB.obj[i]));
-              pid[occurcount].pos2 = Mod(cpA.obj[j] +
-                RSgn(cpB.obj[j]-cpA.obj[j])*
-                (RAbs(cpB.obj[j]-cpA.obj[j]) > rDegHalf ? -1 : 1)*
-                RAbs(g)*MinDistance(cpA.obj[j], cpB.obj[j]));
-              pid[occurcount].ret1 = (cpA.dir[i] + cpB.dir[i]) / 2.0;
-              pid[occurcount].ret2 = (cpA.dir[j] + cpB.dir[j]) / 2.0;
-              occurcount++;
-            }
+            g = (RAbs(d1-e1) > rDegHalf ?
+              (d1-e1)-RSgn(d1-e1)*rDegMax : d1-e1)/(f2-f1);
+            pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
+            pid[occurcount].pos1 = Mod(cpA.obj[i] +
+              RSgn(cpB.obj[i]-cpA.obj[i])*
+              (RAbs(cpB.obj[i]-cpA.obj[i]) > rDegHalf ? -1 : 1)*
+              RAbs(g)*MinDistance(cpA.obj[i], cpB.obj[i]));
+            pid[occurcount].pos2 = Mod(cpA.obj[j] +
+              RSgn(cpB.obj[j]-cpA.obj[j])*
+              (RAbs(cpB.obj[j]-cpA.obj[j]) > rDegHalf ? -1 : 1)*
+              RAbs(g)*MinDistance(cpA.obj[j], cpB.obj[j]));
+            pid[occurcount].ret1 = (cpA.dir[i] + cpB.dir[i]) / 2.0;
+            pid[occurcount].ret2 = (cpA.dir[j] + cpB.dir[j]) / 2.0;
+            occurcount++;
           }
+        }
 
-          } else {
+        } else {
 
-          for (k = 1; k <= Min(us.nAsp, aOpp); k++)
-            if (FAcceptAspect(i, -k, j)) {
-
-            d1 = cpA.alt[i]; d2 = cpB.alt[i];
-            e1 = cpA.alt[j]; e2 = cpB.alt[j];
-            if (!us.fEquator2 && !us.fParallel2) {
-              // If have ecliptic latitude and want declination, convert.
-              g = cpA.obj[i]; EclToEqu(&g, &d1);
-              g = cpB.obj[i]; EclToEqu(&g, &d2);
-              g = cpA.obj[j]; EclToEqu(&g, &e1);
-              g = cpB.obj[j]; EclToEqu(&g, &e2);
-            } else if (us.fEquator2 && us.fParallel2) {
-              // If have equatorial declination and want latitude, convert.
-              g = cpA.obj[i]; EquToEcl(&g, &d1);
-              g = cpB.obj[i]; EquToEcl(&g, &d2);
-              g = cpA.obj[j]; EquToEcl(&g, &e1);
-              g = cpB.obj[j]; EquToEcl(&g, &e2);
-            }
+        for (k = 1; k <= Min(us.nAsp, aOpp); k++)
+          if (FAcceptAspect(i, -k, j)) {
+
+          d1 = cpA.alt[i]; d2 = cpB.alt[i];
+          e1 = cpA.alt[j]; e2 = cpB.alt[j];
+          if (!us.fEquator2 && !us.fParallel2) {
+            // If have ecliptic latitude and want declination, convert.
+            g = cpA.obj[i]; EclToEqu(&g, &d1);
+            g = cpB.obj[i]; EclToEqu(&g, &d2);
+            g = cpA.obj[j]; EclToEqu(&g, &e1);
+            g = cpB.obj[j]; EclToEqu(&g, &e2);
+          } else if (us.fEquator2 && us.fParallel2) {
+            // If have equatorial declination and want latitude, convert.
+            g = cpA.obj[i]; EquToEcl(&g, &d1);
+            g = cpB.obj[i]; EquToEcl(&g, &d2);
+            g = cpA.obj[j]; EquToEcl(&g, &e1);
+            g = cpB.obj[j]; EquToEcl(&g, &e2);
+          }
+
+          // Search each potential aspect in turn. Negate the sign of the
+          // aspect if needed, so can then treat it like a parallel.
+
+          if (k == aOpp) {
+            neg(e1);
+            neg(e2);
+          }
+
+          // Check if the aspect actually occurs during this segment, making
+          // sure to take into account if one or both planets are retrograde.
+
+          f1 = e1-d1;
+          f2 = e2-d2;
+          if (RSgn(f1) != RSgn(f2) && FEnsureInDay(pel, occurcount, &pid)) {
+            pid[occurcount].source = i;
+            pid[occurcount].aspect = k;
+            pid[occurcount].dest = j;
+            pid[occurcount].mon = mon0;
+            pid[occurcount].day = day0;
+            pid[occurcount].yea = yea0;
 
-            // Search each potential aspect in turn. Negate the sign of the
-            // aspect if needed, so can then treat it like a parallel.
+            // Horray! The aspect occurs sometime during the interval. Now
+            // just have to solve an equation in two variables to find out
+            // where their "lines" of motion cross, i.e. the aspect's time.
 
+            f1 = d2-d1;
+            f2 = e2-e1;
+            g = (d1-e1)/(f2-f1);
             if (k == aOpp) {
               neg(e1);
               neg(e2);
             }
+            pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
+            pid[occurcount].pos1 = d1 + (d2 - d1)*g;
+            pid[occurcount].pos2 = e1 + (e2 - e1)*g;
+            pid[occurcount].ret1 = (cpA.diralt[i] + cpB.diralt[i]) / 2.0;
+            pid[occurcount].ret2 = (cpA.diralt[j] + cpB.diralt[j]) / 2.0;
+            occurcount++;
+          }
+        }
+        } // us.fParallel
 
-            // Check if the aspect actually occurs during this segment, making
-            // sure to take into account if one or both planets are retrograde.
-
-            f1 = e1-d1;
-            f2 = e2-d2;
-            if (RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
-              pid[occurcount].source = i;
-              pid[occurcount].aspect = k;
-              pid[occurcount].dest = j;
-              pid[occurcount].mon = mon0;
-              pid[occurcount].day = day0;
-              pid[occurcount].yea = yea0;
-
-              // Horray! The aspect occurs sometime during the interval. Now
-              // just have to solve an equation in two variables to find out
-              // where their "lines" of motion cross, i.e. the aspect's time.
-
-              f1 = d2-d1;
-              f2 = e2-e1;
-              g = (d1-e1)/(f2-f1);
-              if (k == aOpp) {
-                neg(e1);
-                neg(e2);
-              }
-              pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
-              pid[occurcount].pos1 = d1 + (d2 - d1)*g;
-              pid[occurcount].pos2 = e1 + (e2 - e1)*g;
-              pid[occurcount].ret1 = (cpA.diralt[i] + cpB.diralt[i]) / 2.0;
-              pid[occurcount].ret2 = (cpA.diralt[j] + cpB.diralt[j]) / 2.0;
-              occurcount++;
-            }
+        // Check for planet pairs equidistant from each other.
+
+        if (!us.fIgnoreDisequ) {
+          d1 = cpA.dist[i]; d2 = cpB.dist[i];
+          e1 = cpA.dist[j]; e2 = cpB.dist[j];
+          f1 = e1-d1; f2 = e2-d2;
+          if (RSgn(f1) != RSgn(f2) && FEnsureInDay(pel, occurcount, &pid)) {
+            pid[occurcount].source = i;
+            pid[occurcount].aspect = aDis;
+            pid[occurcount].dest = j;
+            pid[occurcount].mon = mon0;
+            pid[occurcount].day = day0;
+            pid[occurcount].yea = yea0;
+            f1 = d2-d1; f2 = e2-e1;
+            g = (d1-e1)/(f2-f1);
+            pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
+            pid[occurcount].pos1 = Mod(cpA.obj[i] +
+              RSgn(cpB.obj[i]-cpA.obj[i])*
+              (RAbs(cpB.obj[i]-cpA.obj[i]) > rDegHalf ? -1 : 1)*
+              RAbs(g)*MinDistance(cpA.obj[i], cpB.obj[i]));
+            pid[occurcount].pos2 = Mod(cpA.obj[j] +
+              RSgn(cpB.obj[j]-cpA.obj[j])*
+              (RAbs(cpB.obj[j]-cpA.obj[j]) > rDegHalf ? -1 : 1)*
+              RAbs(g)*MinDistance(cpA.obj[j], cpB.obj[j]));
+            pid[occurcount].ret1 = (cpA.dir[i] + cpB.dir[i]) / 2.0;
+            pid[occurcount].ret2 = (cpA.dir[j] + cpB.dir[j]) / 2.0;
+            occurcount++;
           }
-          } // us.fParallel
-
-          // Check for planet pairs equidistant from each other.
-
-          if (!us.fIgnoreDisequ) {
-            d1 = cpA.dist[i]; d2 = cpB.dist[i];
-            e1 = cpA.dist[j]; e2 = cpB.dist[j];
-            f1 = e1-d1; f2 = e2-d2;
-            if (RSgn(f1) != RSgn(f2) && occurcount < maxinday) {
-              pid[occurcount].source = i;
-              pid[occurcount].aspect = aDis;
-              pid[occurcount].dest = j;
-              pid[occurcount].mon = mon0;
-              pid[occurcount].day = day0;
-              pid[occurcount].yea = yea0;
-              f1 = d2-d1; f2 = e2-e1;
-              g = (d1-e1)/(f2-f1);
-              pid[occurcount].time = g*divsiz + (real)(div-1)*divsiz;
-              pid[occurcount].pos1 = Mod(cpA.obj[i] +
-                RSgn(cpB.obj[i]-cpA.obj[i])*
-                (RAbs(cpB.obj[i]-cpA.obj[i]) > rDegHalf ? -1 : 1)*
-                RAbs(g)*MinDistance(cpA.obj[i], cpB.obj[i]));
-              pid[occurcount].pos2 = Mod(cpA.obj[j] +
-                RSgn(cpB.obj[j]-cpA.obj[j])*
-                (RAbs(cpB.obj[j]-cpA.obj[j]) > rDegHalf ? -1 : 1)*
-                RAbs(g)*MinDistance(cpA.obj[j], cpB.obj[j]));
-              pid[occurcount].ret1 = (cpA.dir[i] + cpB.dir[i]) / 2.0;
-              pid[occurcount].ret2 = (cpA.dir[j] + cpB.dir[j]) / 2.0;
-              occurcount++;
-            }
+        }
+      }
+    } // i
+
+    // If -YN in effect, then refine the times of events found in segment,
+    // instead of assuming linear motion within it.
+
+    if (us.fSearchRefine)
+      for (k = occurdiv; k < occurcount; k++)
+        RefineInDayEvent(&pid[k], &cpA, &cpB, (real)(div-1)*divsiz,
+          (real)div*divsiz, fProg);
+  } // div
+  pel->cev = occurcount;
+  return occurcount;
+}
+
+
+// Days searched for events by the -d switch, which are searched in batches,
+// with each day within a batch being a job that can run on its own thread.
+
+typedef struct _InDaySearch {
+  CONST int *rgDate;   // Month, day, and year of each day to search.
+  int iDay;            // Index of first day in current batch.
+  int division;        // Number of segments to divide each day into.
+  flag fProg;          // Whether searching for progressed events.
+  EL *rgel;            // Events found within each day of the batch.
+  real *rgJDp;         // Progressed time at end of each day.
+} IDS;
+
+
+// Search one day within a batch of days for events, as called by RunJobs().
+// Each day of the batch has its own list, which is reused for each batch.
+
+void InDaySearchJob(void *pv, int iJob)
+{
+  IDS *pids = (IDS *)pv;
+  CONST int *pn = &pids->rgDate[(pids->iDay + iJob)*3];
+
+  NInDaySearchDay(&pids->rgel[iJob], pn[0], pn[1], pn[2], pids->division,
+    pids->fProg);
+  pids->rgJDp[iJob] = is.JDp;
+}
+
+
+// Search through a day or longer period, and print out the times of exact
+// aspects among planets during that day, as specified with the -d switch,
+// as well as times when planets changes sign or direction. Days are searched
+// in batches, which are split across multiple threads if allowed, and then
+// each day's events are printed in order. There's no limit to the number of
+// events found, and long periods are printed in chunks as they're searched.
+
+void ChartInDaySearch(flag fProg)
+{
+  InDayInfo idT, *pid;
+  IDS ids;
+  EL el;
+  int *rgDate = NULL, yea0, yea1, yea2, mon0, mon1, mon2, day0, day1, day2,
+    counttotal = 0, occurcount, division, cDay, iDay, cBatch, iPass, i, j;
+  flag fYear, fVoid, fPrint = fTrue;
+
+  // If parameter 'fProg' is set, look for changes in a progressed chart.
+
+#ifdef GRAPH
+  fPrint &= (RgzCalendar() == NULL);
+#endif
+  fYear = us.fInDayMonth && us.fInDayYear;
+  fVoid = !FIgnore(oMoo) && !us.fIgnoreSign && us.fInDayMonth;
+  division = (fYear || fProg) ? (us.nDivision + 9) / 10 : us.nDivision;
+  us.fProgress = fProg;
+  if (us.fListAuto)
+    is.cci = 0;
+
+  // If -dY in effect, then search through a range of years.
+
+  yea1 = yea2 = !fProg ? Yea : YeaT;
+  if (fYear && us.nEphemYears != 0) {
+    if (us.nEphemYears < 0)
+      yea1 += (us.nEphemYears + 1);
+    else
+      yea2 += (us.nEphemYears - 1);
+  }
+
+  // Make a list of the days to search. The first pass counts them, and the
+  // second pass fills out the list.
+
+  for (iPass = 0; iPass < 2; iPass++) {
+    cDay = 0;
+    for (yea0 = yea1; yea0 <= yea2; yea0++) {
+
+      // If -dy in effect, then search through the whole year, month by month.
+
+      if (fYear) {
+        mon1 = 1; mon2 = 12;
+      } else
+        mon1 = mon2 = !fProg ? Mon : MonT;
+      for (mon0 = mon1; mon0 <= mon2; mon0++) {
+        if (us.fInDayMonth) {
+          day1 = 1;
+          day2 = DayInMonth(mon0, yea0);
+        } else
+          day1 = day2 = !fProg ? Day : DayT;
+        for (day0 = day1; day0 <= day2; day0 = AddDay(mon0, day0, yea0, 1)) {
+          if (rgDate != NULL) {
+            rgDate[cDay*3] = mon0; rgDate[cDay*3+1] = day0;
+            rgDate[cDay*3+2] = yea0;
           }
+          cDay++;
         }
-      } // i
-    } // div
+      }
+    }
+    if (iPass == 0) {
+      rgDate = RgAllocate(cDay*3, int, "day list");
+      if (rgDate == NULL)
+        return;
+    }
+  }
+
+  // Allocate lists of events for a batch of days. Use enough days per batch
+  // that each thread gets a number of them.
+
+  cBatch = Min(cDay, NThreadCount() * 64);
+  InitEventList(&el, sizeof(InDayInfo));
+  ClearB((pbyte)&ids, sizeof(ids));
+  ids.rgDate = rgDate;
+  ids.division = division;
+  ids.fProg = fProg;
+  ids.rgel = RgAllocate(cBatch, EL, "day event lists");
+  ids.rgJDp = RgAllocate(cBatch, real, "day event times");
+  if (ids.rgel == NULL || ids.rgJDp == NULL)
+    goto LDone;
+  for (i = 0; i < cBatch; i++)
+    InitEventList(&ids.rgel[i], sizeof(InDayInfo));
+
+  // Start searching the day or days in question for exciting events.
+
+  for (iDay = 0; iDay < cDay; iDay++) {
+
+    // Search the next batch of days if have reached the end of the current.
+
+    i = iDay % cBatch;
+    if (i == 0) {
+      ids.iDay = iDay;
+      RunJobs(InDaySearchJob, &ids, Min(cBatch, cDay - iDay));
+    }
+
+    // Add the day's events after any earlier events not printed yet.
+    occurcount = ids.rgel[i].cev;
+    if (!FAppendEvents(&el, ids.rgel[i].rgev, occurcount))
+      occurcount = 0;
+    pid = (InDayInfo *)el.rgev + (el.cev - occurcount);
+    // Any progressed chart cast when displaying is as of the end of the day.
+    is.JDp = ids.rgJDp[i];
 
     // After all the aspects and evemts in the day have been located, sort
     // them by time at which they occur, so can print them in order.
@@ -638,40 +900,41 @@ void ChartInDaySearch(flag fProg)
 
     // Finally, loop through and display each aspect and when it occurs.
 
-    if (!fVoid || (day0 >= day2 && mon0 >= mon2 && yea0 >= yea2)) {
+    pid = (InDayInfo *)el.rgev;
+    if (!fVoid || iDay >= cDay-1) {
       // If no v/c aspects, or reached end of period, output all at once.
-      if (fVoid) {
-        occurcount += (int)(pid - id);
-        pid = id;
-      }
-      PrintInDays(id, occurcount, occurcount, fProg);
+      PrintInDays(pid, el.cev, el.cev, fProg);
+      el.cev = 0;
     } else {
       // Output a chunk of events, knowing there's more to come.
-      pid += occurcount;
-      j = MAXINDAY >> 2;
-      if (pid - id > j << 1) {
+      j = INDAYCHUNK;
+      if (el.cev > j << 1) {
 #ifdef GRAPH
-        if (RgzCalendar() != NULL && id[j].day != id[0].day) {
+        if (RgzCalendar() != NULL && pid[j].day != pid[0].day) {
           // Don't split day when drawing within calendar boxes.
-          while (j > 0 && id[j].day == id[j-1].day)
+          while (j > 0 && pid[j].day == pid[j-1].day)
             j--;
         }
 #endif
-        PrintInDays(id, j, pid - id, fProg);
-        for (i = 0; i < pid - id - j; i++)
-          id[i] = id[i + j];
-        pid -= j;
+        PrintInDays(pid, j, el.cev, fProg);
+        RemoveEvents(&el, j);
       }
     }
-    if (occurcount >= maxinday && fPrint)
-      PrintSz("Too many transit events found.\n");
     counttotal += occurcount;
-  } // day0
-  } // mon0
-  } // yea0
+  } // iDay
   if (counttotal == 0 && fPrint)
     PrintSz("No transit events found.\n");
 
+LDone:
+  if (ids.rgel != NULL) {
+    for (i = 0; i < cBatch; i++)
+      FreeEventList(&ids.rgel[i]);
+    DeallocateP(ids.rgel);
+  }
+  FreeEventList(&el);
+  DeallocatePIf(ids.rgJDp);
+  DeallocateP(rgDate);
+
   // Recompute original chart placements as have overwritten them.
 
   ciCore = ciMain;
@@ -679,22 +942,276 @@ void ChartInDaySearch(flag fProg)
 }
 
 
+// Months searched for transits by the -t switch, which are searched in
+// batches, with each month within a batch being a job that can run on its
+// own thread.
+
+typedef struct _TransitSearch {
+  int Y1, M1;          // First year and month to search.
+  int cMonYear;        // Number of months to search within each year.
+  int iMon;            // Index of first month in current batch.
+  int division;        // Number of segments to divide each month into.
+  int nAsp;            // Number of aspects to search for.
+  flag fNoCusp;        // Whether natal house cusps are restricted.
+  flag fProg;          // Whether searching for progressed transits.
+  flag fPrint;         // Whether transits are displayed after each segment.
+  real mc, ob;         // MC and obliquity of the natal chart.
+  CONST CP *pcpN;      // Positions of the natal chart being transited.
+  TransInfo **rgpti;   // Transits found within each segment of the batch.
+  int *rgcti;          // Number of transits found within each segment.
+  real *rgJDp;         // Progressed time at end of each segment.
+} TS;
+
+
+// Search one month within a batch of months for transits to the natal chart,
+// as called by RunJobs(). Cast charts for the start and end of each segment
+// of the month, and do an equation check for aspects during the interval.
+
+void TransitSearchJob(void *pv, int iJob)
+{
+  TS *pts = (TS *)pv;
+  TransInfo ti[MAXINDAY], *pti = ti;
+  byte ignoreSav[objMax];
+  int mon, yea, occurcount = 0, division = pts->division, div,
+    nAsp = pts->nAsp, iti, i, j, k, s1, s2;
+  real cuspSav[cSign+1], divsiz, daysiz, d, e1, e2, f1, f2,
+    mc = pts->mc, ob = pts->ob, lonSav;
+  flag fNoCusp = pts->fNoCusp, fProg = pts->fProg, fPrint = pts->fPrint;
+  CONST CP *pcpN = pts->pcpN;
+  CP cpA, cpB;
+
+  yea = pts->Y1 + (pts->iMon + iJob) / pts->cMonYear;
+  mon = pts->M1 + (pts->iMon + iJob) % pts->cMonYear;
+  daysiz = (real)(us.fInDayMonth ? DayInMonth(mon, yea) : 1)*24.0*60.0;
+  divsiz = daysiz / (real)division;
+
+  // Cast chart for beginning of month and store it for future use.
+
+  SetCI(ciCore, mon, us.fInDayMonth ? 1 : DayT, yea, 0.0, DstT, ZonT,
+    LonT, LatT);
+  if (us.fProgress = fProg) {
+    is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
+    ciCore = ciMain;
+  }
+  CopyRgb(ignore, ignoreSav, is.nObj+1);
+  CopyRgb(ignore2, ignore, is.nObj+1);
+  CastObjects(-1, !fNoCusp);
+  CopyRgb(ignoreSav, ignore, is.nObj+1);
+  cpB = cp0;
+
+  // Divide month into segments and then search each segment in turn.
+
+  for (div = 1; div <= division; div++) {
+    if (fPrint) {
+      occurcount = 0; pti = ti;
+    }
+
+    // Cast the chart for the ending time of the present segment, and copy
+    // the start time chart from the previous end time chart.
+
+    d = (us.fInDayMonth ? 1.0 : (real)DayT) +
+      (daysiz/24.0/60.0)*(real)div/(real)division;
+    SetCI(ciCore, mon, (int)d, yea, RFract(d)*24.0,
+      DstT, ZonT, LonT, LatT);
+    if (fProg) {
+      is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
+      ciCore = ciMain;
+    }
+    CopyRgb(ignore, ignoreSav, oNorm+1);
+    CopyRgb(ignore2, ignore, oNorm+1);
+    CastObjects(-1, !fNoCusp);
+    CopyRgb(ignoreSav, ignore, oNorm+1);
+    cpA = cpB; cpB = cp0;
+
+    // Now search through the present segment for any transits. Note that
+    // stars can be transited, but they can't make transits themselves.
+
+    for (i = 0; i <= is.nObj; i++) {
+
+      // Check if 3D house change occurs during time segment.
+
+      if (us.fHouse3D && !us.fIgnoreSign && !FIgnore2(i)) {
+        is.MC = mc; is.OB = ob;
+        lonSav = cp0.lonMC; cp0.lonMC = pcpN->lonMC;
+        CopyRgb((pbyte)cp0.cusp3, (pbyte)cuspSav, sizeof(cuspSav));
+        CopyRgb((pbyte)pcpN->cusp3, (pbyte)cp0.cusp3, sizeof(cuspSav));
+        e1 = cpA.obj[i]; f1 = RHousePlaceIn3D(e1, cpA.alt[i]);
+        e2 = cpB.obj[i]; f2 = RHousePlaceIn3D(e2, cpB.alt[i]);
+        CopyRgb((pbyte)cuspSav, (pbyte)cp0.cusp3, sizeof(cuspSav));
+        cp0.lonMC = lonSav;
+        s1 = SFromZ(f1)-1; s2 = SFromZ(f2)-1;
+        k = NAbs(s1-s2);
+        if (s1 != s2 && (k == 1 || k == cSign-1) && !FIgnore(cuspLo+s2) &&
+          occurcount < MAXINDAY) {
+          pti->source = i;
+          pti->aspect = aHou;
+          pti->dest = s2+1;
+          pti->time = MinDistance(f1,
+            (real)(cpA.dir[i] >= 0.0 ? s2 : s1) * 30.0) /
+            MinDistance(f1, f2)*divsiz + (real)(div-1)*divsiz;
+          pti->posT = cpA.obj[i];
+          pti->posN = pcpN->obj[i];
+          pti->retT = (cpA.dir[i] + cpB.dir[i]) / 2.0;
+          occurcount++, pti++;
+        }
+      }
+
+      if (FIgnore(i))
+        continue;
+      for (j = 0; j <= oNorm; j++) {
+        if ((is.fReturn ? i != j : FIgnore2(j)) || (fNoCusp && !FThing(j)))
+          continue;
+
+        // Between each pair of planets, check if they make any aspects.
+
+        if (!us.fParallel) {
+
+        for (k = 1; k <= nAsp; k++) if (FAcceptAspect(i, k, j)) {
+          d = pcpN->obj[i]; e1 = cpA.obj[j]; e2 = cpB.obj[j];
+          if (MinDistance(e1, Mod(d-rAspAngle[k])) <
+              MinDistance(e2, Mod(d+rAspAngle[k]))) {
+            e1 = Mod(e1+rAspAngle[k]);
+            e2 = Mod(e2+rAspAngle[k]);
+          } else {
+            e1 = Mod(e1-rAspAngle[k]);
+            e2 = Mod(e2-rAspAngle[k]);
+          }
+
+          // Check to see if the present aspect actually occurs during the
+          // segment, making sure we check any Aries point crossings.
+
+          f1 = e1-d;
+          if (RAbs(f1) > rDegHalf)
+            f1 -= RSgn(f1)*rDegMax;
+          f2 = e2-d;
+          if (RAbs(f2) > rDegHalf)
+            f2 -= RSgn(f2)*rDegMax;
+          if (MinDistance(d, Midpoint(e1, e2)) < rDegQuad &&
+            RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
+
+            // Ok, have found a transit! Now determine the time and save
+            // this transit in our list to be printed.
+
+            pti->source = j;
+            pti->aspect = k;
+            pti->dest = i;
+            pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
+              (real)(div-1)*divsiz;
+            pti->posT = Mod(MinDistance(cpA.obj[j], Mod(d-rAspAngle[k])) <
+                            MinDistance(cpB.obj[j], Mod(d+rAspAngle[k])) ?
+              d-rAspAngle[k] : d+rAspAngle[k]);
+            pti->posN = pcpN->obj[i];
+            pti->retT = (cpA.dir[j] + cpB.dir[j]) / 2.0;
+            occurcount++, pti++;
+          }
+        }
+
+        } else {
+
+        for (k = 1; k <= nAsp; k++) if (FAcceptAspect(i, k, j)) {
+          d = pcpN->alt[i]; e1 = cpA.alt[j]; e2 = cpB.alt[j];
+          if (!us.fEquator2 && !us.fParallel2) {
+            // If have ecliptic latitude and want declination, convert.
+            f1 = pcpN->obj[i]; EclToEqu(&f1, &d);
+            f1 = cpA.obj[j]; EclToEqu(&f1, &e1);
+            f2 = cpB.obj[j]; EclToEqu(&f2, &e2);
+          } else if (us.fEquator2 && us.fParallel2) {
+            // If have equatorial declination and want latitude, convert.
+            f1 = pcpN->obj[i]; EquToEcl(&f1, &d);
+            f1 = cpA.obj[j]; EquToEcl(&f1, &e1);
+            f2 = cpB.obj[j]; EquToEcl(&f2, &e2);
+          }
+
+          if (k == aOpp) {
+            neg(e1);
+            neg(e2);
+          }
+
+          // Check if parallel aspect occurs during time segment.
+
+          f1 = e1-d;
+          f2 = e2-d;
+          if (RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
+
+            // Ok, found a parallel transit. Now determine the time and save
+            // this transit in the list to be printed.
+
+            if (k == aOpp) {
+              neg(e1);
+              neg(e2);
+            }
+            pti->source = j;
+            pti->aspect = k;
+            pti->dest = i;
+            pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
+              (real)(div-1)*divsiz;
+            pti->posT = e1 + (e2 - e1)*RAbs(f1)/(RAbs(f1)+RAbs(f2));
+            pti->posN = d;
+            pti->retT = (cpA.diralt[j] + cpB.diralt[j]) / 2.0;
+            occurcount++, pti++;
+          }
+        }
+        } // us.fParallel
+
+        // Check for planet pairs equidistant from each other.
+
+        if (!us.fIgnoreDisequ) {
+          d = pcpN->dist[i]; e1 = cpA.dist[j]; e2 = cpB.dist[j];
+          if (((d > e1 && d < e2) || (d > e2 && d < e1)) &&
+            occurcount < MAXINDAY) {
+            f1 = d-e1; f2 = e2-d;
+            pti->source = j;
+            pti->aspect = aDis;
+            pti->dest = i;
+            pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
+              (real)(div-1)*divsiz;
+            pti->posT = Mod(cpA.obj[j] + RAbs(f1)/(RAbs(f1)+RAbs(f2)) *
+              MinDifference(cpA.obj[j], cpB.obj[j]));
+            pti->posN = pcpN->obj[i];
+            pti->retT = (cpA.dir[j] + cpB.dir[j]) / 2.0;
+            occurcount++, pti++;
+          }
+        }
+      } // j
+    } // i
+
+
+    // Save this segment's transits, unless they'll be displayed together
+    // with those of later segments.
+
+    iti = iJob*division + div-1;
+    pts->rgpti[iti] = NULL;
+    pts->rgcti[iti] = 0;
+    pts->rgJDp[iti] = is.JDp;
+    if (!fPrint && div < division)
+      continue;
+    if (occurcount > 0) {
+      pts->rgpti[iti] = RgAllocate(occurcount, TransInfo, "transits");
+      if (pts->rgpti[iti] == NULL)
+        continue;
+      CopyRgb((pbyte)ti, (pbyte)pts->rgpti[iti],
+        occurcount * sizeof(TransInfo));
+    }
+    pts->rgcti[iti] = occurcount;
+  } // div
+}
+
+
 // Search through a month, year, or years, and print out the times of exact
 // transits where planets in the time frame make aspect to the planets in
-// some other chart, as specified with the -t switch. To do this, cast charts
-// for the start and end of each month, or within a month, and do an equation
-// check for aspects to the other base chart during the interval.
+// some other chart, as specified with the -t switch. Months are searched in
+// batches, which are split across multiple threads if allowed, and then each
+// segment's transits are printed in order.
 
 void ChartTransitSearch(flag fProg)
 {
   TransInfo ti[MAXINDAY], tiT, *pti;
+  TS ts;
   char sz[cchSzDef];
   int M1, M2, Y1, Y2, counttotal = 0, occurcount, division, div, nAsp, fNoCusp,
-    nSkip = 0, i, j, k, s1, s2, s1prev = 0;
-  real cuspSav[cSign+1], divsiz, daysiz, d, e1, e2, f1, f2,
-    mc = is.MC, ob = is.OB, lonSav;
+    nSkip = 0, cMon, iMon, cBatch, iBatch, iti, i, j, k, s1, s1prev = 0;
   flag fPrint = fTrue;
-  CP cpA, cpB, cpN = cp0;
+  CP cpN = cp0;
   CI ciSav, ciCast = ciSave, ciEvent;
 
   // Print header row.
@@ -750,215 +1267,56 @@ void ChartTransitSearch(flag fProg)
     }
   }
 
-  // Start searching the year or years in question for any transits.
-
-  for (YeaT = Y1; YeaT <= Y2; YeaT++)
+  // Allocate lists of transits for a batch of months. Use enough months per
+  // batch that each thread gets a number of them.
+
+  cMon = (Y2 - Y1 + 1) * (M2 - M1 + 1);
+  cBatch = Min(cMon, NThreadCount() * 12);
+  ClearB((pbyte)&ts, sizeof(ts));
+  ts.Y1 = Y1; ts.M1 = M1; ts.cMonYear = M2 - M1 + 1;
+  ts.division = division; ts.nAsp = nAsp; ts.fNoCusp = fNoCusp;
+  ts.fProg = fProg; ts.fPrint = fPrint;
+  ts.mc = is.MC; ts.ob = is.OB; ts.pcpN = &cpN;
+  ts.rgpti = RgAllocate(cBatch * division, TransInfo *, "transit lists");
+  ts.rgcti = RgAllocate(cBatch * division, int, "transit counts");
+  ts.rgJDp = RgAllocate(cBatch * division, real, "transit times");
+  if (ts.rgpti == NULL || ts.rgcti == NULL || ts.rgJDp == NULL)
+    goto LDone;
+  us.fProgress = fProg;
 
   // Start searching the month or months in question for any transits.
 
-  for (MonT = M1; MonT <= M2; MonT++) {
-    occurcount = 0; pti = ti;
-    daysiz = (real)(us.fInDayMonth ? DayInMonth(MonT, YeaT) : 1)*24.0*60.0;
-    divsiz = daysiz / (real)division;
+  for (iMon = 0; iMon < cMon; iMon++) {
+    YeaT = Y1 + iMon / ts.cMonYear;
+    MonT = M1 + iMon % ts.cMonYear;
 
-    // Cast chart for beginning of month and store it for future use.
+    // Search the next batch of months if have reached the end of the current.
 
-    SetCI(ciCore, MonT, us.fInDayMonth ? 1 : DayT, YeaT, 0.0, DstT, ZonT,
-      LonT, LatT);
-    if (us.fProgress = fProg) {
-      is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
-      ciCore = ciMain;
+    iBatch = iMon % cBatch;
+    if (iBatch == 0) {
+      ts.iMon = iMon;
+      RunJobs(TransitSearchJob, &ts, Min(cBatch, cMon - iMon));
     }
-    for (i = 0; i <= is.nObj; i++)
-      SwapN(ignore[i], ignore2[i]);
-    CastChart(-1);
-    for (i = 0; i <= is.nObj; i++)
-      SwapN(ignore[i], ignore2[i]);
-    cpB = cp0;
 
-    // Divide month into segments and then search each segment in turn.
+    // Display the transits found within each segment of the month in turn.
 
     for (div = 1; div <= division; div++) {
-      if (fPrint) {
-        occurcount = 0; pti = ti;
-      }
-
-      // Cast the chart for the ending time of the present segment, and copy
-      // the start time chart from the previous end time chart.
-
-      d = (us.fInDayMonth ? 1.0 : (real)DayT) +
-        (daysiz/24.0/60.0)*(real)div/(real)division;
-      SetCI(ciCore, MonT, (int)d, YeaT, RFract(d)*24.0,
-        DstT, ZonT, LonT, LatT);
-      if (fProg) {
-        is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
-        ciCore = ciMain;
-      }
-      for (i = 0; i <= oNorm; i++)
-        SwapN(ignore[i], ignore2[i]);
-      CastChart(-1);
-      for (i = 0; i <= oNorm; i++)
-        SwapN(ignore[i], ignore2[i]);
-      cpA = cpB; cpB = cp0;
-
-      // Now search through the present segment for any transits. Note that
-      // stars can be transited, but they can't make transits themselves.
-
-      for (i = 0; i <= is.nObj; i++) {
-
-        // Check if 3D house change occurs during time segment.
-
-        if (us.fHouse3D && !us.fIgnoreSign && !FIgnore2(i)) {
-          is.MC = mc; is.OB = ob;
-          lonSav = cp0.lonMC; cp0.lonMC = cpN.lonMC;
-          CopyRgb((pbyte)cp0.cusp3, (pbyte)cuspSav, sizeof(cuspSav));
-          CopyRgb((pbyte)cpN.cusp3, (pbyte)cp0.cusp3, sizeof(cuspSav));
-          e1 = cpA.obj[i]; f1 = RHousePlaceIn3D(e1, cpA.alt[i]);
-          e2 = cpB.obj[i]; f2 = RHousePlaceIn3D(e2, cpB.alt[i]);
-          CopyRgb((pbyte)cuspSav, (pbyte)cp0.cusp3, sizeof(cuspSav));
-          cp0.lonMC = lonSav;
-          s1 = SFromZ(f1)-1; s2 = SFromZ(f2)-1;
-          k = NAbs(s1-s2);
-          if (s1 != s2 && (k == 1 || k == cSign-1) && !FIgnore(cuspLo+s2) &&
-            occurcount < MAXINDAY) {
-            pti->source = i;
-            pti->aspect = aHou;
-            pti->dest = s2+1;
-            pti->time = MinDistance(f1,
-              (real)(cpA.dir[i] >= 0.0 ? s2 : s1) * 30.0) /
-              MinDistance(f1, f2)*divsiz + (real)(div-1)*divsiz;
-            pti->posT = cpA.obj[i];
-            pti->posN = cpN.obj[i];
-            pti->retT = (cpA.dir[i] + cpB.dir[i]) / 2.0;
-            occurcount++, pti++;
-          }
-        }
-
-        if (FIgnore(i))
-          continue;
-        for (j = 0; j <= oNorm; j++) {
-          if ((is.fReturn ? i != j : FIgnore2(j)) || (fNoCusp && !FThing(j)))
-            continue;
-
-          // Between each pair of planets, check if they make any aspects.
-
-          if (!us.fParallel) {
-
-          for (k = 1; k <= nAsp; k++) if (FAcceptAspect(i, k, j)) {
-            d = cpN.obj[i]; e1 = cpA.obj[j]; e2 = cpB.obj[j];
-            if (MinDistance(e1, Mod(d-rAspAngle[k])) <
-                MinDistance(e2, Mod(d+rAspAngle[k]))) {
-              e1 = Mod(e1+rAspAngle[k]);
-              e2 = Mod(e2+rAspAngle[k]);
-            } else {
-              e1 = Mod(e1-rAspAngle[k]);
-              e2 = Mod(e2-rAspAngle[k]);
-            }
-
-            // Check to see if the present aspect actually occurs during the
-            // segment, making sure we check any Aries point crossings.
-
-            f1 = e1-d;
-            if (RAbs(f1) > rDegHalf)
-              f1 -= RSgn(f1)*rDegMax;
-            f2 = e2-d;
-            if (RAbs(f2) > rDegHalf)
-              f2 -= RSgn(f2)*rDegMax;
-            if (MinDistance(d, Midpoint(e1, e2)) < rDegQuad &&
-              RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
-
-              // Ok, have found a transit! Now determine the time and save
-              // this transit in our list to be printed.
-
-              pti->source = j;
-              pti->aspect = k;
-              pti->dest = i;
-              pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
-                (real)(div-1)*divsiz;
-              pti->posT = Mod(MinDistance(cpA.obj[j], Mod(d-rAspAngle[k])) <
-                              MinDistance(cpB.obj[j], Mod(d+rAspAngle[k])) ?
-                d-rAspAngle[k] : d+rAspAngle[k]);
-              pti->posN = cpN.obj[i];
-              pti->retT = (cpA.dir[j] + cpB.dir[j]) / 2.0;
-              occurcount++, pti++;
-            }
-          }
-
-          } else {
-
-          for (k = 1; k <= nAsp; k++) if (FAcceptAspect(i, k, j)) {
-            d = cpN.alt[i]; e1 = cpA.alt[j]; e2 = cpB.alt[j];
-            if (!us.fEquator2 && !us.fParallel2) {
-              // If have ecliptic latitude and want declination, convert.
-              f1 = cpN.obj[i]; EclToEqu(&f1, &d);
-              f1 = cpA.obj[j]; EclToEqu(&f1, &e1);
-              f2 = cpB.obj[j]; EclToEqu(&f2, &e2);
-            } else if (us.fEquator2 && us.fParallel2) {
-              // If have equatorial declination and want latitude, convert.
-              f1 = cpN.obj[i]; EquToEcl(&f1, &d);
-              f1 = cpA.obj[j]; EquToEcl(&f1, &e1);
-              f2 = cpB.obj[j]; EquToEcl(&f2, &e2);
-            }
-
-            if (k == aOpp) {
-              neg(e1);
-              neg(e2);
-            }
-
-            // Check if parallel aspect occurs during time segment.
-
-            f1 = e1-d;
-            f2 = e2-d;
-            if (RSgn(f1) != RSgn(f2) && occurcount < MAXINDAY) {
-
-              // Ok, found a parallel transit. Now determine the time and save
-              // this transit in the list to be printed.
-
-              if (k == aOpp) {
-                neg(e1);
-                neg(e2);
-              }
-              pti->source = j;
-              pti->aspect = k;
-              pti->dest = i;
-              pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
-                (real)(div-1)*divsiz;
-              pti->posT = e1 + (e2 - e1)*RAbs(f1)/(RAbs(f1)+RAbs(f2));
-              pti->posN = d;
-              pti->retT = (cpA.diralt[j] + cpB.diralt[j]) / 2.0;
-              occurcount++, pti++;
-            }
-          }
-          } // us.fParallel
-
-          // Check for planet pairs equidistant from each other.
-
-          if (!us.fIgnoreDisequ) {
-            d = cpN.dist[i]; e1 = cpA.dist[j]; e2 = cpB.dist[j];
-            if (((d > e1 && d < e2) || (d > e2 && d < e1)) &&
-              occurcount < MAXINDAY) {
-              f1 = d-e1; f2 = e2-d;
-              pti->source = j;
-              pti->aspect = aDis;
-              pti->dest = i;
-              pti->time = RAbs(f1)/(RAbs(f1)+RAbs(f2))*divsiz +
-                (real)(div-1)*divsiz;
-              pti->posT = Mod(cpA.obj[j] + RAbs(f1)/(RAbs(f1)+RAbs(f2)) *
-                MinDifference(cpA.obj[j], cpB.obj[j]));
-              pti->posN = cpN.obj[i];
-              pti->retT = (cpA.dir[j] + cpB.dir[j]) / 2.0;
-              occurcount++, pti++;
-            }
-          }
-        } // j
-      } // i
-
 #ifdef GRAPH
       // May want to draw current transit event within a graphic calendar box.
       if (RgzCalendar() != NULL && div < division)
         continue;
 #endif
 
+      iti = iBatch*division + div-1;
+      occurcount = ts.rgcti[iti];
+      if (ts.rgpti[iti] != NULL) {
+        CopyRgb((pbyte)ts.rgpti[iti], (pbyte)ti,
+          occurcount * sizeof(TransInfo));
+        DeallocateP(ts.rgpti[iti]);
+      }
+      // Any progressed chart cast when displaying is as of the segment end.
+      is.JDp = ts.rgJDp[iti];
+
       // After all transits located, sort them by time at which they occur.
 
       for (i = 1; i < occurcount; i++) {
@@ -1069,10 +1427,15 @@ void ChartTransitSearch(flag fProg)
         PrintSz("Too many transits found.\n");
       counttotal += occurcount;
     } // div
-  } // MonT
+  } // iMon
   if (counttotal == 0 && fPrint)
     PrintSz("No transits found.\n");
 
+LDone:
+  DeallocatePIf(ts.rgpti);
+  DeallocatePIf(ts.rgcti);
+  DeallocatePIf(ts.rgJDp);
+
   // Recompute original chart placements as have overwritten them.
 
   ciCore = ciMain; ciTran = ciSav;
@@ -1166,7 +1529,7 @@ void ChartTransitGraph(flag fTrans, flag fProg)
       is.JDp = MdytszToJulian(MM, DD, YY, TT, SS, ZZ);
       ciCore = ciMain;
     }
-    CastChart(-1);
+    CastObjects(-1, fTrue);
     if (fTrans)
       for (obj = 0; obj <= oNorm; obj++)
         SwapN(ignore[obj], ignore2[obj]);
@@ -1446,7 +1809,7 @@ void ChartHorizonRising(void)
   occurcount = 0;
   ciSav = ciTwin;
   SetCI(ciCore, mon0, day0, yea0, 0.0, Dst, Zon, Lon, Lat);
-  CastChart(-1);
+  CastObjects(-1, fTrue);
   mc2 = planet[oMC]; k = planetalt[oMC];
   EclToEqu(&mc2, &k);
   cp2 = cp0;
@@ -1457,7 +1820,7 @@ void ChartHorizonRising(void)
   for (div = 1; div <= division; div++) {
     SetCI(ciCore, mon0, day0, yea0, 24.0*(real)div/(real)division,
       Dst, Zon, Lon, Lat);
-    CastChart(-1);
+    CastObjects(-1, fTrue);
     mc1 = mc2;
     mc2 = planet[oMC]; k = planetalt[oMC];
     EclToEqu(&mc2, &k);
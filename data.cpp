@@ -60,7 +60,7 @@
 ******************************************************************************
 */
 
-US us = {
+TLOCAL US us = {
 
   // Chart types
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -100,7 +100,7 @@ US us = {
 
   // Obscure flags
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,
-  1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 
   // Value settings
   ddDecanR,
@@ -138,7 +138,7 @@ US us = {
 
   // Value subsettings
   0, 5, 200, cPart, 22, 0.0, 0.0, rDayInYear, 1.0, 0.5, ccNone, ccNone,
-  24, 0, 0, rInvalid, 0.0, 0.0, 0.0, oEar, oEar, 0, 0, BIODAYS, 0, 0, 0,
+  24, 0, 0, rInvalid, 0.0, 0.0, 0.0, oEar, oEar, 0, 0, BIODAYS, 0, 0, 0, 1,
 
   // AstroExpressions
   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
@@ -147,7 +147,7 @@ US us = {
   NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
   NULL, NULL, NULL, NULL};
 
-IS is = {
+TLOCAL IS is = {
 #ifdef SWITCHES
   fFalse,
 #else
@@ -156,12 +156,15 @@ IS is = {
   fFalse, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse,
   NULL, {0,0,0,0,0,0,0,0,0}, NULL, NULL, NULL,
   0, cObj, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, 0, 0, 0,
-  0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0,
-  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  0, 0, 0, 0, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0,
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL,
   0.0, 0.0, 0.0, 0.0, 0.0, 0.0, rAxis, 0.0, rInvalid, 0.0};
 
-CI ciCore = {11, 19, 1971, HM(11, 1),     0.0, 8.0, DEFAULT_LOC, NULL, NULL};
-CI ciMain = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    NULL, NULL};
+// Chart being cast and current main chart are working state of each thread.
+TLOCAL CI ciCore = {11, 19, 1971, HM(11, 1), 0.0, 8.0, DEFAULT_LOC,
+  NULL, NULL};
+TLOCAL CI ciMain = {-1, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, NULL, NULL};
 CI ciTwin = {9,  11, 1991, HMS(0, 0, 38), 0.0, 0.0, DEFAULT_LOC, NULL, NULL};
 CI ciThre = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    NULL, NULL};
 CI ciFour = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    NULL, NULL};
@@ -171,11 +174,9 @@ CI ciDefa = {-1, 0,  0,    0.0,           0.0, 0.0, 0.0, 0.0,    NULL, NULL};
 CI ciTran = {1,  1,  2026, 0.0,           0.0, 0.0, 0.0, 0.0,    NULL, NULL};
 CI ciSave = {5,  31, 2026, HMS(1,45,13),  1.0, 8.0, DEFAULT_LOC, NULL, NULL};
 CI ciGreg = {10, 15, 1582, 0.0,           0.0, 0.0, 0.0, 0.0,    NULL, NULL};
-CP cp0, cp1, cp2, cp3, cp4, cp5, cp6;
+TLOCAL CP cp0;
+CP cp1, cp2, cp3, cp4, cp5, cp6;
 
-CI * CONST rgpci[cRing+1] = {&ciCore,
-  &ciMain, &ciTwin, &ciThre, &ciFour, &ciFive, &ciHexa};
-CP * CONST rgpcp[cRing+1] = {&cp0, &cp1, &cp2, &cp3, &cp4, &cp5, &cp6};
 flag rgfProg[cRing+1] = {0, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse};
 
 
@@ -185,17 +186,18 @@ flag rgfProg[cRing+1] = {0, fFalse, fFalse, fFalse, fFalse, fFalse, fFalse};
 ******************************************************************************
 */
 
-real force[objMax];
+TLOCAL real force[objMax];
 GridInfo *grid = NULL;
-int rgobjList[objMax], rgobjList2[objMax], starname[cStar+1], kObjA[objMax];
+TLOCAL int rgobjList[objMax], rgobjList2[objMax], kObjA[objMax];
+int starname[cStar+1];
 char *szWheel[cRing+1] = {NULL, NULL, NULL, NULL, NULL, NULL, NULL};
-real rStarBrightDef[cStar+1] = {-1.0}, rStarBright[cStar+1],
-  rStarBrightDistDef[cStar+1];
+TLOCAL real rStarBright[cStar+1];
+real rStarBrightDef[cStar+1] = {-1.0}, rStarBrightDistDef[cStar+1];
 char *szStarCustom[cStar+1];
 
 // Restriction status of each object, as specified with -R switch.
 
-byte ignore[objMax] = {1,
+TLOCAL byte ignore[objMax] = {1,
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                     // Planets
   0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0,                  // Minors
   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,               // Cusps
@@ -61,7 +61,7 @@
 ******************************************************************************
 */
 
-#define cfunA 484
+#define cfunA 486
 #ifdef GRAPH
 #define cfunX 73
 #else
@@ -143,6 +143,45 @@ typedef struct _parameter {
   flag fReal; // Whether parameter is real or integer
 } PAR;
 
+// Parameter to a function that the function evaluates itself, if and when
+// it needs to, such as the body of a loop.
+
+typedef struct _deferred {
+  CONST char *pch;     // Text of parameter, when parsing from text
+  CONST struct _instruction *pins; // Code for parameter, when running code
+} DEF;
+
+// Instruction within a compiled AstroExpression. Code is in the same prefix
+// order as the expression text, with each function followed by the code for
+// each of its parameters, so it can be run without parsing anything.
+
+typedef struct _instruction {
+  int op;   // Index of function, or one of the op values below
+  int cins; // Number of instructions in this parameter, including itself
+  PAR par;  // Literal value, or index of variable in par.n
+} INS;
+
+#define opEnd -1 // End of code for all expressions in string
+#define opLit -2 // Literal number or constant
+#define opVar -3 // Value of custom variable
+
+// Compiled AstroExpression, cached by the string pointer it came from.
+
+typedef struct _expressioncache {
+  CONST char *szKey; // String expression was compiled from
+  char *szSrc;       // Copy of string contents when compiled
+  INS *rgins;        // Compiled code, or NULL if it can't be compiled
+  int cRef;          // Number of runs of this code in progress
+} EXC;
+
+#define cExpCache 64
+
+#define tokNone 0 // Unknown token
+#define tokLit  1 // Number or named constant
+#define tokVar  2 // Value of custom variable
+#define tokFun  3 // Function
+#define tokDyn  4 // Named constant that may change between evaluations
+
 typedef struct _AstroexpressionInternal {
   TRIE rgsTrieFun;      // Trie tree of tokens for AstroExpression parsing
   PAR *rgparVar;        // List of custom variables
@@ -151,13 +190,17 @@ typedef struct _AstroexpressionInternal {
   int cszExpMacro;      // Size of list of AstroExpression macros
   char **rgszExpStr;    // List of AstroExpression strings
   int cszExpStr;        // Size of list of AstroExpression strings
+  EXC rgexc[cExpCache]; // Cache of compiled AstroExpressions
+  int iexcNext;         // Next cache slot to reuse when cache is full
 } XI;
 
-XI xi = {NULL, NULL, 0, NULL, 0, NULL, 0};
+XI xi = {NULL, NULL, 0, NULL, 0, NULL, 0, {{NULL, NULL, NULL, 0}}, 0};
 
 extern int ILookupTrie P((CONST TRIE, CONST char *, int, flag));
 extern CONST char *PchGetParameter P((CONST char *, PAR *, int, int, flag));
 extern void GetParameter P((CONST char *, PAR *));
+extern CONST INS *PinsRunParameter P((CONST INS *, PAR *));
+extern void EvalDeferred P((CONST DEF *, PAR *, int));
 extern void FormatSz P((CONST char *, char *));
 extern flag FEnsureParVar P((int));
 
@@ -359,6 +402,8 @@ enum _functionindex {
   funAlloc,
   funAllocT,
   funAllocS,
+  funCastHit,
+  funCastMis,
   funAsnObj,
   funAsnHou,
 
@@ -940,6 +985,8 @@ CONST FUN rgfun[cfun] = {
 {funAlloc,   "Alloc",    0, I_},
 {funAllocT,  "AllocTot", 0, I_},
 {funAllocS,  "AllocSiz", 0, I_},
+{funCastHit, "CastHit",  0, I_},
+{funCastMis, "CastMiss", 0, I_},
 {funAsnObj,  "=Obj",     4, R_IIII},
 {funAsnHou,  "=Hou",     4, R_IIII},
 
@@ -1230,7 +1277,7 @@ void UpperRgch(char *rgch, int cch)
 // Evaluate a function, generating the number it evaluates to, given a list of
 // parameters to the function.
 
-flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
+flag FEvalFunction(int ifun, PAR *rgpar, CONST DEF rgdef[2])
 {
   int ipar, nType, n = 0, n1, n2, n3, n4;
   real r = 0.0, r1, r2, r3, r4;
@@ -1642,6 +1689,8 @@ flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
   case funAlloc:   n = is.cAlloc;      break;
   case funAllocT:  n = is.cAllocTotal; break;
   case funAllocS:  n = is.cbAllocSize; break;
+  case funCastHit: n = is.cCastHit;    break;
+  case funCastMis: n = is.cCastMiss;   break;
   case funAsnObj:
     if (FRingObj(n1, n2) && FRingObj(n3, n4)) {
       r = rgpcp[n1]->obj[n2] = rgpcp[n3]->obj[n4];
@@ -1963,39 +2012,39 @@ flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
     fRetReal = fFalse;
     n = (n1 != 0);
     if (n) {
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(&rgdef[0], &rgpar[0], ifun);
       goto LParseRet;
     }
     break;
   case funIfElse:
     n = (n1 != 0);
-    PchGetParameter(rgpchEval[!n], &rgpar[0], ifun, 1, fTrue);
+    EvalDeferred(&rgdef[!n], &rgpar[0], ifun);
     goto LParseRet;
     break;
   case funDoCount:
     fRetReal = fFalse;
     for (n = 0; n < n1; n++)
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(&rgdef[0], &rgpar[0], ifun);
     if (n > 0)
       goto LParseRet;
     break;
   case funWhile:
     fRetReal = fFalse;
     loop {
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(&rgdef[0], &rgpar[0], ifun);
       if (!(rgpar[0].fReal ? rgpar[0].r != 0.0 : rgpar[0].n != 0))
         break;
-      PchGetParameter(rgpchEval[1], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(&rgdef[1], &rgpar[0], ifun);
       fRetReal = rgpar[0].fReal;
       EIR(rgpar[0].n, rgpar[0].r);
     }
     break;
   case funDoWhile:
     do {
-      PchGetParameter(rgpchEval[1], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(&rgdef[1], &rgpar[0], ifun);
       fRetReal = rgpar[0].fReal;
       EIR(rgpar[0].n, rgpar[0].r);
-      PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+      EvalDeferred(&rgdef[0], &rgpar[0], ifun);
     } while (rgpar[0].fReal ? rgpar[0].r != 0.0 : rgpar[0].n != 0);
     break;
   case funFor:
@@ -2003,7 +2052,7 @@ flag FEvalFunction(int ifun, PAR *rgpar, char *rgpchEval[2])
       xi.rgparVar[n1] = rgpar[2];
       for (xi.rgparVar[n1].n = n2; xi.rgparVar[n1].n <= n3;
         xi.rgparVar[n1].n++)
-        PchGetParameter(rgpchEval[0], &rgpar[0], ifun, 1, fTrue);
+        EvalDeferred(&rgdef[0], &rgpar[0], ifun);
       n = xi.rgparVar[n1].n;
     } else
       n = 0;
@@ -2069,69 +2118,78 @@ LParseRet:
 }
 
 
-// Read a parameter to an action from a command line, given the current
-// position into the command line string. Return the evaluation of the
-// parameter in either a string or numeric return variable, or null on error.
-// Also update the command line position to point after the parameter.
+// Return which deferred slot a parameter to a function should be placed in,
+// for parameters that shouldn't be evaluated before the function is called
+// but are evaluated by the function itself. Return -1 for normal parameters.
 
-CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
-  int iParam, flag fEval)
+int IParamDeferred(int ifun, int iParam)
 {
-  char sz[cchSzMax*2], szT[cchSzMax], ch1, ch, *pchEdit;
-  CONST char *rgpchEval[2], *pchParam, *pchT;
-  int ifunT, iParamT, cch, n;
-  real r;
-  PAR rgpar2[4+1];
-  flag fSkipEval;
+  if (((ifun == funIf || ifun == funIfElse || ifun == funDoCount) &&
+      iParam == 2) ||
+    ((ifun == funWhile || ifun == funDoWhile) && iParam == 1) ||
+    (ifun == funFor && iParam == 4))
+    return 0;
+  if ((ifun == funIfElse && iParam == 3) ||
+    ((ifun == funWhile || ifun == funDoWhile) && iParam == 2))
+    return 1;
+  return -1;
+}
 
-  // Skip whitespace.
-  while (*pchCur == ' ')
-    pchCur++;
-  if (*pchCur == chNull) {
-    if (ifun >= 0) {
-      sprintf(szT, " (%d required) of function %s", rgfun[ifun].nParam,
-        rgfun[ifun].szName);
-    } else
-      *szT = chNull;
-    sprintf(sz, "Couldn't get parameter %d%s due to end of line.\n", iParam,
-      szT);
-    PrintWarning(sz);
-    goto LError;
-  }
 
-  // Get parameter string.
-  for (pchParam = pchCur; *pchCur && *pchCur != ' '; pchCur++)
-    ;
-  cch = (int)(pchCur - pchParam);
-  ch1 = *pchParam;
+// Evaluate a parameter to a function that was deferred until the function
+// itself needs it, running its compiled code or else parsing its text.
+
+void EvalDeferred(CONST DEF *pdef, PAR *ppar, int ifun)
+{
+  if (pdef->pins != NULL)
+    PinsRunParameter(pdef->pins, ppar);
+  else
+    PchGetParameter(pdef->pch, ppar, ifun, 1, fTrue);
+}
+
+
+// Determine what a token within an expression is, given its text. Returns
+// tokLit for numbers and named constants with the value placed in ppar,
+// tokVar for the value of a variable with its index placed in pn, tokFun
+// for a function with its index placed in pn, or tokNone if unknown. If
+// fStatic is set, return tokDyn for named constants that can't be evaluated
+// ahead of time because they may change between evaluations.
 
-  // Evaluate the parameter. First check for integer or real number.
+int TokParse(CONST char *pchParam, int cch, PAR *ppar, int *pn, flag fStatic)
+{
+  char szT[cchSzMax], ch1, ch;
+  CONST char *pchT;
+  int n;
+  real r;
+
+  // First check for integer or real number.
+  ch1 = *pchParam;
   if (FNumCh(ch1) || ((ch1 == '-' || ch1 == '#') && cch > 1)) {
-    for (pchT = pchParam; pchT < pchCur; pchT++)
+    for (pchT = pchParam; pchT < pchParam + cch; pchT++)
       if (*pchT == '.') {
-        rgpar[0].r = atof(pchParam);
-        rgpar[0].fReal = fTrue;
-        goto LDone;
+        ppar->r = atof(pchParam);
+        ppar->fReal = fTrue;
+        return tokLit;
       }
 
     CopyRgchToSz(pchParam, cch, szT, cchSzMax);
-    rgpar[0].n = NFromSz(szT);
-    rgpar[0].fReal = fFalse;
-    goto LDone;
+    ppar->n = NFromSz(szT);
+    ppar->fReal = fFalse;
+    return tokLit;
   }
 
   // Check for variable name.
   if (ch1 == '%') {
     ch = ChCap(pchParam[1]);
     if (FCapCh(ch)) {
-      rgpar[0].n = ch - '@';
-      rgpar[0].fReal = fFalse;
-      goto LDone;
+      ppar->n = ch - '@';
+      ppar->fReal = fFalse;
+      return tokLit;
     }
     if (FNumCh(ch)) {
-      rgpar[0].n = atoi(pchParam + 1);
-      rgpar[0].fReal = fFalse;
-      goto LDone;
+      ppar->n = atoi(pchParam + 1);
+      ppar->fReal = fFalse;
+      return tokLit;
     }
   }
 
@@ -2139,18 +2197,12 @@ CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
   if (ch1 == '@') {
     ch = ChCap(pchParam[1]);
     if (FCapCh(ch)) {
-      n = ch - '@';
-      if (!FEnsureParVar(n+1))
-        goto LError;
-      rgpar[0] = xi.rgparVar[n];
-      goto LDone;
+      *pn = ch - '@';
+      return tokVar;
     }
     if (FNumCh(ch)) {
-      n = atoi(pchParam + 1);
-      if (!FEnsureParVar(n+1))
-        goto LError;
-      rgpar[0] = xi.rgparVar[n];
-      goto LDone;
+      *pn = atoi(pchParam + 1);
+      return tokVar;
     }
   }
 
@@ -2159,6 +2211,9 @@ CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
     for (pchT = pchParam+2, n = 0; *pchT && *pchT > ' '; pchT++, n++)
       szT[n] = *pchT;
     szT[n] = chNull;
+    // Offsets and nested expressions within constants aren't fixed values.
+    if (fStatic && (ChCap(ch1) == 'Z' || szT[0] == '~'))
+      return tokDyn;
     n = -1; r = -rLarge;
     switch (ChCap(ch1)) {
     case 'M': n = NParseSz(szT, pmMon);    break;
@@ -2171,43 +2226,89 @@ CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
     case 'Z': r = RParseSz(szT, pmOffset); break;
     }
     if (n >= 0) {
-      rgpar[0].n = n;
-      rgpar[0].fReal = fFalse;
-      goto LDone;
+      ppar->n = n;
+      ppar->fReal = fFalse;
+      return tokLit;
     } else if (r >= -rLarge) {
-      rgpar[0].r = r;
-      rgpar[0].fReal = fTrue;
-      goto LDone;
+      ppar->r = r;
+      ppar->fReal = fTrue;
+      return tokLit;
     }
   }
 
   // Check for function.
-  ifunT = ILookupTrie(xi.rgsTrieFun, pchParam, cch, fTrue);
-  if (ifunT >= 0) {
-    rgpchEval[0] = rgpchEval[1] = NULL;
+  n = ILookupTrie(xi.rgsTrieFun, pchParam, cch, fTrue);
+  if (n >= 0) {
+    *pn = n;
+    return tokFun;
+  }
+  return tokNone;
+}
+
+
+// Read a parameter to an action from a command line, given the current
+// position into the command line string. Return the evaluation of the
+// parameter in either a string or numeric return variable, or null on error.
+// Also update the command line position to point after the parameter.
+
+CONST char *PchGetParameter(CONST char *pchCur, PAR *rgpar, int ifun,
+  int iParam, flag fEval)
+{
+  char sz[cchSzMax*2], szT[cchSzMax], *pchEdit;
+  CONST char *pchParam, *pchT;
+  int ifunT, iParamT, iDef, cch, n;
+  PAR rgpar2[4+1];
+  DEF rgdef[2];
+
+  // Skip whitespace.
+  while (*pchCur == ' ')
+    pchCur++;
+  if (*pchCur == chNull) {
+    if (ifun >= 0) {
+      sprintf(szT, " (%d required) of function %s", rgfun[ifun].nParam,
+        rgfun[ifun].szName);
+    } else
+      *szT = chNull;
+    sprintf(sz, "Couldn't get parameter %d%s due to end of line.\n", iParam,
+      szT);
+    PrintWarning(sz);
+    goto LError;
+  }
+
+  // Get parameter string.
+  for (pchParam = pchCur; *pchCur && *pchCur != ' '; pchCur++)
+    ;
+  cch = (int)(pchCur - pchParam);
+
+  // Evaluate the parameter.
+  switch (TokParse(pchParam, cch, &rgpar[0], &n, fFalse)) {
+  case tokLit:
+    goto LDone;
+
+  case tokVar:
+    if (!FEnsureParVar(n+1))
+      goto LError;
+    rgpar[0] = xi.rgparVar[n];
+    goto LDone;
+
+  case tokFun:
+    ifunT = n;
+    rgdef[0].pch = rgdef[1].pch = NULL;
+    rgdef[0].pins = rgdef[1].pins = NULL;
 
     // Recursively get the parameters to the function.
     for (iParamT = 1; iParamT <= rgfun[ifunT].nParam; iParamT++) {
-      fSkipEval = fFalse;
       // Some parameters shouldn't be evaluated yet, but just skipped over.
-      if (((ifunT == funIf || ifunT == funIfElse || ifunT == funDoCount) &&
-          iParamT == 2) ||
-        ((ifunT == funWhile || ifunT == funDoWhile) && iParamT == 1) ||
-        (ifunT == funFor && iParamT == 4)) {
-        fSkipEval = fTrue;
-        rgpchEval[0] = pchCur;
-      } else if ((ifunT == funIfElse && iParamT == 3) ||
-        ((ifunT == funWhile || ifunT == funDoWhile) && iParamT == 2)) {
-        fSkipEval = fTrue;
-        rgpchEval[1] = pchCur;
-      }
+      iDef = IParamDeferred(ifunT, iParamT);
+      if (iDef >= 0)
+        rgdef[iDef].pch = pchCur;
       pchCur = PchGetParameter(pchCur, &rgpar2[iParamT], ifunT, iParamT,
-        fEval && !fSkipEval);
+        fEval && iDef < 0);
       if (pchCur == NULL)
         return NULL;
     }
     if (fEval) {
-      if (!FEvalFunction(ifunT, rgpar2, (char **)rgpchEval))
+      if (!FEvalFunction(ifunT, rgpar2, rgdef))
         return NULL;
       rgpar[0] = rgpar2[0];
     }
@@ -2235,12 +2336,203 @@ LDone:
 }
 
 
+// Compile one parameter of an expression into code, given the current
+// position into the expression string. Instructions are appended to rgins
+// starting at index *piins. Return the position in the string after the
+// parameter, or null if the parameter can't be compiled, in which case the
+// expression should be parsed from its text so any errors get reported.
+
+CONST char *PchCompileParameter(CONST char *pchCur, INS *rgins, int *piins)
+{
+  CONST char *pchParam;
+  INS *pins;
+  int iins, iParam, cch, n;
+
+  // Skip whitespace.
+  while (*pchCur == ' ')
+    pchCur++;
+  if (*pchCur == chNull)
+    return NULL;
+
+  // Get parameter string.
+  for (pchParam = pchCur; *pchCur && *pchCur != ' '; pchCur++)
+    ;
+  cch = (int)(pchCur - pchParam);
+
+  iins = (*piins)++;
+  pins = &rgins[iins];
+  ClearB((pbyte)pins, sizeof(INS));
+  switch (TokParse(pchParam, cch, &pins->par, &n, fTrue)) {
+  case tokLit:
+    pins->op = opLit;
+    break;
+  case tokVar:
+    pins->op = opVar;
+    pins->par.n = n;
+    break;
+  case tokFun:
+    pins->op = n;
+    for (iParam = 1; iParam <= rgfun[n].nParam; iParam++) {
+      pchCur = PchCompileParameter(pchCur, rgins, piins);
+      if (pchCur == NULL)
+        return NULL;
+    }
+    break;
+  default:
+    return NULL;
+  }
+  rgins[iins].cins = *piins - iins;
+  return pchCur;
+}
+
+
+// Compile a string containing a sequence of expressions. Return the code in
+// a newly allocated buffer, or null if the string can't be compiled.
+
+INS *RginsCompileExpression(CONST char *sz)
+{
+  INS *rgins;
+  CONST char *pch;
+  int cins = 1, iins = 0;
+
+  // Each token becomes one instruction, plus one more to end the code.
+  for (pch = sz; *pch; pch++)
+    if (*pch != ' ' && (pch == sz || pch[-1] == ' '))
+      cins++;
+  rgins = RgAllocate(cins, INS, "expression");
+  if (rgins == NULL)
+    return NULL;
+  pch = sz;
+  do {
+    pch = PchCompileParameter(pch, rgins, &iins);
+    if (pch == NULL) {
+      DeallocateP(rgins);
+      return NULL;
+    }
+  } while (*pch != chNull);
+  rgins[iins].op = opEnd;
+  rgins[iins].cins = 1;
+  return rgins;
+}
+
+
+// Run the compiled code for one parameter of an expression, placing its
+// value in ppar. Like PchGetParameter() but with all parsing already done.
+// Return the instruction after the parameter, or null on error.
+
+CONST INS *PinsRunParameter(CONST INS *pins, PAR *ppar)
+{
+  CONST INS *pinsCur;
+  int ifun, iParam, iDef, n;
+  PAR rgpar2[4+1];
+  DEF rgdef[2];
+
+  if (pins->op == opLit) {
+    *ppar = pins->par;
+    return pins + 1;
+  } else if (pins->op == opVar) {
+    n = pins->par.n;
+    if (!FEnsureParVar(n+1)) {
+      us.fExpOff = fTrue;
+      return NULL;
+    }
+    *ppar = xi.rgparVar[n];
+    return pins + 1;
+  }
+
+  // Run the code for each parameter, then evaluate the function itself.
+  ifun = pins->op;
+  rgdef[0].pch = rgdef[1].pch = NULL;
+  rgdef[0].pins = rgdef[1].pins = NULL;
+  pinsCur = pins + 1;
+  for (iParam = 1; iParam <= rgfun[ifun].nParam; iParam++) {
+    iDef = IParamDeferred(ifun, iParam);
+    if (iDef >= 0) {
+      // Skip over parameters the function will run itself.
+      rgdef[iDef].pins = pinsCur;
+      rgpar2[iParam].n = 0; rgpar2[iParam].r = 0.0;
+      rgpar2[iParam].fReal = fFalse;
+      pinsCur += pinsCur->cins;
+      continue;
+    }
+    pinsCur = PinsRunParameter(pinsCur, &rgpar2[iParam]);
+    if (pinsCur == NULL)
+      return NULL;
+  }
+  if (!FEvalFunction(ifun, rgpar2, rgdef))
+    return NULL;
+  *ppar = rgpar2[0];
+  return pinsCur;
+}
+
+
+// Return the cache entry with compiled code for an expression string,
+// compiling it if this string pointer and contents haven't been seen
+// before. Return null if the expression has to be parsed from its text.
+
+EXC *PexcCompileExpression(CONST char *sz)
+{
+  EXC *pexc = NULL;
+  int iexc, i;
+
+  for (iexc = 0; iexc < cExpCache; iexc++)
+    if (xi.rgexc[iexc].szKey == sz) {
+      pexc = &xi.rgexc[iexc];
+      if (FEqSz(pexc->szSrc, sz))
+        return pexc->rgins != NULL ? pexc : NULL;
+      // String has been changed since it was compiled.
+      if (pexc->cRef > 0)
+        return NULL;
+      break;
+    }
+
+  // Find a slot for the new expression, reusing the oldest if all in use.
+  if (pexc == NULL) {
+    for (iexc = 0; iexc < cExpCache; iexc++)
+      if (xi.rgexc[iexc].szKey == NULL) {
+        pexc = &xi.rgexc[iexc];
+        break;
+      }
+    for (i = 0; pexc == NULL && i < cExpCache; i++) {
+      iexc = xi.iexcNext;
+      xi.iexcNext = (xi.iexcNext + 1) % cExpCache;
+      if (xi.rgexc[iexc].cRef <= 0)
+        pexc = &xi.rgexc[iexc];
+    }
+    if (pexc == NULL)
+      return NULL;
+  }
+  DeallocatePIf(pexc->rgins);
+  pexc->rgins = NULL;
+  pexc->szKey = NULL;
+  pexc->cRef = 0;
+  if (!FCloneSz(sz, &pexc->szSrc))
+    return NULL;
+  pexc->szKey = sz;
+  pexc->rgins = RginsCompileExpression(sz);
+  return pexc->rgins != NULL ? pexc : NULL;
+}
+
+
 // Like PchGetParameter() but parse multiple expressions in sequence in a
 // string, placing the value of the last expressions within parameter par.
+// Expressions are compiled the first time they're seen, and the compiled
+// code is run from then on, which is much faster than parsing them again.
 
 void GetParameter(CONST char *sz, PAR *ppar)
 {
   CONST char *pch = sz;
+  CONST INS *pins;
+  EXC *pexc;
+
+  pexc = PexcCompileExpression(sz);
+  if (pexc != NULL) {
+    pexc->cRef++;
+    for (pins = pexc->rgins; pins != NULL && pins->op != opEnd; )
+      pins = PinsRunParameter(pins, ppar);
+    pexc->cRef--;
+    return;
+  }
 
   do {
     pch = PchGetParameter(pch, ppar, -1, 1, fTrue);
@@ -2874,6 +3166,10 @@ void ExpFinalize(void)
 {
   int i;
 
+  for (i = 0; i < cExpCache; i++) {
+    DeallocatePIf(xi.rgexc[i].szSrc);
+    DeallocatePIf(xi.rgexc[i].rgins);
+  }
   DeallocatePIf(xi.rgsTrieFun);
   DeallocatePIf(xi.rgparVar);
   if (xi.rgszExpMacro != NULL) {
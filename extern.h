@@ -146,21 +146,24 @@ extern void FinalizeProgram P((flag));
 #define FCmMatrix() (!us.fEphemFiles && us.fMatrixPla)
 #define FCmJPLWeb() (us.fEphemFiles && !us.fPlacalcPla && us.nSwissEph >= 3)
 
-extern US us;
-extern IS is;
-extern CI ciCore, ciMain, ciTwin, ciThre, ciFour, ciFive, ciHexa,
+extern TLOCAL US us;
+extern TLOCAL IS is;
+extern TLOCAL CI ciCore, ciMain;
+extern CI ciTwin, ciThre, ciFour, ciFive, ciHexa,
   ciDefa, ciTran, ciSave, ciGreg;
-extern CP cp0, cp1, cp2, cp3, cp4, cp5, cp6;
-extern CP * CONST rgpcp[cRing+1];
-extern CI * CONST rgpci[cRing+1];
+extern TLOCAL CP cp0;
+extern CP cp1, cp2, cp3, cp4, cp5, cp6;
+#define rgpcp (RgpcpRing())
+#define rgpci (RgpciRing())
 extern flag rgfProg[cRing+1];
 
-extern real force[objMax];
+extern TLOCAL real force[objMax];
 extern GridInfo *grid;
-extern int rgobjList[objMax], rgobjList2[objMax], starname[cStar+1],
-  kObjA[objMax];
+extern TLOCAL int rgobjList[objMax], rgobjList2[objMax], kObjA[objMax];
+extern int starname[cStar+1];
 
-extern byte ignore[objMax], ignore2[objMax], ignorea[cAspect+1],
+extern TLOCAL byte ignore[objMax];
+extern byte ignore2[objMax], ignorea[cAspect+1],
   ignorez[arMax], ignore7[rrMax], pluszone[cSector+1];
 extern byte ignoreMem[objMax], ignore2Mem[objMax], ignoreaMem[cAspect+1],
   ignorezMem[arMax], ignore7Mem[rrMax], ignorefMem[6];
@@ -219,8 +222,8 @@ extern CONST StrLookR rgZodiacOffset[];
 extern CONST char *szNakshatra[cNakshat+1], *rgszDecan[ddMax],
   *szEclipse[etMax], rgchEclipse[etMax+1], *szAppSep[6], rgchAppSep[6+1];
 
-extern real rStarBrightDef[cStar+1], rStarBright[cStar+1],
-  rStarBrightDistDef[cStar+1];
+extern TLOCAL real rStarBright[cStar+1];
+extern real rStarBrightDef[cStar+1], rStarBrightDistDef[cStar+1];
 extern char *szStarCustom[cStar+1];
 extern CONST char *szObjDisp[objMax], *szAspectDisp[cAspect2+1],
   *szAspectAbbrevDisp[cAspect2+1], *szAspectGlyphDisp[cAspect2+1];
@@ -283,6 +286,8 @@ extern flag FMatchSz P((CONST char *, CONST char *));
 extern CONST char *SzInList P((CONST char *, CONST char *, int *));
 extern void ClearB P((pbyte, int));
 extern void CopyRgb P((CONST byte *, byte *, int));
+extern flag FEqRgb P((CONST byte *, CONST byte *, int));
+extern dword LHashRgb P((CONST byte *, int, dword));
 extern void CopyRgchToSz P((CONST char *, int, char *, int));
 extern real RSgn P((real));
 extern real RAngle P((real, real));
@@ -366,6 +371,7 @@ extern int NFromAltN P((int));
 extern char *SzProcessProgname P((char *));
 extern flag FAppendCIList P((CONST CI *));
 extern flag FSortCIList P((int));
+extern flag FMatchCIFilter P((CONST CI *, CONST char *, CONST char *));
 extern void FilterCIList P((CONST char *, CONST char *));
 extern flag FEnumerateCIList P((int));
 extern int UTF8ToWch P((CONST uchar *, wchar *));
@@ -384,6 +390,11 @@ extern char *SzClone P((char *));
 extern pbyte PAllocate P((long, CONST char *));
 extern void DeallocateP P((void *));
 extern pbyte RgReallocate P((void *, int, int, int, CONST char *));
+extern void InitEventList P((EL *, int));
+extern flag FEnsureEvents P((EL *, int));
+extern flag FAppendEvents P((EL *, CONST byte *, int));
+extern void RemoveEvents P((EL *, int));
+extern void FreeEventList P((EL *));
 extern flag FEnsureMacro P((int));
 #ifdef DEBUG
 extern void Assert P((flag));
@@ -469,7 +480,24 @@ extern void CoorXformFast P((real *, real *,
   real, real, real, real, real, real));
 extern void ProcessPlanet P((int, real));
 extern void ComputeEphem P((real));
+extern real CastChartCore P((int, flag, flag));
+extern flag FCastCacheOk P((void));
+extern dword LCastHash P((void));
+extern dword LCastKey P((dword));
+extern flag FSizeCastCache P((int));
+extern int IceFindCast P((dword, dword));
+extern void SaveCastEntry P((int, dword, dword));
 extern real CastChart P((int));
+extern flag FCastObjectsOk P((flag));
+extern real CastObjects P((int, flag));
+extern CI * CONST *RgpciRing P((void));
+extern CP * CONST *RgpcpRing P((void));
+extern void InitChartContext P((CC *, CONST CI *));
+extern void UseChartContext P((CONST CC *));
+extern flag FCastThreadSafe P((void));
+extern int NThreadCount P((void));
+extern void RunJobs P((PFNJOB, void *, int));
+extern void PrecastCIList P((CONST int *, int, flag));
 extern void CastSectors P((void));
 extern flag FEnsureGrid P((void));
 extern flag FAcceptAspect P((int, int, int));
@@ -484,7 +512,11 @@ extern int NCheckEclipseSolar P((int, int, int, real *));
 extern int NCheckEclipse P((int, int, real *));
 extern int NCheckEclipseLunar P((int, int, int, real *));
 extern int NCheckEclipseAny P((int, int, int, real *));
-extern int NCheckEclipseSolarLoc P((real, real, real *));
+extern int NCheckEclipseDisks P((real, real, real, real, real, real, real,
+  real *));
+extern flag FSunFromLoc P((real, real, PT3R *));
+extern flag FInitSolarShadow P((SH *));
+extern int NCheckSolarShadow P((CONST SH *, real, real, real *));
 extern void CreateElemTable P((ET *));
 
 #ifdef SWISS
@@ -494,12 +526,14 @@ extern int rgObjSwiss[cCust], rgTypSwiss[cCust], rgPntSwiss[cCust],
 
 extern flag FSwissPlanet
   P((int, real, int, real *, real *, real *, real *, real *, real *));
+extern void SwissChartVars P((real, real *, real *, real *));
 extern void SwissHouse P((real, real, real, int,
   real *, real *, real *, real *, real *, real *, real *, real *));
 extern void SwissComputeStars P((real, flag));
 extern flag SwissComputeStar P((real, ES *));
 extern flag SwissComputeStarSort P((real, ES *));
 extern flag SwissTestStar P((char *));
+extern flag FSwissCompileStars P((void));
 extern flag SwissComputeAsteroid P((real, ES *, flag));
 extern flag SwissComputeAsteroidSort P((real, ES *));
 extern void SwissGetObjName P((char *, int));
@@ -507,6 +541,7 @@ extern flag FSwissPlanetData P((real, int, real *, real *, real *));
 extern real SwissRefract P((real));
 extern void SwissGetFileData P((real *, real *));
 extern real SwissLatLmt P((real));
+extern void SwissClose P((void));
 extern real SwissJulDay P((int, int, int, real, int));
 extern void SwissRevJul P((real, int, int *, int *, int *, real *));
 #else
@@ -682,6 +717,12 @@ extern char *SzCity P((int));
 extern flag FEnsureAtlas P((void));
 extern flag FEnsureTimezoneChanges P((void));
 extern flag FLoadAtlas P((FILE *, int));
+extern flag FEnsureAtlasIndex P((void));
+extern int CposLookupAtlas P((CONST char *, int **, int *));
+extern flag FEnsureAtlasGrid P((void));
+extern flag FLoadAtlasSnapshot P((void));
+extern flag FLoadZoneSnapshot P((void));
+extern flag FAtlasCompileSnapshot P((void));
 extern flag FLoadZoneRules P((FILE *, int, int));
 extern flag FLoadZoneChanges P((FILE *, int, int));
 extern flag FLoadZoneLinks P((FILE *, int));
@@ -689,6 +730,9 @@ extern flag DisplayAtlasLookup P((CONST char *, size_t, int *));
 extern flag DisplayAtlasNearby P((real, real, size_t, int *, flag));
 extern void AdjustTime P((int *, int *, int *, int *));
 extern flag DisplayTimezoneChanges P((int, size_t, CI *));
+extern void FreeZoneTables P((void));
+extern flag FZoneDstFromIzn P((CI *, int, flag));
+extern long LZoneValid P((CONST CI *, int));
 extern real ZondefFromIzn P((int));
 #endif
 
@@ -842,7 +886,8 @@ extern KI KiCity P((int));
 
 // From xdevice.cpp
 
-#define PutByte(n) putc((byte)(n), file)
+#define PutByte(n) (gi.ibOut < cbOutBuf ? \
+  (void)(gi.rgbOut[gi.ibOut++] = (byte)(n)) : PutByteBuf(file, (byte)(n)))
 #define PutWord(n) PutByte(BLo(n)); PutByte(BHi(n))
 #define PutLong(n) PutWord(WLo(n)); PutWord(WHi(n))
 #define getword() WRead(file)
@@ -901,6 +946,10 @@ extern KI GetXY P((int, int));
 extern KI BmGetXY P((int, int));
 extern flag FAllocateBmp P((Bitmap *, int, int));
 extern flag FLoadBmp P((CONST char *, Bitmap *, flag));
+extern void FlushOutBuf P((FILE *));
+extern void PutByteBuf P((FILE *, byte));
+extern void PutRgb P((FILE *, CONST byte *, int));
+extern int CkvBmpPalette P((CONST Bitmap *, KV *, int, byte **));
 extern void BmpCopyBlock P((CONST Bitmap *, int, int, int, int,
   Bitmap *, int, int, int, int));
 #ifdef WINANY
@@ -909,6 +958,8 @@ extern flag FBmpCopyFromWin P((Bitmap *, HDC, HBITMAP));
 extern flag FBmpShrinkToWin P((HDC, HBITMAP, HDC));
 #endif
 extern flag FBmpDrawBack P((Bitmap *));
+extern void MapProjRow P((int, real *, flag));
+extern flag FEnsureMapProj P((real *));
 extern flag FBmpDrawMap P((void));
 extern flag FBmpDrawMap2 P((int, int, int, int, real, real, real, real));
 extern flag FBmpAntialias P((void));
@@ -215,6 +215,28 @@ void CopyRgb(CONST byte *pbSrc, byte *pbDst, int cb)
 }
 
 
+// Return whether two ranges of bytes are equal.
+
+flag FEqRgb(CONST byte *pb1, CONST byte *pb2, int cb)
+{
+  while (cb-- > 0)
+    if (*pb1++ != *pb2++)
+      return fFalse;
+  return fTrue;
+}
+
+
+// Combine a given number of bytes into a running FNV-1a hash value, which
+// should start out as lHashInit.
+
+dword LHashRgb(CONST byte *rgb, int cb, dword lHash)
+{
+  while (cb-- > 0)
+    lHash = (lHash ^ *rgb++) * 16777619UL;
+  return lHash;
+}
+
+
 // Copy a range of characters and zero terminate it. If there are too many
 // characters to fit in the destination buffer, the string is truncated.
 
@@ -1123,14 +1145,15 @@ real RObjDiam(int obj)
 // Print a string on the screen. A seemingly simple operation, however
 // keep track of what column are printing at after each newline so can
 // automatically clip at the appropriate point, and keep track of the row
-// printing at too, so can prompt before screen scrolling.
+// printing at too, so can prompt before screen scrolling. Runs of plain
+// ASCII text don't need conversion, so are written out as a block.
 
 void PrintSz(CONST char *sz)
 {
-  char szInput[cchSzDef], *pch;
+  char szInput[cchSzDef], *pch, *pch2;
   wchar wch;
   int ch, dch;
-  flag fWantIBM = fFalse;
+  flag fWantIBM = fFalse, fBlock = fTrue;
 #ifndef WIN
   int fT;
 #endif
@@ -1140,8 +1163,34 @@ void PrintSz(CONST char *sz)
 #ifdef WINANY
   if (is.S == stdout)
     fWantIBM = fTrue;
+#endif
+#ifdef WIN
+  if (is.S == stdout)
+    fBlock = fFalse;
 #endif
   for (pch = (char *)sz; *pch; pch++) {
+    if (fBlock) {
+      // Find run of printable ASCII characters, which all character sets
+      // leave as is, and which don't need escaping in HTML text.
+      for (pch2 = pch; FBetween((uchar)*pch2, ' ', '~'); pch2++)
+        if (is.nHTML == 1 && (*pch2 == '<' || *pch2 == '>' ||
+          *pch2 == '&' || *pch2 == '\"' ||
+          (*pch2 == ' ' && (pch2 <= sz || *(pch2+1) <= ' '))))
+          break;
+      if (pch2 > pch) {
+        ch = (int)(pch2 - pch);
+        dch = ch;
+        if (is.nHTML != 2) {
+          if (us.fClip80)  // Clip if needed.
+            dch = Max(0, Min(ch, us.nScreenWidth - 1 - is.cchCol));
+          is.cchCol += ch;
+        }
+        if (dch > 0)
+          fwrite(pch, 1, dch, is.S);
+        pch = pch2 - 1;
+        continue;
+      }
+    }
     ch = (uchar)*pch;
     if (ch != '\n') {
       if (is.nHTML != 2) {
@@ -2321,14 +2370,24 @@ void GetTimeNow(int *mon, int *day, int *yea, real *tim, real dst, real zon)
   *tim = (jd - RFloor(jd)) * 24.0;
   JulianToMdy(jd - 0.5, mon, day, yea);
 #else
-  time_t curtimer;
+  // Atlas city and Daylight setting last autodetected, and the range of
+  // seconds since 1970 over which that setting is known to stay the same.
+  static char szLocNow[cchSzMax], *szCityNow = NULL;
+  static AtlasEntry *rgaeNow = NULL;
+  static int iaeNow = -1, caeNow = 0;
+  static real zonNow = 0.0, dstNow = 0.0;
+  static time_t lSecNow = 0, lSecNowMax = 0;
+  time_t curtimer, lSec;
+  long l;
   int min, sec, i;
   real hr;
+  flag fLookup;
   CI ci;
 
   time(&curtimer);
   sec = (int)(curtimer % 60);
   curtimer = curtimer / 60 + us.lTimeAddition;
+  lSec = curtimer * 60 + sec;
   min = (int)(curtimer % 60);
   curtimer /= 60;
   if (zon == zonLMT || zon == zonLAT)
@@ -2349,10 +2408,40 @@ void GetTimeNow(int *mon, int *day, int *yea, real *tim, real dst, real zon)
   if (dst == dstAuto) {
     // Daylight field of 24 means autodetect whether Daylight Saving Time.
 
-    SetCI(ci, *mon, *day, *yea, *tim, 0.0, zon, ciDefa.lon, ciDefa.lat);
-    if (DisplayAtlasLookup(ciDefa.loc, 0, &i) &&
-      DisplayTimezoneChanges(is.rgae[i].izn, 0, &ci)) {
-      hr += ci.dst;
+    // Looking up the city in the atlas is only done when the default
+    // location changes, and the Daylight setting is only determined again
+    // once the next time change in the city's time zone area has passed.
+
+    fLookup = !(rgaeNow != NULL && rgaeNow == is.rgae &&
+      caeNow == is.cae && FEqSz(szLocNow, ciDefa.loc));
+    if (fLookup) {
+      iaeNow = -1;
+      if (DisplayAtlasLookup(ciDefa.loc, 0, &i)) {
+        iaeNow = i;
+        szCityNow = ciCore.loc;
+      }
+      rgaeNow = is.rgae; caeNow = is.cae;
+      sprintf(szLocNow, "%.*s", cchSzMax-1, ciDefa.loc);
+    } else if (iaeNow >= 0) {
+      // Set the chart the same way DisplayAtlasLookup() would have.
+      if (FEnsureTimezoneChanges())
+        ciCore.zon = ZondefFromIzn(is.rgae[iaeNow].izn);
+      ciCore.lon = is.rgae[iaeNow].lon;
+      ciCore.lat = is.rgae[iaeNow].lat;
+      ciCore.loc = szCityNow;
+    }
+    if (iaeNow >= 0 && (fLookup || zon != zonNow || lSec < lSecNow ||
+      (lSecNowMax >= 0 && lSec >= lSecNowMax))) {
+      SetCI(ci, *mon, *day, *yea, *tim, 0.0, zon, ciDefa.lon, ciDefa.lat);
+      if (FZoneDstFromIzn(&ci, is.rgae[iaeNow].izn, fTrue)) {
+        l = LZoneValid(&ci, is.rgae[iaeNow].izn);
+        zonNow = zon; dstNow = ci.dst;
+        lSecNow = lSec; lSecNowMax = (l >= 0 ? lSec + l : -1);
+      } else
+        iaeNow = -1;
+    }
+    if (iaeNow >= 0) {
+      hr += dstNow;
       while (hr < 0.0) {
         curtimer--;
         hr += 24.0;
@@ -2444,12 +2533,14 @@ CONST int rgnShellGap[] = {1, 4, 10, 23, 57, 132, 301, 701, 1750};
 
 flag FSortCIList(int nMethod)
 {
-  int ig, gap, i, j;
-  CI ciT, *pci1, *pci2;
+  int ig, gap, i, j, *rgi, iT;
+  CI *pci1, *pci2, *rgciNew;
   real *rgr = NULL, rT;
   flag fCompare;
 #ifdef EXPRESS
+  CI ciT;
   CP cpSav;
+  int rgici[cciPrecast];
 #endif
 
   // Empty lists or length 1 lists are already sorted.
@@ -2457,17 +2548,38 @@ flag FSortCIList(int nMethod)
     return fTrue;
   Assert(FBetween(nMethod, 0, 5));
 
+  // The list is sorted by moving indexes to charts around, after which the
+  // charts themselves are each moved once into their final place.
+  rgi = RgAllocate(is.cci, int, "sort indexes");
+  rgciNew = RgAllocate(is.cciAlloc, CI, "chart list");
+  if (rgi == NULL || rgciNew == NULL) {
+    DeallocatePIf(rgi);
+    DeallocatePIf(rgciNew);
+    return fFalse;
+  }
+  for (i = 0; i < is.cci; i++)
+    rgi[i] = i;
+
   // Sorting by AstroExpression involves actually casting each chart, so
   // planet positions can be looked at by the custom sorting criterion.
   if (nMethod == 5) {
     rgr = RgAllocate(is.cci, real, "sort keys");
-    if (rgr == NULL)
+    if (rgr == NULL) {
+      DeallocateP(rgi);
+      DeallocateP(rgciNew);
       return fFalse;
+    }
     for (i = 0; i < is.cci; i++) {
       rgr[i] = (real)i;
 #ifdef EXPRESS
       // Set sort weight based on AstroExpression.
       if (!us.fExpOff && FSzSet(us.szExpListS)) {
+        // Cast the next set of charts ahead of time on multiple threads.
+        if (i % cciPrecast == 0) {
+          for (j = 0; j < cciPrecast && i + j < is.cci; j++)
+            rgici[j] = i + j;
+          PrecastCIList(rgici, j, fFalse);
+        }
         cpSav = cp0; ciT = ciCore;
         ciCore = is.rgci[i];
         CastChart(-1);
@@ -2478,18 +2590,20 @@ flag FSortCIList(int nMethod)
       }
 #endif
     }
+#ifdef EXPRESS
+    FSizeCastCache(cceMax);
+#endif
   }
 
   // Actually sort the chart list, using shell sort.
-  pci2 = &ciT;
   for (ig = cShellGap-1; ig >= 0; ig--) {
     gap = rgnShellGap[ig];
     for (i = gap; i < is.cci; i++) {
-      ciT = is.rgci[i];
-      if (nMethod == 5)
-        rT = rgr[i];
+      iT = rgi[i];
+      pci2 = &is.rgci[iT];
+      rT = (nMethod == 5 ? rgr[i] : 0.0);
       for (j = i; j >= gap; j -= gap) {
-        pci1 = &is.rgci[j - gap];
+        pci1 = &is.rgci[rgi[j - gap]];
         switch (nMethod) {
         case 0:
           fCompare = (pci1->yea > pci2->yea ||
@@ -2514,31 +2628,65 @@ flag FSortCIList(int nMethod)
           if (fCompare)
             rgr[j] = rgr[j - gap];
           break;
+        default:
+          fCompare = fFalse;
         }
         if (!fCompare)
           break;
-        is.rgci[j] = is.rgci[j - gap];
+        rgi[j] = rgi[j - gap];
       }
-      is.rgci[j] = ciT;
+      rgi[j] = iT;
       if (nMethod == 5)
         rgr[j] = rT;
     }
   }
+  for (i = 0; i < is.cci; i++)
+    rgciNew[i] = is.rgci[rgi[i]];
+  DeallocateP(is.rgci);
+  is.rgci = rgciNew;
+  DeallocateP(rgi);
   DeallocatePIf(rgr);
   return fTrue;
 }
 
 
+// Return whether a chart's name and location both contain the given strings,
+// ignoring case. Empty strings match any chart.
+
+flag FMatchCIFilter(CONST CI *pci, CONST char *szName,
+  CONST char *szLocation)
+{
+  int j;
+
+  if (*szName) {
+    for (j = 0; pci->nam[j]; j++)
+      if (FEqSzSubI(szName, &pci->nam[j]))
+        break;
+    if (!pci->nam[j])
+      return fFalse;
+  }
+  if (*szLocation) {
+    for (j = 0; pci->loc[j]; j++)
+      if (FEqSzSubI(szLocation, &pci->loc[j]))
+        break;
+    if (!pci->loc[j])
+      return fFalse;
+  }
+  return fTrue;
+}
+
+
 // Filter the program's chart list to those charts that meet a criteria,
 // deleting all other charts from the list that don't meet it.
 
 void FilterCIList(CONST char *szName, CONST char *szLocation)
 {
-  int i, j, cciNew = 0;
+  int i, cciNew = 0;
   CI *pci;
 #ifdef EXPRESS
   CI ciSav[3];
   CP cpSav[3];
+  int rgici[cciPrecast], j = 0, cici;
 
   for (i = 0; i <= 2; i++) {
     ciSav[i] = *rgpci[i];
@@ -2554,23 +2702,20 @@ void FilterCIList(CONST char *szName, CONST char *szLocation)
   for (i = 0; i < is.cci; i++) {
     pci = &is.rgci[i];
     // Chart must have both the name and location strings within it.
-    if (*szName) {
-      for (j = 0; pci->nam[j]; j++)
-        if (FEqSzSubI(szName, &pci->nam[j]))
-          break;
-      if (!pci->nam[j])
-        continue;
-    }
-    if (*szLocation) {
-      for (j = 0; pci->loc[j]; j++)
-        if (FEqSzSubI(szLocation, &pci->loc[j]))
-          break;
-      if (!pci->loc[j])
-        continue;
-    }
+    if (!FMatchCIFilter(pci, szName, szLocation))
+      continue;
 #ifdef EXPRESS
     // May want to skip current chart if AstroExpression says to do so.
     if (!us.fExpOff && FSzSet(us.szExpListF)) {
+      // Cast the next set of matching charts ahead of time on multiple
+      // threads, each as the main chart as done below.
+      if (i >= j) {
+        cici = 0;
+        for (j = i; j < is.cci && cici < cciPrecast; j++)
+          if (FMatchCIFilter(&is.rgci[j], szName, szLocation))
+            rgici[cici++] = j;
+        PrecastCIList(rgici, cici, fTrue);
+      }
       ciCore = ciMain = *pci;
       CastChart(-1);
       cp1 = cp0;
@@ -2585,6 +2730,7 @@ void FilterCIList(CONST char *szName, CONST char *szLocation)
 
   is.cci = cciNew;
 #ifdef EXPRESS
+  FSizeCastCache(cceMax);
   for (i = 0; i <= 2; i++) {
     *rgpci[i] = ciSav[i];
     *rgpcp[i] = cpSav[i];
@@ -2602,6 +2748,7 @@ flag FEnumerateCIList(int nListAll)
   int iList, iList2, i;
   CI ciSav[4];
   CP cpSav[4];
+  flag fCacheOff = fFalse;
 
   // Save chart data that will be edited.
   Assert(FBetween(nListAll, 1, 4));
@@ -2622,6 +2769,19 @@ flag FEnumerateCIList(int nListAll)
       cp1 = cp0;
   }
 
+  // When looping over pairs of charts, make the cast cache big enough to
+  // hold every chart in the list, so each chart is only cast once. If the
+  // list is larger than cbCastList bytes of cache, charts would always be
+  // replaced before being used again, so turn the cache off instead.
+  if (nListAll >= 3) {
+    if (is.cci <= cceListMax)
+      FSizeCastCache(is.cci + cceMax);
+    else if (is.cce >= 0) {
+      is.cce = -1;
+      fCacheOff = fTrue;
+    }
+  }
+
   // Loop over all charts in chart list.
   iList = (nListAll == 3); iList2 = 0;
   do {
@@ -2655,6 +2815,10 @@ flag FEnumerateCIList(int nListAll)
     }
     iList++;
   } while (iList < is.cci);
+  if (fCacheOff)
+    is.cce = 0;
+  if (nListAll >= 3)
+    FSizeCastCache(cceMax);
 
   // Restore chart data.
   is.iciIndex1 = is.iciIndex2 = -1;
@@ -3232,6 +3396,73 @@ pbyte RgReallocate(void *rgElem, int cElem, int cbElem, int cElemNew,
 }
 
 
+// Set up an empty list of events of the given size, such as events found by
+// the -d switch. The list grows as events are added, and emptying it keeps
+// its memory around to reuse, so searches that find events day after day
+// don't need to make allocations for each day.
+
+void InitEventList(EL *pel, int cbev)
+{
+  ClearB((pbyte)pel, sizeof(EL));
+  pel->cbev = cbev;
+}
+
+
+// Ensure there's room for at least the given number of events in an event
+// list, growing it to at least double its current size if needed.
+
+flag FEnsureEvents(EL *pel, int cev)
+{
+  pbyte rgev;
+  int cevNew;
+
+  if (cev <= pel->cevMax)
+    return fTrue;
+  cevNew = Max(pel->cevMax << 1, 64);
+  cevNew = Max(cevNew, cev);
+  rgev = RgReallocate(pel->rgev, pel->cev, pel->cbev, cevNew, "event list");
+  if (rgev == NULL)
+    return fFalse;
+  DeallocatePIf(pel->rgev);
+  pel->rgev = rgev;
+  pel->cevMax = cevNew;
+  return fTrue;
+}
+
+
+// Add a number of events to the end of an event list.
+
+flag FAppendEvents(EL *pel, CONST byte *rgev, int cev)
+{
+  if (!FEnsureEvents(pel, pel->cev + cev))
+    return fFalse;
+  CopyRgb(rgev, pel->rgev + pel->cev * pel->cbev, cev * pel->cbev);
+  pel->cev += cev;
+  return fTrue;
+}
+
+
+// Remove a number of events from the start of an event list, such as after
+// they've been printed, moving the remaining events to the start.
+
+void RemoveEvents(EL *pel, int cev)
+{
+  cev = Min(cev, pel->cev);
+  pel->cev -= cev;
+  CopyRgb(pel->rgev + cev * pel->cbev, pel->rgev, pel->cev * pel->cbev);
+}
+
+
+// Free the memory used by an event list, leaving it empty.
+
+void FreeEventList(EL *pel)
+{
+  DeallocatePIf(pel->rgev);
+  pel->rgev = NULL;
+  pel->cev = pel->cevMax = 0;
+}
+
+
 // Ensure there are at least the given number of slots available in the
 // command switch macro string array, reallocating if needed.
 
@@ -784,15 +784,115 @@ LDone:
 }
 
 
+#define cchADBBuf  16384  // Size of buffer Astrodatabank files are read into
+#define cchADBRing 1024   // Size of window of recent text to match strings
+
+// State of the streaming reader for Astrodatabank XML files. The file is
+// read a buffer at a time, and the most recent characters are kept in a
+// ring, so filter strings can be matched against all text in each record
+// without keeping records in memory. Strings searched for can't be longer
+// than the ring.
+
+typedef struct _ADBReader {
+  FILE *file;                 // File being read from.
+  char rgchBuf[cchADBBuf];    // Buffer of text read from file.
+  int ichBuf;                 // Position of next character in buffer.
+  int cchBuf;                 // Number of characters in buffer.
+  char rgchRing[cchADBRing];  // Ring of most recently read characters.
+  long lPos;                  // Number of characters read so far.
+  long lStart;                // Position current record starts, or -1.
+  int cchFilter;              // Length of -Y5i filter string.
+  flag fFilter;               // Whether filter string found in record.
+  flag fFail;                 // Whether updating a ~5i count failed.
+} ADBR;
+
+
+// Return whether a string occurs in the text of the current Astrodatabank
+// record being read, ending right before the given position.
+
+flag FMatchADB(CONST ADBR *pr, CONST char *sz, int cch, long lEnd)
+{
+  int ich;
+
+  if (cch <= 0 || cch > cchADBRing || lEnd - cch < pr->lStart)
+    return fFalse;
+  for (ich = cch-1; ich >= 0; ich--) {
+    lEnd--;
+    if (pr->rgchRing[lEnd & (cchADBRing-1)] != sz[ich])
+      return fFalse;
+  }
+  return fTrue;
+}
+
+
+// Check for the -Y5i filter string, and count occurrences of the ~5i
+// AstroExpression strings, ending right before the given position. Return
+// fFalse if a count couldn't be updated.
+
+flag CheckMatchesADB(ADBR *pr, long lEnd)
+{
+#ifdef EXPRESS
+  CONST char *pch;
+  int i;
+#endif
+
+  if (pr->cchFilter > 0 && !pr->fFilter &&
+    FMatchADB(pr, us.szADB, pr->cchFilter, lEnd))
+    pr->fFilter = fTrue;
+#ifdef EXPRESS
+  if (!us.fExpOff && FSzSet(us.szExpADB)) {
+    for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++) {
+      pch = ExpGetString(i);
+      if (FSzSet(pch) && FMatchADB(pr, pch, CchSz(pch), lEnd)) {
+        if (!ExpSetN(i, NExpGet(i) + 1)) {
+          pr->fFail = fTrue;
+          return fFalse;
+        }
+      }
+    }
+  }
+#endif
+  return fTrue;
+}
+
+
+// Read the next character from an Astrodatabank file, or return -1 at the
+// end of the file. Strings being searched for are checked along the way.
+
+int ChReadADB(ADBR *pr)
+{
+  int ch;
+
+  if (pr->ichBuf >= pr->cchBuf) {
+    pr->cchBuf = (int)fread(pr->rgchBuf, 1, cchADBBuf, pr->file);
+    pr->ichBuf = 0;
+    if (pr->cchBuf <= 0)
+      return -1;
+  }
+  ch = (uchar)pr->rgchBuf[pr->ichBuf++];
+  pr->rgchRing[pr->lPos & (cchADBRing-1)] = (char)ch;
+  pr->lPos++;
+  if (pr->lStart >= 0 && !CheckMatchesADB(pr, pr->lPos))
+    return -1;
+  return ch;
+}
+
+
 // Load an Astrodatabank XML format file into the chart list, given a file
-// name or a file handle.
+// name or a file handle. The file is tokenized into tags, attributes, and
+// text in one pass, with chart fields picked out by their names.
 
 flag FProcessADBFile(CONST char *szFile, FILE *file)
 {
-  char szLine[cchSzLine], sz[cchSzDef], szLoc1[cchSzDef], szLoc2[cchSzDef],
-    ch, *pch, *pch2;
-  int i, grf, cchSz = (us.szADB == NULL ? 0 : CchSz(us.szADB));
-  flag fHaveFile, fDidOne = fFalse, fDidStart, fDidEnd, fDidLon, fRet = fFalse;
+  ADBR *pr = NULL;
+  char szTag[cchSzDef], szAttr[cchSzDef], szVal[cchSzDef], szText[cchSzDef],
+    szLoc1[cchSzDef], szLoc2[cchSzDef], sz[cchSzDef*2+2];
+  int ch = 0, ich, cchText, iText, grf, i;
+  long lTag, l;
+  flag fHaveFile, fDidOne = fFalse, fDidEnd, fDidLon, fRet = fFalse;
+#ifdef EXPRESS
+  CONST char *pch;
+#endif
 
   fHaveFile = (file != NULL);
   if (!fHaveFile) {
@@ -801,129 +901,177 @@ flag FProcessADBFile(CONST char *szFile, FILE *file)
       goto LDone;
   }
   is.fileIn = file;
+  pr = RgAllocate(1, ADBR, "ADB reader");
+  if (pr == NULL)
+    goto LDone;
+  pr->file = file;
+  pr->ichBuf = pr->cchBuf = 0;
+  pr->lPos = 0;
+  pr->lStart = -1;
+  pr->fFail = fFalse;
+  pr->cchFilter = (us.szADB == NULL ? 0 : CchSz(us.szADB));
+  if (pr->cchFilter > cchADBRing) {
+    sprintf(sz, "Astrodatabank filter string is longer than %d characters.",
+      cchADBRing);
+    PrintWarning(sz);
+    goto LDone;
+  }
   do {
 #ifdef EXPRESS
     if (!us.fExpOff && FSzSet(us.szExpADB)) {
-      for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++)
+      for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++) {
         if (!ExpSetN(i, 0))
           goto LDone;
+        pch = ExpGetString(i);
+        if (FSzSet(pch) && CchSz(pch) > cchADBRing) {
+          sprintf(sz, "Astrodatabank ~5i search string is longer than %d "
+            "characters.", cchADBRing);
+          PrintWarning(sz);
+          goto LDone;
+        }
+      }
     }
 #endif
 
-  fDidStart = fDidEnd = fFalse;
+  fDidEnd = pr->fFilter = fFalse;
   grf = 0;
+  iText = -1;
+  cchText = 0;
+  szLoc1[0] = szLoc2[0] = chNull;
+
+  // Read through one record, dispatching on each tag and its attributes.
   while (!fDidEnd) {
-    while (!feof(file) && (ch = getc(file)) < ' ')
-      ;
-    if (feof(file))
+    ch = ChReadADB(pr);
+    if (ch < 0)
       break;
-    for (szLine[0] = ch, i = 1; i < cchSzLine-1 && !feof(file) &&
-      (uchar)(szLine[i] = getc(file)) >= ' '; i++)
-      ;
-    szLine[i] = chNull;
+    if (ch != '<') {
+      // Collect text within a tag that a field is taken from.
+      if (iText >= 0) {
+        if (ch < ' ')
+          iText = -iText - 2;
+        else if (cchText < cchSzDef-1 && (ch != ' ' || cchText > 0 ||
+          iText != 256))
+          szText[cchText++] = (char)ch;
+      }
+      continue;
+    }
+
+    // Finish any text field that the start of this tag ends.
+    if (iText < -1)
+      iText = -iText - 2;
+    if (iText >= 0) {
+      szText[cchText] = chNull;
+      if (iText == 256) {
+        ConvertSzFromUTF8(szText);
+        ciCore.nam = SzClone(szText);
+      } else if (iText == 512)
+        sprintf(szLoc1, "%s", szText);
+      else {
+        sprintf(szLoc2, "%s", szText);
+        sprintf(sz, "%s, %s", szLoc1, szLoc2);
+        ConvertSzFromUTF8(sz);
+        ciCore.loc = SzClone(sz);
+      }
+      grf |= iText;
+      iText = -1;
+    }
+
+    // Read tag name.
+    lTag = pr->lPos - 1;
+    for (ich = 0; (ch = ChReadADB(pr)) > ' ' && ch != '>' &&
+      !(ch == '/' && ich > 0);)
+      if (ich < cchSzDef-1)
+        szTag[ich++] = (char)ch;
+    szTag[ich] = chNull;
+    if (pr->lStart < 0 && FEqSz(szTag, "adb_entry")) {
+      // Strings may have matched from the start of the tag onward.
+      pr->lStart = lTag;
+      for (l = lTag + 1; l <= pr->lPos; l++)
+        if (!CheckMatchesADB(pr, l))
+          goto LDone;
+    }
     fDidLon = fFalse;
-    for (pch = szLine; *pch; pch++) {
-      if (FEqRgch(pch, "<adb_entry", 10, fFalse))
-        fDidStart = fTrue;
-      else if (!fDidStart)
+
+    // Read each attribute within the tag.
+    while (ch >= 0 && ch != '>') {
+      while (ch >= 0 && (ch <= ' ' || ch == '/'))
+        ch = ChReadADB(pr);
+      if (ch < 0 || ch == '>')
+        break;
+      for (ich = 0; ch > ' ' && ch != '=' && ch != '>';
+        ch = ChReadADB(pr))
+        if (ich < cchSzDef-1)
+          szAttr[ich++] = (char)ch;
+      szAttr[ich] = chNull;
+      if (ch != '=')
+        continue;
+      ch = ChReadADB(pr);
+      if (ch != '"')
         continue;
-      if (FEqRgch(pch, "</adb_entry>", 12, fFalse))
-        fDidEnd = fTrue;
-      if ((grf & 1) == 0 && FEqRgch(pch, "imonth=\"", 8, fFalse)) {
-        MM = atoi(pch + 8);
+      for (ich = 0; (ch = ChReadADB(pr)) >= 0 && ch != '"';)
+        if (ich < cchSzDef-1)
+          szVal[ich++] = (char)ch;
+      szVal[ich] = chNull;
+      if (ch >= 0)
+        ch = ChReadADB(pr);
+      if (pr->lStart < 0)
+        continue;
+
+      // Pick out chart fields from attributes.
+      if ((grf & 1) == 0 && FEqSz(szAttr, "imonth")) {
+        MM = atoi(szVal);
         grf |= 1;
-      }
-      if ((grf & 2) == 0 && FEqRgch(pch, "iday=\"", 6, fFalse)) {
-        DD = atoi(pch + 6);
+      } else if ((grf & 2) == 0 && FEqSz(szAttr, "iday")) {
+        DD = atoi(szVal);
         grf |= 2;
-      }
-      if ((grf & 4) == 0 && FEqRgch(pch, "iyear=\"", 7, fFalse)) {
-        YY = atoi(pch + 7);
+      } else if ((grf & 4) == 0 && FEqSz(szAttr, "iyear")) {
+        YY = atoi(szVal);
         grf |= 4;
-      }
-      if ((grf & 8) == 0 && FEqRgch(pch, "sbtime_ampm=\"", 13, fFalse)) {
-        pch += 13;
-        for (pch2 = pch; *pch2 && *pch2 != '"'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, sz, cchSzDef);
-        if (*sz)
-          TT = RParseSz(sz, pmTim);
+      } else if ((grf & 8) == 0 && FEqSz(szAttr, "sbtime_ampm")) {
+        if (*szVal)
+          TT = RParseSz(szVal, pmTim);
         else
           TT = 12.0;  // Some records are "unknown, 12:00 used"
         grf |= 8;
-      }
-      if ((grf & 16) == 0 && FEqRgch(pch, "ctimetype=\"", 11, fFalse)) {
-        if (pch[11] != 'l') {
-          SS = pch[11] == 'd' ? 1.0 : 0.0;
+      } else if ((grf & 16) == 0 && FEqSz(szAttr, "ctimetype")) {
+        if (szVal[0] != 'l') {
+          SS = szVal[0] == 'd' ? 1.0 : 0.0;
           grf |= 16;
         } else {
           SS = 0.0; ZZ = zonLMT;
           grf |= (16 | 32);
         }
-      }
-      if ((grf & 32) == 0 && FEqRgch(pch, "stmerid=\"", 9, fFalse)) {
-        pch += 9;
-        for (pch2 = pch; *pch2 && *pch2 != '"'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, sz, cchSzDef);
-        ZZ = RParseSz(sz, pmZon);
+      } else if ((grf & 32) == 0 && FEqSz(szAttr, "stmerid")) {
+        ZZ = RParseSz(szVal, pmZon);
         grf |= 32;
-      }
-      if ((grf & 64) == 0 && FEqRgch(pch, "slong=\"", 7, fFalse)) {
-        OO = RParseSz(pch + 7, pmLon);
+      } else if ((grf & 64) == 0 && FEqSz(szAttr, "slong")) {
+        OO = RParseSz(szVal, pmLon);
         grf |= 64;
         fDidLon = fTrue;
-      }
-      if ((grf & 128) == 0 && FEqRgch(pch, "slati=\"", 7, fFalse)) {
-        AA = RParseSz(pch + 7, pmLat);
+      } else if ((grf & 128) == 0 && FEqSz(szAttr, "slati")) {
+        AA = RParseSz(szVal, pmLat);
         grf |= 128;
       }
-      if ((grf & 256) == 0 && FEqRgch(pch, "<sflname>", 9, fFalse)) {
-        pch += 9;
-        while (*pch == ' ')
-          pch++;
-        for (pch2 = pch; *pch2 && *pch2 != '<'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, sz, cchSzDef);
-        ConvertSzFromUTF8(sz);
-        ciCore.nam = SzClone(sz);
-        grf |= 256;
-      }
-      if ((grf & 512) == 0 && fDidLon && FEqRgch(pch, "\">", 2, fFalse)) {
-        pch += 2;
-        for (pch2 = pch; *pch2 && *pch2 != '<'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, szLoc1, cchSzDef);
-        grf |= 512;
-      }
-      if ((grf & 1024) == 0 && FEqRgch(pch, "<country", 8, fFalse)) {
-        for (pch2 = pch + 8; *pch2 && *pch2 != '>'; pch2++)
-          ;
-        pch = pch2 + (*pch2 == '>');
-        for (pch2 = pch; *pch2 && *pch2 != '<'; pch2++)
-          ;
-        CopyRgchToSz(pch, pch2 - pch, szLoc2, cchSzDef);
-        sprintf(sz, "%s, %s", szLoc1, szLoc2);
-        ConvertSzFromUTF8(sz);
-        ciCore.loc = SzClone(sz);
-        grf |= 1024;
-      }
-      if (cchSz > 0 && (grf & 2048) == 0 &&
-        FEqRgch(pch, us.szADB, cchSz, fFalse))
-        grf |= 2048;
-#ifdef EXPRESS
-      if (!us.fExpOff && FSzSet(us.szExpADB)) {
-        for (i = us.iExpADB; i < us.iExpADB + us.cExpADB; i++) {
-          pch2 = ExpGetString(i);
-          if (FSzSet(pch2) && FEqRgch(pch2, pch, CchSz(pch2), fFalse)) {
-            if (!ExpSetN(i, NExpGet(i) + 1))
-              goto LDone;
-          }
-        }
-      }
-#endif
     }
-  }
+    if (pr->lStart < 0)
+      continue;
+
+    // Pick out chart fields from the text within certain tags.
+    if (FEqSz(szTag, "/adb_entry")) {
+      fDidEnd = fTrue;
+      pr->lStart = -1;
+    } else if ((grf & 256) == 0 && FEqSz(szTag, "sflname"))
+      iText = 256;
+    else if ((grf & 512) == 0 && fDidLon)
+      iText = 512;
+    else if ((grf & 1024) == 0 && FEqSz(szTag, "country"))
+      iText = 1024;
+    cchText = 0;
+  }
+  if (pr->fFail)
+    goto LDone;
+  if (pr->cchFilter > 0 && pr->fFilter)
+    grf |= 2048;
 
   if ((grf & 2047) != 2047) {
     if (grf == 0 && fDidOne) {
@@ -942,7 +1090,7 @@ flag FProcessADBFile(CONST char *szFile, FILE *file)
     PrintWarning("Values in Astrodatabank file are out of range.");
     goto LDone;
   }
-  if (cchSz > 0 && (grf & 2048) == 0)
+  if (pr->cchFilter > 0 && (grf & 2048) == 0)
     continue;
 #ifdef EXPRESS
   // Skip current chart record if AstroExpression says to do so.
@@ -955,11 +1103,12 @@ flag FProcessADBFile(CONST char *szFile, FILE *file)
     goto LDone;
   fDidOne = fTrue;
 
-  } while (!feof(file));
+  } while (ch >= 0);
   fRet = fTrue;
 
 LDone:
   is.fileIn = NULL;
+  DeallocatePIf(pr);
   if (!fHaveFile)
     fclose(file);
   return fRet;
@@ -1925,6 +2074,8 @@ flag FOutputSettings()
   PrintFSz();
   PrintF(
     "; Bitmap file type   [\"Xbw\" is Windows .bmp, \"Xbp\" is .png  ]\n");
+  sprintf(sz, ":YXz %d           ", gs.nPngLevel); PrintFSz();
+  PrintF("; PNG file compression level [\"0\" none, \"9\" most]\n");
   sprintf(sz, ":YXG %06d      ", nGlyphAll); PrintFSz();
   PrintF("; Glyphs for [Capricorn, Uranus, Pluto, Lilith, Vertex, Eris]\n");
   sprintf(sz, ":YXg %d           ", gs.nGridCell); PrintFSz();
@@ -2634,7 +2785,7 @@ flag FInputData(CONST char *szFile)
     ciCore.loc = SzClone(sz);
     if (DisplayAtlasLookup(sz, 0, &i)) {
       ciCore.loc = SzClone(sz);      // DisplayAtlasLookup changes ciCore.loc.
-      if (DisplayTimezoneChanges(is.rgae[i].izn, 0, &ciCore)) {
+      if (FZoneDstFromIzn(&ciCore, is.rgae[i].izn, fTrue)) {
         sprintf(sz, "Atlas data for %s: (%cT Zone %s) %s\n", SzCity(i),
           ChDst(SS), SzZone(ZZ),
           SzLocation(is.rgae[i].lon, is.rgae[i].lat));
@@ -69,6 +69,11 @@
 #include <tchar.h>
 #include <windows.h>
 #endif
+#if defined(MMAP) && !MSDOS
+#include <sys/mman.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "swejpl.h"
 #include "swephexp.h"
 #include "sweph.h"
@@ -124,6 +129,25 @@ TLS struct swe_data swed = {FALSE,	/* ephe_path_is_set = FALSE */
 			    NULL,	/* deps */
 			    0,		/* timeout */
 			    {0,0,0,0,0,0,0,0,}, /* astro_models */
+			    FALSE,	/* do_interpolate_nut */
+			    {},		/* interpol */
+			    {},		/* fidat */
+			    {},		/* gcdat */
+			    {},		/* pldat */
+			    {},		/* nddat */
+			    {},		/* savedat */
+			    {},		/* oec */
+			    {},		/* oec2000 */
+			    {},		/* nut */
+			    {},		/* nut2000 */
+			    {},		/* nutv */
+			    {},		/* topd */
+			    {},		/* sidd */
+			    0,		/* n_fixstars_real */
+			    0,		/* n_fixstars_named */
+			    0,		/* n_fixstars_records */
+			    NULL,	/* fixed_stars */
+			    {},		/* fixsoa */
 			    };
 
 /*************
@@ -188,7 +212,18 @@ static int32 swecalc(double tjd, int ipl, int iplmoon, int32 iflag, double *x, c
 static int do_fread(void *targ, int size, int count, int corrsize, 
 		    FILE *fp, int32 fpos, int freord, int fendian, int ifno, 
 		    char *serr);
+#ifdef MMAP
+static int do_mread(void *targ, int size, int count, int corrsize,
+		    struct file_data *fdp, int32 *pfpos, int freord,
+		    int fendian, int ifno, char *serr);
+static unsigned char *map_file(FILE *fp, int32 flen);
+static void unmap_file(unsigned char *pmap, int32 flen);
+static void map_ephe_file(struct file_data *fdp, int32 flen);
+#endif
+static void close_ephe_file(struct file_data *fdp);
 static int get_new_segment(double tjd, int ipli, int ifno, char *serr);
+static int get_cached_segment(double tjd, int ipli, int ifno, char *serr);
+static void free_segments(struct plan_data *pdp);
 static int main_planet(double tjd, int ipli, int iplmoon, int32 epheflag, int32 iflag,
 		       char *serr);
 static int main_planet_bary(double tjd, int ipli, int32 epheflag, int32 iflag, 
@@ -226,6 +261,9 @@ static int app_pos_rest(struct plan_data *pdp, int32 iflag,
     double *xx, double *x2000, struct epsilon *oe, char *serr);
 static int open_jpl_file(double *ss, char *fname, char *fpath, char *serr);
 static void free_planets(void);
+static void fixstar_free_soa(void);
+static int32 load_fixed_stars_txt(char *serr);
+static int32 load_fixed_stars_bin(void);
 
 #ifdef TRACE
 static void trace_swe_calc(int param, double tjd, int ipl, int32 iflag, double *xx, char *serr);
@@ -395,8 +433,7 @@ int32 CALL_CONV swe_calc(double tjd, int ipl, int32 iflag,
 	swed.jpl_file_is_open = FALSE;
       }
       for (i = 0; i < SEI_NEPHFILES; i ++) {
-	if (swed.fidat[i].fptr != NULL) 
-	  fclose(swed.fidat[i].fptr);
+	close_ephe_file(&swed.fidat[i]);
 	memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
       }
       swed.last_epheflag = epheflag;
@@ -1163,9 +1200,7 @@ static void free_planets(void)
   int i;
   /* free planets data space */
   for (i = 0; i < SEI_NPLANETS; i++) {
-    if (swed.pldat[i].segp != NULL) {
-      free((void *) swed.pldat[i].segp);
-    }
+    free_segments(&swed.pldat[i]);
     if (swed.pldat[i].refep != NULL) {
       free((void *) swed.pldat[i].refep);
     }
@@ -1203,8 +1238,7 @@ static void swi_close_keep_topo_etc(void)
   int i;
   /* close SWISSEPH files */
   for (i = 0; i < SEI_NEPHFILES; i ++) {
-    if (swed.fidat[i].fptr != NULL) 
-      fclose(swed.fidat[i].fptr);
+    close_ephe_file(&swed.fidat[i]);
     memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
   }
   free_planets();
@@ -1238,8 +1272,7 @@ void CALL_CONV swe_close(void)
   int i;
   /* close SWISSEPH files */
   for (i = 0; i < SEI_NEPHFILES; i ++) {
-    if (swed.fidat[i].fptr != NULL) 
-      fclose(swed.fidat[i].fptr);
+    close_ephe_file(&swed.fidat[i]);
     memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
   }
   free_planets();
@@ -1276,6 +1309,7 @@ void CALL_CONV swe_close(void)
     free(swed.deps);
     swed.deps = NULL;
   }
+  fixstar_free_soa();
   if (swed.n_fixstars_records > 0) {
     free(swed.fixed_stars);
     swed.fixed_stars = NULL;
@@ -2168,14 +2202,11 @@ static int sweph(double tjd, int ipli, int ifno, int32 iflag, double *xsunb, AS_
      * if new asteroid, close old file. */
     if (tjd < fdp->tfstart || tjd > fdp->tfend
       || (ipl == SEI_ANYBODY && ipli != pdp->ibdy)) { 	
-      fclose(fdp->fptr);
-      fdp->fptr = NULL;
+      close_ephe_file(fdp);
       if (pdp->refep != NULL) 
 	free((void *) pdp->refep);
       pdp->refep = NULL;
-      if (pdp->segp != NULL)
-	free((void *) pdp->segp);
-      pdp->segp = NULL;
+      free_segments(pdp);
     }
   }
   /* if sweph file not open, find and open it */
@@ -2273,16 +2304,9 @@ again:
    ******************************/
   /* get new segment, if necessary */
   if (pdp->segp == NULL || tjd < pdp->tseg0 || tjd > pdp->tseg1) {
-    retc = get_new_segment(tjd, ipl, ifno, serr);
+    retc = get_cached_segment(tjd, ipl, ifno, serr);
     if (retc != OK)
       return(retc);
-    /* rotate cheby coeffs back to equatorial system.
-     * if necessary, add reference orbit. */
-    if (pdp->iflg & SEI_FLG_ROTATE) {
-      rot_back(ipl); /**/
-    } else {
-      pdp->neval = pdp->ncoe;
-    }
   }
   /* evaluate chebyshew polynomial for tjd */
   t = (tjd - pdp->tseg0) / pdp->dseg;
@@ -4360,6 +4384,88 @@ static int app_pos_etc_mean(int ipl, int32 iflag, char *serr)
   return app_pos_rest(pdp, iflag, xx, xxsv, oe, serr);
 }
 
+/* SWISSEPH
+ * makes the segment containing tjd the current one for a body.
+ * the last few segments used are kept decoded in a small cache, most
+ * recently used first, so that switching back and forth between
+ * distant dates doesn't read and unpack the same segments each time.
+ * tjd		jd
+ * ipli		planet number
+ * ifno		file number
+ * serr		error string
+ */
+static int get_cached_segment(double tjd, int ipli, int ifno, char *serr)
+{
+  int i, k, retc, fhit;
+  double *segp, tseg0;
+  int neval;
+  struct plan_data *pdp = &swed.pldat[ipli];
+  /* look for segment in cache */
+  for (k = 0; k < pdp->nsegc; k++) {
+    if (tjd >= pdp->tsegc[k] && tjd <= pdp->tsegc[k] + pdp->dseg)
+      break;
+  }
+  fhit = (k < pdp->nsegc);
+  if (fhit) {
+    pdp->nseghit++;
+  } else {
+    pdp->nsegmiss++;
+    /* reuse least recently used segment, or add a new one */
+    if (pdp->nsegc < SEI_NSEGCACHE) {
+      k = pdp->nsegc;
+      pdp->segc[k] = (double *) malloc((size_t) pdp->ncoe * 3 * 8);
+      if (pdp->segc[k] == NULL) {
+	if (serr != NULL)
+	  strcpy(serr, "error in malloc() for segment cache.");
+	return(ERR);
+      }
+      pdp->nsegc++;
+    } else
+      k = pdp->nsegc - 1;
+  }
+  /* move segment to front of cache */
+  segp = pdp->segc[k];
+  tseg0 = pdp->tsegc[k];
+  neval = pdp->nevalc[k];
+  for (i = k; i > 0; i--) {
+    pdp->segc[i] = pdp->segc[i-1];
+    pdp->tsegc[i] = pdp->tsegc[i-1];
+    pdp->nevalc[i] = pdp->nevalc[i-1];
+  }
+  pdp->segc[0] = pdp->segp = segp;
+  if (fhit) {
+    pdp->tsegc[0] = pdp->tseg0 = tseg0;
+    pdp->tseg1 = tseg0 + pdp->dseg;
+    pdp->nevalc[0] = pdp->neval = neval;
+    return(OK);
+  }
+  retc = get_new_segment(tjd, ipli, ifno, serr);
+  if (retc != OK)
+    return(retc);
+  /* rotate cheby coeffs back to equatorial system.
+   * if necessary, add reference orbit. */
+  if (pdp->iflg & SEI_FLG_ROTATE) {
+    rot_back(ipli); /**/
+  } else {
+    pdp->neval = pdp->ncoe;
+  }
+  pdp->tsegc[0] = pdp->tseg0;
+  pdp->nevalc[0] = pdp->neval;
+  return(OK);
+}
+
+/* SWISSEPH
+ * frees all decoded segments of a body.
+ */
+static void free_segments(struct plan_data *pdp)
+{
+  int i;
+  for (i = 0; i < pdp->nsegc; i++)
+    free((void *) pdp->segc[i]);
+  pdp->nsegc = 0;
+  pdp->segp = NULL;
+}
+
 /* fetch chebyshew coefficients from sweph file for
  * tjd 		time
  * ipli		planet number
@@ -4381,6 +4487,16 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
   int freord  = (int) fdp->iflg & SEI_FILE_REORD;
   int fendian = (int) fdp->iflg & SEI_FILE_LITENDIAN;
   uint32 longs[MAXORD+1];
+#ifdef MMAP
+  int32 fcur = 0;
+  /* if file is mapped into memory, decode segment directly from it */
+#define SEG_FREAD(t, s, n, c) (fdp->pmap != NULL ? \
+  do_mread(t, s, n, c, fdp, &fcur, freord, fendian, ifno, serr) : \
+  do_fread(t, s, n, c, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr))
+#else
+#define SEG_FREAD(t, s, n, c) \
+  do_fread(t, s, n, c, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr)
+#endif
   /* compute segment number */
   iseg = (int32) ((tjd - pdp->tfstart) / pdp->dseg);
   /*if (tjd - pdp->tfstart < 0)
@@ -4389,10 +4505,21 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
   pdp->tseg1 = pdp->tseg0 + pdp->dseg;
   /* get file position of coefficients from file */
   fpos = pdp->lndx0 + iseg * 3;
-  retc = do_fread((void *) &fpos, 3, 1, 4, fp, fpos, freord, fendian, ifno, serr);
-  if (retc != OK)
-    goto return_error_gns;
-  fseek(fp, fpos, SEEK_SET);
+#ifdef MMAP
+  if (fdp->pmap != NULL) {
+    fcur = fpos;
+    retc = do_mread((void *) &fpos, 3, 1, 4, fdp, &fcur, freord, fendian, ifno, serr);
+    if (retc != OK)
+      goto return_error_gns;
+    fcur = fpos;
+  } else
+#endif
+  {
+    retc = do_fread((void *) &fpos, 3, 1, 4, fp, fpos, freord, fendian, ifno, serr);
+    if (retc != OK)
+      goto return_error_gns;
+    fseek(fp, fpos, SEEK_SET);
+  }
   /* clear space of chebyshew coefficients */
   if (pdp->segp == NULL)
     pdp->segp = (double *) malloc((size_t) pdp->ncoe * 3 * 8);
@@ -4402,12 +4529,12 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
     idbl = icoord * pdp->ncoe;
     /* first read header */
     /* first bit indicates number of sizes of packed coefficients */
-    retc = do_fread((void *) &c[0], 1, 2, 1, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+    retc = SEG_FREAD((void *) &c[0], 1, 2, 1);
     if (retc != OK)
       goto return_error_gns;
     if (c[0] & 128) {
       nsizes = 6;
-      retc = do_fread((void *) (c+2), 1, 2, 1, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+      retc = SEG_FREAD((void *) (c+2), 1, 2, 1);
       if (retc != OK)
 	goto return_error_gns;
       nsize[0] = (int) c[1] / 16;
@@ -4434,8 +4561,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
 	  sprintf(serr, "error in ephemeris file %s: %d coefficients instead of %d. ", fdp->fnam, nco, pdp->ncoe);
 	}
       }
-      free(pdp->segp);
-      pdp->segp = NULL;
+      free_segments(pdp);
       return (ERR);
     }
     /* now unpack */
@@ -4445,7 +4571,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       if (i < 4) {
 	j = (4 - i);
 	k = nsize[i];
-	retc = do_fread((void *) &longs[0], j, k, 4, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+	retc = SEG_FREAD((void *) &longs[0], j, k, 4);
 	if (retc != OK)
 	  goto return_error_gns;
 	for (m = 0; m < k; m++, idbl++) {
@@ -4457,7 +4583,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       } else if (i == 4) {		/* half byte packing */
 	j = 1;
 	k = (nsize[i] + 1) / 2;
-	retc = do_fread((void *) longs, j, k, 4, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+	retc = SEG_FREAD((void *) longs, j, k, 4);
 	if (retc != OK)
 	  goto return_error_gns;
 	for (m = 0, j = 0; 
@@ -4476,7 +4602,7 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       } else if (i == 5) {		/* quarter byte packing */
 	j = 1;
 	k = (nsize[i] + 3) / 4;
-	retc = do_fread((void *) longs, j, k, 4, fp, SEI_CURR_FPOS, freord, fendian, ifno, serr);
+	retc = SEG_FREAD((void *) longs, j, k, 4);
 	if (retc != OK)
 	  goto return_error_gns;
 	for (m = 0, j = 0; 
@@ -4495,11 +4621,10 @@ static int get_new_segment(double tjd, int ipli, int ifno, char *serr)
       }
     }
   }
+#undef SEG_FREAD
   return(OK);
 return_error_gns:
-  fclose(fdp->fptr);
-  // free(fdp->fptr);  is not from malloc(), must not be freed by us
-  fdp->fptr = NULL;
+  close_ephe_file(fdp);
   free_planets();
   return ERR;
 }
@@ -4670,6 +4795,9 @@ fendian, ifno, serr);
     smsg = "h";
     goto file_damage;
   }
+#ifdef MMAP
+  map_ephe_file(fdp, flen);
+#endif
   /********************************************************** 
    * DE number of JPL ephemeris which this file is based on * 
    **********************************************************/
@@ -4858,10 +4986,8 @@ fendian, ifno, serr);
       if (pdp->refep != NULL) { /* if switch to other eph. file */
         free((void *) pdp->refep);
 	pdp->refep = NULL;    /* 2015-may-5 */  
-        if (pdp->segp != NULL) {        
-          free((void *) pdp->segp);     /* array of coefficients of */
-          pdp->segp = NULL;     /* ephemeris segment        */  
-        }
+        free_segments(pdp);     /* arrays of coefficients of */
+                                /* ephemeris segments        */
       }
       pdp->refep = (double *) malloc((size_t) pdp->ncoe * 2 * 8); 
       retc = do_fread((void *) pdp->refep, 8, 2*pdp->ncoe, 8, fp,
@@ -4882,9 +5008,7 @@ file_damage:
     }
   }
 return_error:
-  fclose(fdp->fptr);
-  // free(fdp->fptr);  is not from malloc(), must not be freed by us
-  fdp->fptr = NULL;
+  close_ephe_file(fdp);
   free_planets();
   return(ERR);
 }
@@ -4956,6 +5080,133 @@ static int do_fread(void *trg, int size, int count, int corrsize, FILE *fp, int3
   return(OK);
 }
 
+#ifdef MMAP
+/* SWISSEPH
+ * like do_fread(), but gets the data from an ephemeris file mapped
+ * into memory, without any stdio calls or intermediate buffer.
+ * fdp		file data of mapped file
+ * pfpos	file position, which is advanced past the data read
+ * other parameters are as for do_fread()
+ */
+static int do_mread(void *trg, int size, int count, int corrsize, struct file_data *fdp, int32 *pfpos, int freord, int fendian, int ifno, char *serr)
+{
+  int i, j, k; 
+  int totsize;
+  unsigned char *src;
+  unsigned char *targ = (unsigned char *) trg;
+  totsize = size * count;
+  if (*pfpos < 0 || *pfpos + totsize > fdp->lmap) {
+    if (serr != NULL) {
+      strcpy(serr, "Ephemeris file is damaged (5). ");
+      if (strlen(serr) + strlen(swed.fidat[ifno].fnam) < AS_MAXCH - 1) {
+	sprintf(serr, "Ephemeris file %s is damaged (6).", swed.fidat[ifno].fnam);
+      }
+    }
+    return(ERR);
+  }
+  src = fdp->pmap + *pfpos;
+  *pfpos += totsize;
+  /* if no byte reorder has to be done, and read size == return size */
+  if (!freord && size == corrsize) {
+    memcpy((void *) targ, (void *) src, (size_t) totsize);
+    return(OK);
+  }
+  if (size != corrsize) {
+    memset((void *) targ, 0, (size_t) count * corrsize);
+  }
+  for(i = 0; i < count; i++) {
+    for (j = size-1; j >= 0; j--) {
+      if (freord) {
+	k = size-j-1;
+      } else {
+	k = j;
+      }
+      if (size != corrsize) {
+	if ((fendian == SEI_FILE_BIGENDIAN && !freord) ||
+	    (fendian == SEI_FILE_LITENDIAN &&  freord))
+	  k += corrsize - size;
+      }
+      targ[i*corrsize+k] = src[i*size+j];
+    }
+  }
+  return(OK);
+}
+
+/* SWISSEPH
+ * maps an open file into memory for reading. the mapping stays valid
+ * after the file is closed.
+ * fp		open file
+ * flen		length of file
+ * returns pointer to mapped file, or NULL if it can't be mapped.
+ */
+static unsigned char *map_file(FILE *fp, int32 flen)
+{
+#if MSDOS
+  HANDLE hmap;
+  unsigned char *pmap = NULL;
+  hmap = CreateFileMapping((HANDLE) _get_osfhandle(_fileno(fp)),
+    NULL, PAGE_READONLY, 0, 0, NULL);
+  if (hmap != NULL) {
+    /* the view keeps the mapping alive after its handle is closed */
+    pmap = (unsigned char *) MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hmap);
+  }
+  return pmap;
+#else
+  void *pv;
+  if (flen <= 0)
+    return NULL;
+  pv = mmap(NULL, (size_t) flen, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+  return (pv == MAP_FAILED ? NULL : (unsigned char *) pv);
+#endif
+}
+
+/* SWISSEPH
+ * unmaps a file mapped with map_file().
+ */
+static void unmap_file(unsigned char *pmap, int32 flen)
+{
+#if MSDOS
+  UnmapViewOfFile((void *) pmap);
+#else
+  munmap((void *) pmap, (size_t) flen);
+#endif
+}
+
+/* SWISSEPH
+ * maps an open ephemeris file into memory, so that segments of
+ * coefficients can be decoded directly from the mapped pages.
+ * if the file can't be mapped, it is read with stdio as usual.
+ * fdp		file data of open file
+ * flen		length of file
+ */
+static void map_ephe_file(struct file_data *fdp, int32 flen)
+{
+  fdp->pmap = map_file(fdp->fptr, flen);
+  fdp->lmap = (fdp->pmap != NULL ? flen : 0);
+}
+#endif
+
+/* SWISSEPH
+ * closes an ephemeris file, and unmaps it from memory if mapped.
+ * fdp		file data of file to close
+ */
+static void close_ephe_file(struct file_data *fdp)
+{
+#ifdef MMAP
+  if (fdp->pmap != NULL) {
+    unmap_file(fdp->pmap, fdp->lmap);
+    fdp->pmap = NULL;
+    fdp->lmap = 0;
+  }
+#endif
+  if (fdp->fptr != NULL) {
+    fclose(fdp->fptr);
+    // free(fdp->fptr);  is not from malloc(), must not be freed by us
+    fdp->fptr = NULL;
+  }
+}
+
 /* SWISSEPH
  * adds reference orbit to chebyshew series (if SEI_FLG_ELLIPSE),
  * rotates series to mean equinox of J2000
@@ -6317,12 +6568,28 @@ int32 fixstar_cut_string(char *srecord, char *star, struct fixed_star *stardata,
  * this name as its search key.
  * The array is sorted in ascending order by search key. 
  *
+ * If the binary file sefstars.bin made from the text file exists, the
+ * list is loaded from there instead, which is much faster.
+ *
  * If an error occurs, the function returns value ERR.
  * If the stars were loaded at an earlier time the function returns
  * value -2, without doing anything and without error string.
  * On success, the function returns value OK.
  * */
 static int32 load_all_fixed_stars(char *serr) 
+{
+  if (swed.n_fixstars_records > 0) {
+    return -2;
+  }
+  if (load_fixed_stars_bin() == OK)
+    return OK;
+  return load_fixed_stars_txt(serr);
+}
+
+/* function loads all fixed stars from the text file sefstars.txt,
+ * as described for load_all_fixed_stars().
+ */
+static int32 load_fixed_stars_txt(char *serr) 
 {
   int32 retc = OK;
   int nstars = 0, line = 0, fline = 0, nrecs = 0, nnamed = 0;
@@ -6331,9 +6598,6 @@ static int32 load_all_fixed_stars(char *serr)
   struct fixed_star fstdata;
   char last_starbayer[SWI_STAR_LENGTH + 1];
   *last_starbayer = '\0';
-  if (swed.n_fixstars_records > 0) {
-    return -2;
-  }
   if (swed.fixfp == NULL) {
     if ((swed.fixfp = swi_fopen(SEI_FILE_FIXSTAR, SE_STARFILE, swed.ephepath, serr)) == NULL) {
       swed.is_old_starfile = TRUE;
@@ -6397,29 +6661,357 @@ static int32 load_all_fixed_stars(char *serr)
   return retc;
 }
 
-/* function calculates a fixstar from a star data struct 
+/* binary fixed stars file sefstars.bin, made from sefstars.txt by
+ * swe_fixstar2_write_bin(). it contains the fixed stars list exactly as
+ * load_fixed_stars_txt() builds it, already sorted by search key, so it
+ * can be loaded without parsing or sorting. numbers are in the byte order
+ * of the machine that wrote the file. layout:
+ * char magic[8]		"SEFSTARB"
+ * int32 hdr[SEI_FSB_NHDR]	see SEI_FSB_ below
+ * double data[ndata][8]	epoch, ra, de, ramot, demot, radvel, parall, mag
+ * int32 name[ndata][2]		offsets of starname and starbayer of each star
+ * int32 rec[nrecs][2]		offset of skey and index into data of each record
+ * char str[lstr]		zero terminated strings
+ * stars with a traditional name have two records, so their data and names
+ * are stored only once.
+ */
+#define SEI_FSB_MAGIC	"SEFSTARB"
+#define SEI_FSB_VERSION	3
+#define SEI_FSB_ENDIAN	0	/* SEI_FILE_TEST_ENDIAN */
+#define SEI_FSB_VER	1	/* format version */
+#define SEI_FSB_TXTLEN	2	/* length of text file it was made from */
+#define SEI_FSB_ISOLD	3	/* whether text file was fixstars.cat */
+#define SEI_FSB_NRECS	4	/* number of records */
+#define SEI_FSB_NREAL	5	/* number of stars */
+#define SEI_FSB_NNAMED	6	/* number of stars with traditional name */
+#define SEI_FSB_LSTR	7	/* length of string table */
+#define SEI_FSB_NDATA	8	/* number of distinct star data */
+#define SEI_FSB_TXTTIME	9	/* modification time of text file, low and */
+				/* high 32 bits */
+#define SEI_FSB_NHDR	11
+#define SEI_FSB_HDRLEN	(8 + SEI_FSB_NHDR * 4)
+
+/* function gets the length and modification time of a fixed stars text
+ * file in the ephemeris path, without reading it, so that sefstars.bin
+ * can be checked against it quickly. the time is returned as two halves
+ * in ptime[0] and ptime[1]. returns FALSE if the file does not exist.
+ */
+static AS_BOOL fixstar_text_stat(char *fname, int32 *plen, int32 *ptime)
+{
+  FILE *fp;
+  struct stat st;
+  AS_BOOL fok;
+  if ((fp = swi_fopen(-1, fname, swed.ephepath, NULL)) == NULL)
+    return FALSE;
+  fok = (fstat(fileno(fp), &st) == 0);
+  fclose(fp);
+  if (!fok)
+    return FALSE;
+  *plen = (int32) st.st_size;
+  ptime[0] = (int32) (uint32) st.st_mtime;
+  ptime[1] = (int32) (st.st_mtime / 65536 / 65536);
+  return TRUE;
+}
+
+/* function copies a string from the string table of sefstars.bin,
+ * checking that it lies within the table and fits into the target.
+ */
+static AS_BOOL fixstar_bin_string(char *target, int size, const char *str,
+  int32 lstr, int32 offset)
+{
+  const char *sp;
+  if (offset < 0 || offset >= lstr)
+    return FALSE;
+  sp = (const char *) memchr(str + offset, '\0', lstr - offset);
+  if (sp == NULL || sp - (str + offset) >= size)
+    return FALSE;
+  strcpy(target, str + offset);
+  return TRUE;
+}
+
+/* function loads all fixed stars from the binary file sefstars.bin into
+ * swed.fixed_stars. the file is only used if it is intact and was made
+ * from the text file present in the ephemeris path, if any, as judged by
+ * the text file's length and modification time. otherwise the function
+ * returns ERR and the text file is read instead.
+ * the records are copied out of the file, since the rest of the code
+ * expects swed.fixed_stars to be a malloc'd array of struct fixed_star,
+ * with fixed size strings, while the file stores each star's data and
+ * names only once.
+ */
+static int32 load_fixed_stars_bin(void)
+{
+  FILE *fp;
+  unsigned char *pb = NULL;
+  AS_BOOL fmapped = FALSE, fok = FALSE;
+  int32 flen, hdr[SEI_FSB_NHDR], nrecs, ndata, lstr, ltxt, ttxt[2], i, j;
+  const double *pd, *pdi;
+  const int32 *pn, *pr;
+  const char *str;
+  struct fixed_star *fsp = NULL;
+  if ((fp = swi_fopen(-1, SE_STARFILE_BIN, swed.ephepath, NULL)) == NULL)
+    return ERR;
+  fseek(fp, 0L, SEEK_END);
+  flen = (int32) ftell(fp);
+  if (flen < SEI_FSB_HDRLEN) {
+    fclose(fp);
+    return ERR;
+  }
+#ifdef MMAP
+  pb = map_file(fp, flen);
+  fmapped = (pb != NULL);
+#endif
+  if (pb == NULL && (pb = (unsigned char *) malloc((size_t) flen)) != NULL) {
+    rewind(fp);
+    if (fread((void *) pb, 1, (size_t) flen, fp) != (size_t) flen) {
+      free(pb);
+      pb = NULL;
+    }
+  }
+  fclose(fp);
+  if (pb == NULL)
+    return ERR;
+  memcpy((void *) hdr, (void *) (pb + 8), sizeof(hdr));
+  nrecs = hdr[SEI_FSB_NRECS];
+  ndata = hdr[SEI_FSB_NDATA];
+  lstr = hdr[SEI_FSB_LSTR];
+  if (memcmp(pb, SEI_FSB_MAGIC, 8) != 0 ||
+    hdr[SEI_FSB_ENDIAN] != SEI_FILE_TEST_ENDIAN ||
+    hdr[SEI_FSB_VER] != SEI_FSB_VERSION || nrecs <= 0 || lstr <= 0 ||
+    ndata <= 0 || ndata > nrecs ||
+    hdr[SEI_FSB_NREAL] <= 0 || hdr[SEI_FSB_NREAL] > nrecs ||
+    hdr[SEI_FSB_NNAMED] < 0 || hdr[SEI_FSB_NNAMED] > nrecs ||
+    flen != SEI_FSB_HDRLEN + ndata * (8 * 8 + 2 * 4) + nrecs * 2 * 4 + lstr)
+    goto LDone;
+  // reject the file if the text file has been changed since
+  if (fixstar_text_stat(SE_STARFILE, &ltxt, ttxt)) {
+    if (hdr[SEI_FSB_ISOLD] || ltxt != hdr[SEI_FSB_TXTLEN] ||
+      ttxt[0] != hdr[SEI_FSB_TXTTIME] || ttxt[1] != hdr[SEI_FSB_TXTTIME+1])
+      goto LDone;
+  } else if (fixstar_text_stat(SE_STARFILE_OLD, &ltxt, ttxt)) {
+    if (!hdr[SEI_FSB_ISOLD] || ltxt != hdr[SEI_FSB_TXTLEN] ||
+      ttxt[0] != hdr[SEI_FSB_TXTTIME] || ttxt[1] != hdr[SEI_FSB_TXTTIME+1])
+      goto LDone;
+  }
+  fsp = (struct fixed_star *) calloc((size_t) nrecs, sizeof(struct fixed_star));
+  if (fsp == NULL)
+    goto LDone;
+  pd = (const double *) (pb + SEI_FSB_HDRLEN);
+  pn = (const int32 *) (pd + ndata * 8);
+  pr = pn + ndata * 2;
+  str = (const char *) (pr + nrecs * 2);
+  for (i = 0; i < nrecs; i++, pr += 2) {
+    j = pr[1];
+    if (j < 0 || j >= ndata)
+      goto LDone;
+    if (!fixstar_bin_string(fsp[i].skey, SWI_STAR_LENGTH + 2, str, lstr, pr[0])
+      || !fixstar_bin_string(fsp[i].starname, SWI_STAR_LENGTH + 1, str, lstr,
+      pn[j*2]) || !fixstar_bin_string(fsp[i].starbayer, SWI_STAR_LENGTH + 1,
+      str, lstr, pn[j*2+1]))
+      goto LDone;
+    // keys must be in order for bsearch()
+    if (i > 0 && strcmp(fsp[i-1].skey, fsp[i].skey) > 0)
+      goto LDone;
+    pdi = pd + j * 8;
+    fsp[i].epoch = pdi[0]; fsp[i].ra = pdi[1]; fsp[i].de = pdi[2];
+    fsp[i].ramot = pdi[3]; fsp[i].demot = pdi[4];
+    fsp[i].radvel = pdi[5]; fsp[i].parall = pdi[6]; fsp[i].mag = pdi[7];
+  }
+  swed.fixed_stars = fsp;
+  swed.n_fixstars_real = hdr[SEI_FSB_NREAL];
+  swed.n_fixstars_named = hdr[SEI_FSB_NNAMED];
+  swed.n_fixstars_records = nrecs;
+  swed.is_old_starfile = hdr[SEI_FSB_ISOLD];
+  fsp = NULL;
+  fok = TRUE;
+LDone:
+  if (fsp != NULL)
+    free(fsp);
+#ifdef MMAP
+  if (fmapped)
+    unmap_file(pb, flen);
+  else
+#endif
+    free(pb);
+  return fok ? OK : ERR;
+}
+
+/* function appends a string to the string table being built for
+ * sefstars.bin, and returns its offset, or -1 if out of memory.
+ */
+static int32 fixstar_bin_add_string(char **pstr, int32 *plstr, int32 *pmax,
+  const char *sz)
+{
+  int32 off = *plstr, len = (int32) strlen(sz) + 1;
+  char *pnew;
+  if (off + len > *pmax) {
+    *pmax = (off + len) * 2;
+    if ((pnew = (char *) realloc(*pstr, (size_t) *pmax)) == NULL)
+      return -1;
+    *pstr = pnew;
+  }
+  memcpy(*pstr + off, sz, (size_t) len);
+  *plstr += len;
+  return off;
+}
+
+/* function writes the binary fixed stars file sefstars.bin.
+ * the stars are read from the text file sefstars.txt (or fixstars.cat).
+ * fname	path of file to write, or NULL to write it into the same
+ *		directory as the text file.
+ * returns OK, or ERR with error message in serr.
+ */
+int32 CALL_CONV swe_fixstar2_write_bin(char *fname, char *serr)
+{
+  FILE *fp;
+  char sfile[AS_MAXCH], *sp, *str = NULL;
+  int32 hdr[SEI_FSB_NHDR], lstr = 0, lmax = 0, nrecs, ndata = 0, i, j;
+  int32 retc = ERR, *pn = NULL, *pr = NULL, *pidx = NULL;
+  double *pd = NULL;
+  struct fixed_star *fsp, *fsp2;
+  if (serr != NULL)
+    *serr = '\0';
+  swi_init_swed_if_start();
+  // always rebuild the list from the text file
+  fixstar_free_soa();
+  if (swed.fixed_stars != NULL) {
+    free(swed.fixed_stars);
+    swed.fixed_stars = NULL;
+  }
+  swed.n_fixstars_real = swed.n_fixstars_named = swed.n_fixstars_records = 0;
+  if (load_fixed_stars_txt(serr) != OK)
+    return ERR;
+  nrecs = swed.n_fixstars_records;
+  if (fname != NULL) {
+    strcpy(sfile, fname);
+  } else {
+    strcpy(sfile, swed.fidat[SEI_FILE_FIXSTAR].fnam);
+    sp = strrchr(sfile, *DIR_GLUE);
+    sp = (sp == NULL ? sfile : sp + 1);
+    strcpy(sp, SE_STARFILE_BIN);
+  }
+  pd = (double *) malloc((size_t) nrecs * 8 * sizeof(double));
+  pn = (int32 *) malloc((size_t) nrecs * 2 * sizeof(int32));
+  pr = (int32 *) malloc((size_t) nrecs * 2 * sizeof(int32));
+  pidx = (int32 *) malloc((size_t) nrecs * sizeof(int32));
+  if (pd == NULL || pn == NULL || pr == NULL || pidx == NULL)
+    goto LNoMem;
+  for (i = 0; i < nrecs; i++) {
+    fsp = &swed.fixed_stars[i];
+    // a star with a traditional name has a second record with the same data
+    for (j = 0; j < ndata; j++) {
+      fsp2 = &swed.fixed_stars[pidx[j]];
+      if (strcmp(fsp->starname, fsp2->starname) == 0 &&
+        strcmp(fsp->starbayer, fsp2->starbayer) == 0 &&
+        fsp->epoch == fsp2->epoch && fsp->ra == fsp2->ra &&
+        fsp->de == fsp2->de && fsp->ramot == fsp2->ramot &&
+        fsp->demot == fsp2->demot && fsp->radvel == fsp2->radvel &&
+        fsp->parall == fsp2->parall && fsp->mag == fsp2->mag)
+        break;
+    }
+    if (j >= ndata) {
+      pidx[j] = i;
+      ndata++;
+      pd[j*8] = fsp->epoch; pd[j*8+1] = fsp->ra; pd[j*8+2] = fsp->de;
+      pd[j*8+3] = fsp->ramot; pd[j*8+4] = fsp->demot;
+      pd[j*8+5] = fsp->radvel; pd[j*8+6] = fsp->parall; pd[j*8+7] = fsp->mag;
+      if ((pn[j*2] = fixstar_bin_add_string(&str, &lstr, &lmax,
+        fsp->starname)) < 0 || (pn[j*2+1] = fixstar_bin_add_string(&str,
+        &lstr, &lmax, fsp->starbayer)) < 0)
+        goto LNoMem;
+    }
+    pr[i*2+1] = j;
+    if ((pr[i*2] = fixstar_bin_add_string(&str, &lstr, &lmax, fsp->skey)) < 0)
+      goto LNoMem;
+  }
+  memset((void *) hdr, 0, sizeof(hdr));
+  hdr[SEI_FSB_ENDIAN] = SEI_FILE_TEST_ENDIAN;
+  hdr[SEI_FSB_VER] = SEI_FSB_VERSION;
+  if (swed.is_old_starfile)
+    fixstar_text_stat(SE_STARFILE_OLD, &hdr[SEI_FSB_TXTLEN],
+      &hdr[SEI_FSB_TXTTIME]);
+  else
+    fixstar_text_stat(SE_STARFILE, &hdr[SEI_FSB_TXTLEN],
+      &hdr[SEI_FSB_TXTTIME]);
+  hdr[SEI_FSB_ISOLD] = swed.is_old_starfile;
+  hdr[SEI_FSB_NRECS] = nrecs;
+  hdr[SEI_FSB_NREAL] = swed.n_fixstars_real;
+  hdr[SEI_FSB_NNAMED] = swed.n_fixstars_named;
+  hdr[SEI_FSB_LSTR] = lstr;
+  hdr[SEI_FSB_NDATA] = ndata;
+  if ((fp = fopen(sfile, BFILE_W_CREATE)) == NULL) {
+    if (serr != NULL)
+      sprintf(serr, "error: could not create file %s", sfile);
+    goto LDone;
+  }
+  if (fwrite(SEI_FSB_MAGIC, 1, 8, fp) != 8 ||
+    fwrite((void *) hdr, sizeof(int32), SEI_FSB_NHDR, fp) != SEI_FSB_NHDR ||
+    fwrite((void *) pd, sizeof(double), (size_t) ndata * 8, fp) !=
+      (size_t) ndata * 8 ||
+    fwrite((void *) pn, sizeof(int32), (size_t) ndata * 2, fp) !=
+      (size_t) ndata * 2 ||
+    fwrite((void *) pr, sizeof(int32), (size_t) nrecs * 2, fp) !=
+      (size_t) nrecs * 2 ||
+    fwrite((void *) str, 1, (size_t) lstr, fp) != (size_t) lstr) {
+    if (serr != NULL)
+      sprintf(serr, "error: could not write file %s", sfile);
+    fclose(fp);
+    remove(sfile);
+    goto LDone;
+  }
+  fclose(fp);
+  retc = OK;
+  goto LDone;
+LNoMem:
+  if (serr != NULL)
+    strcpy(serr, "error in swe_fixstar2_write_bin(): not enough memory");
+LDone:
+  if (pd != NULL) free(pd);
+  if (pn != NULL) free(pn);
+  if (pr != NULL) free(pr);
+  if (pidx != NULL) free(pidx);
+  if (str != NULL) free(str);
+  return retc;
+}
+
+/* frame of reference for computing fixed stars at one date. everything
+ * in here is the same for all stars, so it is set up only once when
+ * computing many stars for the same date. */
+struct fixstar_frame {
+  double tjd;		/* date of frame */
+  int32 iflag;		/* flags after plaus_iflag() */
+  int32 iflgsave;	/* flags as given by caller */
+  double dt;		/* interval for speed of observer */
+  double xobs[6], xobs_dt[6];	/* barycentric observer at tjd, tjd - dt */
+  double xpo_s[6], xpo_dt_s[6];	/* origin for parallax at tjd, tjd - dt */
+  double *xpo, *xpo_dt;	/* origin for parallax, or NULL if none */
+  AS_BOOL fbias;	/* whether to apply frame bias ICRS to J2000 */
+  double pmat[9];	/* precession matrix J2000 to tjd */
+  double dpre;		/* change of precession per day, for speed */
+  double daya[2];	/* ayanamsa and its speed, traditional method */
+};
+
+/* function sets up the frame of reference for computing fixed stars:
+ * obliquity and nutation, the position of the earth and the observer,
+ * and the precession matrix.
  * input:
- * struct fixed_star stardata      fixed star data struct
  * double tjd        julian daynumber 
  * int32 iflag       SEFLG_ specifications
  * output:
- * char *star        star name, Bayer designation
- * double xx[6]      position and speed
+ * struct fixstar_frame *fr  frame for tjd
  * char *serr        error return string
  */
-static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, int32 iflag, char *star, double *xx, char *serr)
+static int32 fixstar_frame_setup(double tjd, int32 iflag, struct fixstar_frame *fr, char *serr)
 {
-  int i;
+  int i, k;
   int32 retc = OK;
-  double epoch, radv, parall;
-  double ra_pm, de_pm, ra, de, t;
-  double daya[2], rdist;
-  double x[6], xxsv[6], xobs[6], xobs_dt[6], *xpo = NULL, *xpo_dt = NULL;
-  static TLS double xearth[6], xearth_dt[6], xsun[6], xsun_dt[6];
+  double xearth[6], xearth_dt[6], xsun[6], xsun_dt[6];
+  double e[3], dpre, dpre2, tprec;
+  int32 epheflag;
+  int prec_model = swed.astro_models[SE_MODEL_PREC_LONGTERM];
   double dt = PLAN_SPEED_INTV * 0.1;
-  int32 epheflag, iflgsave;
-  struct epsilon *oe = &swed.oec2000;
-  iflgsave = iflag;
+  if (prec_model == 0) prec_model = SEMOD_PREC_DEFAULT;
+  fr->iflgsave = iflag;
   iflag |= SEFLG_SPEED; /* we need this in order to work correctly */
   if (serr != NULL)
     *serr = '\0';
@@ -6436,8 +7028,7 @@ static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, i
       swed.jpl_file_is_open = FALSE;
     }
     for (i = 0; i < SEI_NEPHFILES; i ++) {
-      if (swed.fidat[i].fptr != NULL) 
-	fclose(swed.fidat[i].fptr);
+      close_ephe_file(&swed.fidat[i]);
       memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
     }
     swed.last_epheflag = epheflag;
@@ -6454,15 +7045,115 @@ static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, i
    * nutation                               * 
    ******************************************/
   swi_check_nutation(tjd, iflag);
-  sprintf(star, "%s,%s", stardata->starname, stardata->starbayer);
+  /**************************************************** 
+   * earth/sun 
+   * for parallax, light deflection, and aberration,
+   ****************************************************/
+  if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
+    if ((retc =  main_planet_bary(tjd - dt, SEI_EARTH, epheflag, iflag, NO_SAVE, xearth_dt, xearth_dt, xsun_dt, NULL, serr)) != OK) {
+      return ERR;
+    }
+    if ((retc =  main_planet_bary(tjd, SEI_EARTH, epheflag, iflag, DO_SAVE, xearth, xearth, xsun, NULL, serr)) != OK) {
+      return ERR;
+    }
+  }
+  /************************************
+   * observer: geocenter or topocenter
+   ************************************/
+  /* if topocentric position is wanted  */
+  if (iflag & SEFLG_TOPOCTR) { 
+    if (swi_get_observer(tjd - dt, iflag | SEFLG_NONUT, NO_SAVE, fr->xobs_dt, serr) != OK)
+      return ERR;
+    if (swi_get_observer(tjd, iflag | SEFLG_NONUT, NO_SAVE, fr->xobs, serr) != OK)
+      return ERR;
+    /* barycentric position of observer */
+    for (i = 0; i <= 5; i++) {
+      fr->xobs[i] = fr->xobs[i] + xearth[i];	
+      fr->xobs_dt[i] = fr->xobs_dt[i] + xearth_dt[i];	
+    }
+  } else if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
+    /* barycentric position of geocenter */
+    for (i = 0; i <= 5; i++) {
+      fr->xobs[i] = xearth[i];
+      fr->xobs_dt[i] = xearth_dt[i];
+    }
+  }
+  /* origin for parallax */ 
+  if ((iflag & SEFLG_HELCTR) && (iflag & SEFLG_MOSEPH)) {
+    fr->xpo = NULL;		/* no parallax, if moshier and heliocentric */
+    fr->xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
+  } else if (iflag & SEFLG_HELCTR) {
+    for (i = 0; i <= 5; i++) {
+      fr->xpo_s[i] = xsun[i];
+      fr->xpo_dt_s[i] = xsun_dt[i];
+    }
+    fr->xpo = fr->xpo_s;
+    fr->xpo_dt = fr->xpo_dt_s; 
+  } else if (iflag & SEFLG_BARYCTR) {
+    fr->xpo = NULL;		/* no parallax, if barycentric */
+    fr->xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
+  } else {
+    fr->xpo = fr->xobs;
+    fr->xpo_dt = fr->xobs_dt;
+  }
+  /* ICRS to J2000 */
+  fr->fbias = (!(iflag & SEFLG_ICRS) && (swi_get_denum(SEI_SUN, iflag) >= 403 || (iflag & SEFLG_BARYCTR)));
+  /************************************************
+   * precession, equator 2000 -> equator of date, *
+   * as matrix built by precessing the unit vectors *
+   ************************************************/
+  if ((iflag & SEFLG_J2000) == 0) {
+    for (k = 0; k <= 2; k++) {
+      e[0] = e[1] = e[2] = 0;
+      e[k] = 1;
+      swi_precess(e, tjd, iflag, J2000_TO_J);
+      for (i = 0; i <= 2; i++)
+	fr->pmat[i * 3 + k] = e[i];
+    }
+    /* change of precession during one day, as in swi_precess_speed() */
+    if (prec_model == SEMOD_PREC_VONDRAK_2011) {
+      swi_ldp_peps(tjd, &dpre, NULL);
+      swi_ldp_peps(tjd + 1, &dpre2, NULL);
+      fr->dpre = dpre2 - dpre;
+    } else {
+      tprec = (tjd - J2000) / 36525.0;
+      fr->dpre = (50.290966 + 0.0222226 * tprec) / 3600 / 365.25 * DEGTORAD;
+    }
+  }
+  /* ayanamsa for traditional sidereal algorithm */
+  if ((iflag & SEFLG_SIDEREAL) &&
+      !(swed.sidd.sid_mode & (SE_SIDBIT_ECL_T0 | SE_SIDBIT_SSY_PLANE))) {
+    if (swi_get_ayanamsa_with_speed(tjd, iflag, fr->daya, serr) == ERR)
+      return ERR;
+  }
+  fr->tjd = tjd;
+  fr->iflag = iflag;
+  fr->dt = dt;
+  return OK;
+}
+
+/* function computes the J2000 cartesian position and speed of a fixed
+ * star from its catalog data. this doesn't depend on the date.
+ * input:
+ * struct fixed_star stardata      fixed star data struct
+ * int32 iflag       SEFLG_ specifications
+ * output:
+ * double x[6]       position and speed
+ * double *tepoch    epoch of catalog position
+ */
+static void fixstar_catalog_vector(struct fixed_star *stardata, int32 iflag, double *x, double *tepoch)
+{
+  double epoch, radv, parall;
+  double ra_pm, de_pm, ra, de;
+  double rdist;
   epoch = stardata->epoch;
   ra_pm = stardata->ramot; de_pm = stardata->demot;
   radv = stardata->radvel; parall = stardata->parall; 
   ra = stardata->ra; de = stardata->de;
   if (epoch == 1950) {
-    t= (tjd - B1950);	/* days since 1950.0 */
+    *tepoch = B1950;	/* days since 1950.0 */
   } else { /* epoch == 2000 */
-    t= (tjd - J2000);	/* days since 2000.0 */
+    *tepoch = J2000;	/* days since 2000.0 */
   }
   x[0] = ra;
   x[1] = de;
@@ -6497,180 +7188,253 @@ static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, i
       swi_bias(x, J2000, SEFLG_SPEED, FALSE);
     }
   }
-  /**************************************************** 
-   * earth/sun 
-   * for parallax, light deflection, and aberration,
-   ****************************************************/
-  if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
-    if ((retc =  main_planet_bary(tjd - dt, SEI_EARTH, epheflag, iflag, NO_SAVE, xearth_dt, xearth_dt, xsun_dt, NULL, serr)) != OK) {
-      return ERR;
-    }
-    if ((retc =  main_planet_bary(tjd, SEI_EARTH, epheflag, iflag, DO_SAVE, xearth, xearth, xsun, NULL, serr)) != OK) {
-      return ERR;
-    }
-  }
-  /************************************
-   * observer: geocenter or topocenter
-   ************************************/
-  /* if topocentric position is wanted  */
-  if (iflag & SEFLG_TOPOCTR) { 
-    if (swi_get_observer(tjd - dt, iflag | SEFLG_NONUT, NO_SAVE, xobs_dt, serr) != OK)
-      return ERR;
-    if (swi_get_observer(tjd, iflag | SEFLG_NONUT, NO_SAVE, xobs, serr) != OK)
-      return ERR;
-    /* barycentric position of observer */
-    for (i = 0; i <= 5; i++) {
-      xobs[i] = xobs[i] + xearth[i];	
-      xobs_dt[i] = xobs_dt[i] + xearth_dt[i];	
-    }
-  } else if (!(iflag & SEFLG_BARYCTR) && (!(iflag & SEFLG_HELCTR) || !(iflag & SEFLG_MOSEPH))) {
-    /* barycentric position of geocenter */
-    for (i = 0; i <= 5; i++) {
-      xobs[i] = xearth[i];
-      xobs_dt[i] = xearth_dt[i];
-    }
-  }
+}
+
+/* function calculates fixed stars in a frame of reference.
+ * the stars are given in structure-of-arrays form, i.e. x[0] is an array
+ * of the first coordinate of all stars, etc., so that the steps that are
+ * linear in the coordinates run as simple loops over all stars.
+ * input:
+ * struct fixstar_frame *fr  frame from fixstar_frame_setup()
+ * int n             number of stars
+ * double *x[6]      catalog position and speed from
+ *                   fixstar_catalog_vector(), overwritten
+ * double *tepoch    epoch of catalog position of each star
+ * double *xsv[6]    work space for J2000 coordinates
+ * output:
+ * double xx[6*n]    position and speed of each star
+ * char *serr        error return string
+ */
+static int32 fixstar_calc_in_frame(struct fixstar_frame *fr, int n, double **x, double *tepoch, double **xsv, double *xx, char *serr)
+{
+  int i, j;
+  int32 iflag = fr->iflag;
+  double t, y0, y1, y2;
+  double xs[6], xxsv[6], *pm = fr->pmat, *xr;
+  struct epsilon *oe = &swed.oec2000;
   /************************************
    * position and speed at tjd        *
    ************************************/
-  /* for parallax */ 
-  if ((iflag & SEFLG_HELCTR) && (iflag & SEFLG_MOSEPH)) {
-    xpo = NULL;		/* no parallax, if moshier and heliocentric */
-    xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
-  } else if (iflag & SEFLG_HELCTR) {
-    xpo = xsun;//psdp->x;
-    xpo_dt = xsun_dt; 
-  } else if (iflag & SEFLG_BARYCTR) {
-    xpo = NULL;		/* no parallax, if barycentric */
-    xpo_dt = NULL;	/* no parallax, if moshier and heliocentric */
-  } else {
-    xpo = xobs;
-    xpo_dt = xobs_dt;
-  }
-  if (xpo == NULL) {
-    for (i = 0; i <= 2; i++) {
-      x[i] += t * x[i+3];	
-    }
-  } else {
-    for (i = 0; i <= 2; i++) {
-      x[i] += t * x[i+3];
-      x[i] -= xpo[i];
-      x[i+3] -= xpo[i+3];
+  for (i = 0; i <= 2; i++) {
+    for (j = 0; j < n; j++) {
+      t = fr->tjd - tepoch[j];
+      x[i][j] += t * x[i+3][j];
+    }
+    /* for parallax */ 
+    if (fr->xpo != NULL) {
+      for (j = 0; j < n; j++) {
+	x[i][j] -= fr->xpo[i];
+	x[i+3][j] -= fr->xpo[i+3];
+      }
     }
   }
-  /************************************
-   * relativistic deflection of light *
-   ************************************/
-  if ((iflag & SEFLG_TRUEPOS) == 0 && (iflag & SEFLG_NOGDEFL) == 0) {
-    swi_deflect_light(x, 0, iflag & SEFLG_SPEED);
+  for (j = 0; j < n; j++) {
+    for (i = 0; i <= 5; i++)
+      xs[i] = x[i][j];
+    /************************************
+     * relativistic deflection of light *
+     ************************************/
+    if ((iflag & SEFLG_TRUEPOS) == 0 && (iflag & SEFLG_NOGDEFL) == 0) {
+      swi_deflect_light(xs, 0, iflag & SEFLG_SPEED);
+    }
+    /**********************************
+     * 'annual' aberration of light   *
+     * speed is incorrect !!!         *
+     **********************************/
+    if ((iflag & SEFLG_TRUEPOS) == 0 && (iflag & SEFLG_NOABERR) == 0)
+      swi_aberr_light_ex(xs, fr->xpo, fr->xpo_dt, fr->dt, iflag & SEFLG_SPEED);
+    /* ICRS to J2000 */
+    if (fr->fbias) {
+      swi_bias(xs, fr->tjd, iflag, FALSE);
+    }/**/
+    /* save J2000 coordinates; required for sidereal positions */
+    for (i = 0; i <= 5; i++)
+      x[i][j] = xsv[i][j] = xs[i];
   }
-  /**********************************
-   * 'annual' aberration of light   *
-   * speed is incorrect !!!         *
-   **********************************/
-  if ((iflag & SEFLG_TRUEPOS) == 0 && (iflag & SEFLG_NOABERR) == 0)
-    swi_aberr_light_ex(x, xpo, xpo_dt, dt, iflag & SEFLG_SPEED);
-  /* ICRS to J2000 */
-  if (!(iflag & SEFLG_ICRS) && (swi_get_denum(SEI_SUN, iflag) >= 403 || (iflag & SEFLG_BARYCTR))) {
-    swi_bias(x, tjd, iflag, FALSE);
-  }/**/
-  /* save J2000 coordinates; required for sidereal positions */
-  for (i = 0; i <= 5; i++)
-    xxsv[i] = x[i];
   /************************************************
    * precession, equator 2000 -> equator of date *
    ************************************************/
-  /*x[0] = -0.374018403; x[1] = -0.312548592; x[2] = -0.873168719;*/
   if ((iflag & SEFLG_J2000) == 0) {
-    swi_precess(x, tjd, iflag, J2000_TO_J);
-    if (iflag & SEFLG_SPEED)
-      swi_precess_speed(x, tjd, iflag, J2000_TO_J);
+    for (i = 0; i <= 3; i += 3) {
+      for (j = 0; j < n; j++) {
+	y0 = x[i][j] * pm[0] + x[i+1][j] * pm[1] + x[i+2][j] * pm[2];
+	y1 = x[i][j] * pm[3] + x[i+1][j] * pm[4] + x[i+2][j] * pm[5];
+	y2 = x[i][j] * pm[6] + x[i+1][j] * pm[7] + x[i+2][j] * pm[8];
+	x[i][j] = y0;
+	x[i+1][j] = y1;
+	x[i+2][j] = y2;
+      }
+    }
     oe = &swed.oec;
-  } else
-    oe = &swed.oec2000;
-  /************************************************
-   * nutation                                     *
-   ************************************************/
-  if (!(iflag & SEFLG_NONUT))
-    swi_nutate(x, iflag, FALSE);
-if ((0)) {
-  double r = sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
-  printf("%.17f %.17f %f\n", x[0]/r, x[1]/r, x[2]/r);
-}
-  /************************************************
-   * transformation to ecliptic.                  *
-   * with sidereal calc. this will be overwritten *
-   * afterwards.                                  *
-   ************************************************/
-  if ((iflag & SEFLG_EQUATORIAL) == 0) {
-    swi_coortrf2(x, x, oe->seps, oe->ceps);
-    if (iflag & SEFLG_SPEED)
-      swi_coortrf2(x+3, x+3, oe->seps, oe->ceps);
-    if (!(iflag & SEFLG_NONUT)) {
-      swi_coortrf2(x, x, swed.nut.snut, swed.nut.cnut);
+  }
+  for (j = 0; j < n; j++) {
+    for (i = 0; i <= 5; i++)
+      xs[i] = x[i][j];
+    if ((iflag & SEFLG_J2000) == 0) {
+      /* rest of swi_precess_speed(): add change of precession */
+      swi_coortrf2(xs, xs, oe->seps, oe->ceps);
+      swi_coortrf2(xs+3, xs+3, oe->seps, oe->ceps);
+      swi_cartpol_sp(xs, xs);
+      xs[3] += fr->dpre;
+      swi_polcart_sp(xs, xs);
+      swi_coortrf2(xs, xs, -oe->seps, oe->ceps);
+      swi_coortrf2(xs+3, xs+3, -oe->seps, oe->ceps);
+    }
+    /************************************************
+     * nutation                                     *
+     ************************************************/
+    if (!(iflag & SEFLG_NONUT))
+      swi_nutate(xs, iflag, FALSE);
+    /************************************************
+     * transformation to ecliptic.                  *
+     * with sidereal calc. this will be overwritten *
+     * afterwards.                                  *
+     ************************************************/
+    if ((iflag & SEFLG_EQUATORIAL) == 0) {
+      swi_coortrf2(xs, xs, oe->seps, oe->ceps);
       if (iflag & SEFLG_SPEED)
-	swi_coortrf2(x+3, x+3, swed.nut.snut, swed.nut.cnut);
+	swi_coortrf2(xs+3, xs+3, oe->seps, oe->ceps);
+      if (!(iflag & SEFLG_NONUT)) {
+	swi_coortrf2(xs, xs, swed.nut.snut, swed.nut.cnut);
+	if (iflag & SEFLG_SPEED)
+	  swi_coortrf2(xs+3, xs+3, swed.nut.snut, swed.nut.cnut);
+      }
     }
-  }
-//  printf("%.17f, %.17f\n", x[0], x[3]);
-  /************************************
-   * sidereal positions               *
-   ************************************/
-  if (iflag & SEFLG_SIDEREAL) {
-    /* rigorous algorithm */
-    if (swed.sidd.sid_mode & SE_SIDBIT_ECL_T0) {
-      if (swi_trop_ra2sid_lon(xxsv, x, xxsv, iflag) != OK)
-        return ERR;
-      if (iflag & SEFLG_EQUATORIAL) {
-        for (i = 0; i <= 5; i++)
-          x[i] = xxsv[i];
+    /************************************
+     * sidereal positions               *
+     ************************************/
+    if (iflag & SEFLG_SIDEREAL) {
+      for (i = 0; i <= 5; i++)
+	xxsv[i] = xsv[i][j];
+      /* rigorous algorithm */
+      if (swed.sidd.sid_mode & SE_SIDBIT_ECL_T0) {
+	if (swi_trop_ra2sid_lon(xxsv, xs, xxsv, iflag) != OK)
+	  return ERR;
+	if (iflag & SEFLG_EQUATORIAL) {
+	  for (i = 0; i <= 5; i++)
+	    xs[i] = xxsv[i];
+	}
+      /* project onto solar system equator */
+      } else if (swed.sidd.sid_mode & SE_SIDBIT_SSY_PLANE) {
+	if (swi_trop_ra2sid_lon_sosy(xxsv, xs, iflag) != OK)
+	  return ERR;
+	if (iflag & SEFLG_EQUATORIAL) {
+	  for (i = 0; i <= 5; i++)
+	    xs[i] = xxsv[i];
+	}
+      /* traditional algorithm */
+      } else {
+	swi_cartpol_sp(xs, xs); 
+	xs[0] -= fr->daya[0] * DEGTORAD;
+	xs[3] -= fr->daya[1] * DEGTORAD;
+	swi_polcart_sp(xs, xs); 
       }
-    /* project onto solar system equator */
-    } else if (swed.sidd.sid_mode & SE_SIDBIT_SSY_PLANE) {
-      if (swi_trop_ra2sid_lon_sosy(xxsv, x, iflag) != OK)
-	return ERR;
-      if (iflag & SEFLG_EQUATORIAL) {
-        for (i = 0; i <= 5; i++)
-          x[i] = xxsv[i];
+    } 
+    /************************************************
+     * transformation to polar coordinates          *
+     ************************************************/
+    if ((iflag & SEFLG_XYZ) == 0)
+      swi_cartpol_sp(xs, xs); 
+    /********************** 
+     * radians to degrees *
+     **********************/
+    if ((iflag & SEFLG_RADIANS) == 0 && (iflag & SEFLG_XYZ) == 0) {
+      for (i = 0; i < 2; i++) {
+	xs[i] *= RADTODEG;
+	xs[i+3] *= RADTODEG;
       }
-    /* traditional algorithm */
-    } else {
-      swi_cartpol_sp(x, x); 
-      // ACHTUNG: siehe Z. 2770!!!!!
-      if (swi_get_ayanamsa_with_speed(tjd, iflag, daya, serr) == ERR)
-        return ERR;
-      x[0] -= daya[0] * DEGTORAD;
-      x[3] -= daya[1] * DEGTORAD;
-      swi_polcart_sp(x, x); 
     }
-  } 
-  /************************************************
-   * transformation to polar coordinates          *
-   ************************************************/
-  if ((iflag & SEFLG_XYZ) == 0)
-    swi_cartpol_sp(x, x); 
-  /********************** 
-   * radians to degrees *
-   **********************/
-  if ((iflag & SEFLG_RADIANS) == 0 && (iflag & SEFLG_XYZ) == 0) {
-    for (i = 0; i < 2; i++) {
-      x[i] *= RADTODEG;
-      x[i+3] *= RADTODEG;
+    xr = xx + j * 6;
+    for (i = 0; i <= 5; i++)
+      xr[i] = xs[i];
+    if (!(fr->iflgsave & SEFLG_SPEED)) {
+      for (i = 3; i <= 5; i++)
+	xr[i] = 0;
     }
   }
-  for (i = 0; i <= 5; i++)
-    xx[i] = x[i];
-  if (!(iflgsave & SEFLG_SPEED)) {
-    for (i = 3; i <= 5; i++)
-      xx[i] = 0;
-  }
   /* if no ephemeris has been specified, do not return chosen ephemeris */
-  if ((iflgsave & SEFLG_EPHMASK) == 0)
+  if ((fr->iflgsave & SEFLG_EPHMASK) == 0)
     iflag = iflag & ~SEFLG_DEFAULTEPH;
   iflag = iflag & ~SEFLG_SPEED;
   return iflag;
 }
 
+/* function calculates a fixstar from a star data struct 
+ * input:
+ * struct fixed_star stardata      fixed star data struct
+ * double tjd        julian daynumber 
+ * int32 iflag       SEFLG_ specifications
+ * output:
+ * char *star        star name, Bayer designation
+ * double xx[6]      position and speed
+ * char *serr        error return string
+ */
+static int32 fixstar_calc_from_struct(struct fixed_star *stardata, double tjd, int32 iflag, char *star, double *xx, char *serr)
+{
+  int i;
+  struct fixstar_frame fr;
+  double x[6], xsv[6], tepoch;
+  double *px[6], *psv[6];
+  if (fixstar_frame_setup(tjd, iflag, &fr, serr) != OK)
+    return ERR;
+  sprintf(star, "%s,%s", stardata->starname, stardata->starbayer);
+  fixstar_catalog_vector(stardata, fr.iflag, x, &tepoch);
+  for (i = 0; i <= 5; i++) {
+    px[i] = &x[i];
+    psv[i] = &xsv[i];
+  }
+  return fixstar_calc_in_frame(&fr, 1, px, &tepoch, psv, xx, serr);
+}
+
+/* function makes sure the structure-of-arrays copy of the fixed stars
+ * list, with each star's catalog position converted to a J2000 vector,
+ * is available for flags iflag.
+ */
+static int32 fixstar_load_soa(int32 iflag, char *serr)
+{
+  int i, j, n = swed.n_fixstars_real;
+  double x[6], *p;
+  struct fixed_star_soa *fsp = &swed.fixsoa;
+  int32 iflgkey = iflag & (SEFLG_EPHMASK | SEFLG_JPLHOR | SEFLG_JPLHOR_APPROX);
+  int32 denum = swi_get_denum(SEI_SUN, iflag);
+  if (fsp->nstars == n && fsp->iflag == iflgkey && fsp->denum == denum)
+    return OK;
+  if (fsp->nstars != n) {
+    if (fsp->tepoch != NULL)
+      free((void *) fsp->tepoch);
+    memset((void *) fsp, 0, sizeof(struct fixed_star_soa));
+    /* one block: catalog vectors, epochs, work space for 12 vectors */
+    if ((p = (double *) malloc((size_t) n * 19 * sizeof(double))) == NULL) {
+      if (serr != NULL)
+	strcpy(serr, "error in malloc() for fixed stars arrays.");
+      return ERR;
+    }
+    fsp->tepoch = p;
+    for (i = 0; i <= 5; i++) {
+      fsp->x[i] = p + n * (1 + i);
+      fsp->w[i] = p + n * (7 + i);
+      fsp->wsv[i] = p + n * (13 + i);
+    }
+  }
+  for (j = 0; j < n; j++) {
+    fixstar_catalog_vector(&swed.fixed_stars[j], iflag, x, &fsp->tepoch[j]);
+    for (i = 0; i <= 5; i++)
+      fsp->x[i][j] = x[i];
+  }
+  fsp->nstars = n;
+  fsp->iflag = iflgkey;
+  fsp->denum = denum;
+  return OK;
+}
+
+/* frees the structure-of-arrays copy of the fixed stars list. */
+static void fixstar_free_soa(void)
+{
+  if (swed.fixsoa.tepoch != NULL)
+    free((void *) swed.fixsoa.tepoch);
+  memset((void *) &swed.fixsoa, 0, sizeof(struct fixed_star_soa));
+}
+
 /* function searches a star in fixed stars list, i.e. the data loaded from file 
  * sefstars.txt
  */
@@ -6878,6 +7642,64 @@ int32 CALL_CONV swe_fixstar2(char *star, double tjd, int32 iflag,
   return retc;
 }
 
+/**********************************************************
+ * function gets the positions of many fixstars at once
+ * parameters:
+ * nstar0	sequential number of first star in star file 
+ *		(start from 1, don't count comment), as with
+ *		swe_fixstar2().
+ * nstars	number of stars to compute
+ * tjd 		absolute julian day
+ * iflag	s. swecalc(); speed bit does not function
+ * xx		pointer to 6 doubles per star for returning position
+ *		coordinates, or NULL to just get the number of stars
+ * serr		error return string
+ * return value: the number of stars computed, which is less than
+ * nstars if the star file ends first, or ERR.
+ * The frame of reference (precession, nutation, the position of the
+ * observer) is set up only once for all stars, which is much faster
+ * than calling swe_fixstar2() for each star.
+**********************************************************/
+int32 CALL_CONV swe_fixstar2_batch(int nstar0, int nstars, double tjd, 
+  int32 iflag, double *xx, char *serr)
+{
+  int i, n;
+  int32 retc;
+  struct fixstar_frame fr;
+  struct fixed_star_soa *fsp = &swed.fixsoa;
+  if (serr != NULL)
+    *serr = '\0';
+  /* initialise first, since that would clear the stars loaded below */
+  swi_init_swed_if_start();
+  load_all_fixed_stars(serr); // loads stars unless loaded with an earlier call of function
+  if (swed.n_fixstars_real <= 0)
+    return ERR;
+  if (xx == NULL)
+    return swed.n_fixstars_real;
+  if (nstar0 < 1) {
+    if (serr != NULL) 
+      sprintf(serr, "error, swe_fixstar2_batch(): sequential fixed star number %d is not available", nstar0);
+    return ERR;
+  }
+  n = swed.n_fixstars_real - (nstar0 - 1);
+  if (n > nstars)
+    n = nstars;
+  if (n <= 0)
+    return 0;
+  if (fixstar_frame_setup(tjd, iflag, &fr, serr) != OK)
+    return ERR;
+  if (fixstar_load_soa(fr.iflag, serr) != OK)
+    return ERR;
+  for (i = 0; i <= 5; i++)
+    memcpy((void *) fsp->w[i], (void *) (fsp->x[i] + nstar0 - 1),
+      (size_t) n * sizeof(double));
+  retc = fixstar_calc_in_frame(&fr, n, fsp->w, fsp->tepoch + nstar0 - 1,
+    fsp->wsv, xx, serr);
+  if (retc == ERR)
+    return ERR;
+  return n;
+}
+
 int32 CALL_CONV swe_fixstar2_ut(char *star, double tjd_ut, int32 iflag, 
   double *xx, char *serr)
 {
@@ -7644,8 +8466,7 @@ static int32 swi_fixstar_calc_from_record(char *srecord, double tjd, int32 iflag
       swed.jpl_file_is_open = FALSE;
     }
     for (i = 0; i < SEI_NEPHFILES; i ++) {
-      if (swed.fidat[i].fptr != NULL) 
-	fclose(swed.fidat[i].fptr);
+      close_ephe_file(&swed.fidat[i]);
       memset((void *) &swed.fidat[i], 0, sizeof(struct file_data));
     }
     swed.last_epheflag = epheflag;
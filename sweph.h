@@ -192,6 +192,7 @@
 #define SE_FILE_SUFFIX	"se1"
 
 #define SEI_NEPHFILES   7
+#define SEI_NSEGCACHE   4	/* decoded segments kept per body */
 #define SEI_CURR_FPOS   -1
 #define SEI_NMODELS 8
 
@@ -642,6 +643,13 @@ struct plan_data {
 			 * the size is 3 x ncoe */
   int neval;		/* how many coefficients to evaluate. this may
 			 * be less than ncoe */
+  /* recently used segments, most recent first. segc[0] is segp: */
+  double *segc[SEI_NSEGCACHE];	/* unpacked cheby coeffs of segments */
+  double tsegc[SEI_NSEGCACHE];	/* start jd of segments */
+  int nevalc[SEI_NSEGCACHE];	/* neval of segments */
+  int nsegc;		/* number of segments in cache */
+  int32 nseghit;	/* times a segment was found in cache */
+  int32 nsegmiss;	/* times a segment had to be read from file */
   /* result of most recent data evaluation for this body: */
   double teval;		/* time for which previous computation was made */
   int32 iephe;            /* which ephemeris was used */
@@ -712,6 +720,10 @@ struct file_data {
   int32 sweph_denum;     /* DE number of JPL ephemeris, which this file
 			 * is derived from. */
   FILE *fptr;		/* ephemeris file pointer */
+#ifdef MMAP
+  unsigned char *pmap;	/* ephemeris file mapped into memory, or NULL */
+  int32 lmap;		/* length of mapped file */
+#endif
   double tfstart;       /* file may be used from this date */
   double tfend;         /*      through this date          */
   int32 iflg; 		/* byte reorder flag and little/bigendian flag */
@@ -778,6 +790,18 @@ struct fixed_star {
   double epoch, ra, de, ramot, demot, radvel, parall, mag;
 };
 
+/* fixed stars list as J2000 vectors in structure-of-arrays form, so
+ * that many stars can be computed with simple loops over each array */
+struct fixed_star_soa {
+  int nstars;		/* number of stars in arrays */
+  int32 iflag;		/* ephemeris flags arrays were computed for */
+  int32 denum;		/* ephemeris number arrays were computed for */
+  double *tepoch;	/* epoch of catalog position of each star */
+  double *x[6];		/* position and speed of each star */
+  double *w[6];		/* work space for computing stars */
+  double *wsv[6];	/* work space for J2000 coordinates */
+};
+
 /* dpsi and deps loaded for 100 years after 1962 */
 #define SWE_DATA_DPSI_DEPS  36525   
 
@@ -844,6 +868,7 @@ struct swe_data {
   AS_BOOL n_fixstars_named;  // number of fixed stars with tradtional name
   AS_BOOL n_fixstars_records;// number of fixed stars records in fixed_stars
   struct fixed_star *fixed_stars;
+  struct fixed_star_soa fixsoa;
 };
 
 extern TLS struct swe_data swed;
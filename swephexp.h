@@ -385,6 +385,7 @@ extern "C" {
 #define SE_FNAME_DFT2   SE_FNAME_DE406
 #define SE_STARFILE_OLD "fixstars.cat"
 #define SE_STARFILE     "sefstars.txt"
+#define SE_STARFILE_BIN "sefstars.bin"
 #define SE_ASTNAMFILE   "seasnam.txt"
 #define SE_FICTFILE     "seorbel.txt"
 
@@ -739,6 +740,11 @@ ext_def(int32) swe_fixstar2_ut(char *star, double tjd_ut, int32 iflag,
 
 ext_def(int32) swe_fixstar2_mag(char *star, double *mag, char *serr);
 
+ext_def(int32) swe_fixstar2_batch(int nstar0, int nstars, double tjd,
+	int32 iflag, double *xx, char *serr);
+
+ext_def(int32) swe_fixstar2_write_bin(char *fname, char *serr);
+
 /* close Swiss Ephemeris */
 ext_def( void ) swe_close(void);
 
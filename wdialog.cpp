@@ -318,7 +318,7 @@ flag FDlgInfoAtlas(HWND hdlg, WORD wParam, flag fDefault)
       GetEdit(dcInYea, sz); ci.yea = NParseSz(sz, pmYea);
       GetEdit(dcInTim, sz); ci.tim = RParseSz(sz, pmTim);
     }
-    if (!DisplayTimezoneChanges(is.rgae[i].izn, 0, &ci))
+    if (!FZoneDstFromIzn(&ci, is.rgae[i].izn, fTrue))
       PrintWarning("Couldn't get time zone data!");
     SetEditSZOA(hdlg, dcDst, dcZon, dcLon, dcLat,
       ci.dst, ci.zon, is.rgae[i].lon, is.rgae[i].lat);
@@ -77,8 +77,8 @@ GS gs = {
 #else
   0,
 #endif
-  200, 100, 0, 0, 0, 3, 1, 0, 0.0, 0.0, oMoo, BITMAPMODE, 25.0, 1, 0,
-  8.5, 11.0, NULL, 0, 25, 11, 1, kMax, NULL, oCore, 0.0, 1000, 0, 600,
+  200, 100, 0, 0, 0, 3, 1, 0, 0.0, 0.0, oMoo, BITMAPMODE, 6, 25.0, 1,
+  0, 8.5, 11.0, NULL, 0, 25, 11, 1, kMax, NULL, oCore, 0.0, 1000, 0, 600,
   1, 1, 1, 2, 2, 1, fFalse, fFalse, fTrue, 7, 0, 0, NULL, NULL};
 
 GI gi = {
@@ -87,7 +87,7 @@ GI gi = {
   2, 1, 1, 1, 1, 20, 10, 0xb19438, kWhite, kBlack, kLtGray, kDkGray,
   0, 0, 0, 0, -1, -1, NULL, 0, 0, NULL, NULL,
   fTrue, {0, 0, 0, NULL}, {0, 0, 0, NULL}, {0, 0, 0, NULL}, {0, 0, 0, NULL},
-  {0, 0, 0, NULL},
+  {0, 0, 0, NULL}, NULL, 0, 0, 0, 0.0, fFalse, {0}, 0,
 #ifdef SWISS
   NULL, 0,
 #endif
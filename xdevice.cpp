@@ -253,38 +253,145 @@ flag FLoadBmp(CONST char *szFile, Bitmap *bmp, flag fNoHeader)
 }
 
 
-// Write a 24 bit bitmap to a previously opened file, in the 24 bit bitmap
-// format used by Microsoft Windows for its .bmp extension files.
+// Write out any bytes waiting in the output buffer to the graphics file.
+// Binary graphics files are composed through this buffer with the PutByte()
+// macro and PutRgb(), rather than a separate library call for each byte.
+
+void FlushOutBuf(FILE *file)
+{
+  if (gi.ibOut > 0) {
+    fwrite(gi.rgbOut, 1, gi.ibOut, file);
+    gi.ibOut = 0;
+  }
+}
+
+
+// Add a byte to the graphics file output buffer, when it's already full.
+
+void PutByteBuf(FILE *file, byte b)
+{
+  FlushOutBuf(file);
+  gi.rgbOut[gi.ibOut++] = b;
+}
+
+
+// Add a block of bytes to the graphics file output buffer, writing large
+// blocks directly to the file.
+
+void PutRgb(FILE *file, CONST byte *rgb, int cb)
+{
+  if (gi.ibOut + cb > cbOutBuf)
+    FlushOutBuf(file);
+  if (cb >= cbOutBuf) {
+    fwrite(rgb, 1, cb, file);
+    return;
+  }
+  CopyRgb(rgb, gi.rgbOut + gi.ibOut, cb);
+  gi.ibOut += cb;
+}
+
+
+// Determine whether a 24 bit bitmap contains few enough different colors
+// that it can be saved as an indexed image with a color palette, as is the
+// case for most charts, which only use the standard 16 colors. If so, fill
+// out the palette and an allocated array of palette indexes for each pixel
+// (which the caller must free), and return the number of colors in it.
+// Otherwise return 0 if there are more than the given number of colors.
+
+int CkvBmpPalette(CONST Bitmap *b, KV *rgkv, int ckvMax, byte **prgbIndex)
+{
+  int rgiHash[1024], ckv = 0, x, y, iHash, i = 0;
+  byte *rgbIndex, *pbIndex;
+  CONST byte *pb;
+  KV kv, kvPrev = -1;
+
+  rgbIndex = RgAllocate(b->x * b->y, byte, "bitmap palette");
+  if (rgbIndex == NULL)
+    return 0;
+  for (iHash = 0; iHash < 1024; iHash++)
+    rgiHash[iHash] = -1;
+  pbIndex = rgbIndex;
+  for (y = 0; y < b->y; y++) {
+    pb = _PbXY(b, 0, y);
+    for (x = 0; x < b->x; x++, pb += cbPixelK) {
+      kv = _GetP(pb);
+      if (kv != kvPrev) {
+        // Look up color in hash table, adding it to palette if not found.
+        iHash = (int)(((dword)kv * 0x9E3779B1L) >> 22) & 1023;
+        loop {
+          i = rgiHash[iHash];
+          if (i < 0 || rgkv[i] == kv)
+            break;
+          iHash = (iHash + 1) & 1023;
+        }
+        if (i < 0) {
+          if (ckv >= ckvMax) {
+            DeallocateP(rgbIndex);
+            return 0;
+          }
+          i = rgiHash[iHash] = ckv;
+          rgkv[ckv++] = kv;
+        }
+        kvPrev = kv;
+      }
+      *pbIndex++ = i;
+    }
+  }
+  *prgbIndex = rgbIndex;
+  return ckv;
+}
+
+
+// Write a 24 bit bitmap to a previously opened file, in the bitmap format
+// used by Microsoft Windows for its .bmp extension files. If the bitmap
+// contains 256 or fewer colors, it will be written as a 4 or 8 bit bitmap
+// with a color palette, otherwise as a 24 bit bitmap.
 
 void WriteBmp2(CONST Bitmap *b, FILE *file)
 {
-  int x, y, cb;
+  KV rgkv[256];
+  int x, y, cb, cbRow, ckv, z;
+  byte *rgbIndex = NULL, *pbIndex;
   dword dw;
 
-  cb = (4 - ((b->x*3) & 3)) & 3;
+  ckv = CkvBmpPalette(b, rgkv, 256, &rgbIndex);
+  z = ckv <= 0 ? 24 : (ckv <= 16 ? 4 : 8);
+  cbRow = (b->x*z + 7) >> 3;
+  cb = (4 - (cbRow & 3)) & 3;
   // BitmapFileHeader
   PutByte('B'); PutByte('M');
-  dw = 14+40 + 0 + b->y*(b->x*3+cb);
+  dw = 14+40 + ckv*4 + b->y*(cbRow+cb);
   PutLong(dw);
   PutWord(0); PutWord(0);
-  PutLong(14+40 + 0);
+  PutLong(14+40 + ckv*4);
   // BitmapInfo / BitmapInfoHeader
   PutLong(40);
   PutLong(b->x); PutLong(b->y);
-  PutWord(1); PutWord(24);
+  PutWord(1); PutWord(z);
   PutLong(0 /*BI_RGB*/); PutLong(0);
   PutLong(0); PutLong(0);
-  PutLong(0); PutLong(0);
+  PutLong(ckv); PutLong(0);
   // RgbQuad
+  for (x = 0; x < ckv; x++) {
+    PutByte(RgbB(rgkv[x])); PutByte(RgbG(rgkv[x]));
+    PutByte(RgbR(rgkv[x])); PutByte(0);
+  }
   // Data
   for (y = b->y-1; y >= 0; y--) {
-    for (x = 0; x < b->x; x++) {
-      dw = _GetXY(b, x, y);
-      PutByte(RgbB(dw)); PutByte(RgbG(dw)); PutByte(RgbR(dw));
+    if (z == 4) {
+      pbIndex = rgbIndex + y*b->x;
+      for (x = 0; x < b->x; x += 2)
+        PutByte((pbIndex[x] << 4) | (x+1 < b->x ? pbIndex[x+1] : 0));
+    } else if (z == 8)
+      PutRgb(file, rgbIndex + y*b->x, b->x);
+    else {
+      // Bitmaps in memory already store pixels in the same BGR order.
+      PutRgb(file, _PbXY(b, 0, y), b->x*cbPixelK);
     }
     for (x = 0; x < cb; x++)
       PutByte(0);
   }
+  DeallocatePIf(rgbIndex);
 }
 
 
@@ -340,9 +447,10 @@ void BmpCopyBlock(CONST Bitmap *bs, int x1, int y1, int x2, int y2,
 
 
 // Adjust the color of a pixel on a world map, based on whether the location
-// is at night time, or whether the location is under a solar eclipse.
+// is at night time, or whether the location is under a solar eclipse. The
+// eclipse is checked for if its geometry is passed in.
 
-void BmpDarkenKv(real lon, real lat, real lonS, real latS, flag fDoEclipse,
+void BmpDarkenKv(real lon, real lat, real lonS, real latS, CONST SH *psh,
   KV *pkv)
 {
   KV kv = *pkv;
@@ -359,9 +467,9 @@ void BmpDarkenKv(real lon, real lat, real lonS, real latS, flag fDoEclipse,
 
 #ifdef SWISS
   // Check for a partial or annular/total solar eclipse at the location.
-  if (!fDoEclipse)
+  if (psh == NULL)
     return;
-  et = NCheckEclipseSolarLoc(rDegHalf - lon, rDegQuad - lat, &rEclipse);
+  et = NCheckSolarShadow(psh, rDegHalf - lon, rDegQuad - lat, &rEclipse);
   if (et <= etNone)
     return;
   if (et <= etPartial) {
@@ -382,7 +490,7 @@ void BmpCopyBlock2(CONST Bitmap *bs, real x1, real y1, real x2, real y2,
   int xd = x4-x3+1, yd = y4-y3+1, x, y, xT, yT, nR, nG, nB;
   real xs, ys, lonS, latS, rx, ry;
   byte *pbDst;
-  flag fDoEclipse = fFalse;
+  SH sh, *psh = NULL;
   KV kv;
 
   // Sanity checks of coordinate bounds, which shouldn't ever fail.
@@ -400,9 +508,12 @@ void BmpCopyBlock2(CONST Bitmap *bs, real x1, real y1, real x2, real y2,
     latS = planetalt[oSun];
     EclToEqu(&lonS, &latS);
     lonS = Mod(lonS - cp0.lonMC + rDegHalf - Lon);
+#ifdef SWISS
     if (us.fEclipse &&
-      NCheckEclipseSolar(oEar, oMoo, oSun, NULL) > etNone)
-      fDoEclipse = fTrue;
+      NCheckEclipseSolar(oEar, oMoo, oSun, NULL) > etNone &&
+      FInitSolarShadow(&sh))
+      psh = &sh;
+#endif
   }
 
   xs = (x2-x1) / (real)xd;
@@ -427,7 +538,7 @@ void BmpCopyBlock2(CONST Bitmap *bs, real x1, real y1, real x2, real y2,
         xT = (int)rx;
         rx = rx * rDegMax / (real)bs->x;
         kv = _GetXY(bs, xT, yT);
-        BmpDarkenKv(rx, ry, lonS, latS, fDoEclipse, &kv);
+        BmpDarkenKv(rx, ry, lonS, latS, psh, &kv);
         BmpSetXY(bd, x, y, kv);
       }
     }
@@ -665,17 +776,154 @@ flag FBmpDrawBack(Bitmap *bDest)
 }
 
 
+// Compute the Earth coordinates of each pixel in one row of a -XP polar or
+// -XG globe map bitmap, as longitude and latitude pairs. Pixels outside the
+// Earth have a negative latitude. The coordinates don't depend on rotation,
+// so spinning the Earth just offsets the longitudes. If fTable is set, look
+// them up in the table set up by FEnsureMapProj() instead.
+
+void MapProjRow(int y1, real *pr, flag fTable)
+{
+  int xc, yc, zc, x1, xi, yi, n, n2;
+  real rxc, ryc, rzc, lon, lat, lat0, rT, rLen, sint, cost, sina, cosa;
+  CONST float *pf;
+
+  if (fTable) {
+    pf = &gi.rgfProj[y1 * gs.xWin * 2];
+    for (x1 = 0; x1 < gs.xWin * 2; x1++)
+      pr[x1] = (real)pf[x1];
+    return;
+  }
+  xc = (gs.xWin >> 1) - !FOdd(gs.xWin); yc = (gs.yWin >> 1) - !FOdd(gs.yWin);
+  zc = Max(xc, yc);
+  rxc = (real)xc; ryc = (real)yc; rzc = (real)zc;
+  yi = !FOdd(gs.yWin) && y1 > yc;
+
+  // Compute coordinates for a -XP polar map.
+  if (gi.nMode == gPolar) {
+    for (x1 = 0; x1 < gs.xWin; x1++, pr += 2) {
+      xi = !FOdd(gs.xWin) && x1 > xc;
+      n  = xc - x1 + xi;
+      n2 = yc - y1 + yi;
+      if (xc > yc)
+        n2 = n2 * xc / yc;
+      else if (yc > xc)
+        n = n * yc / xc;
+      n = Sq(n) + Sq(n2);
+      if (n > Sq(zc)) {
+        pr[1] = -1.0;
+        continue;
+      }
+      lat = RAsinD(RSqr((real)n) / rzc) * 2.0;
+      if (gs.fSouth)
+        lat = rDegHalf - lat;
+      lon = RAngleD(x1 - xc, y1 - yc);
+      pr[0] = !gs.fSouth ? -lon : lon;
+      pr[1] = lat;
+    }
+    return;
+  }
+
+  // Compute coordinates for a -XG globe.
+  if (gs.rTilt != 0.0) {
+    sint = RSinD(-gs.rTilt);
+    cost = RCosD(-gs.rTilt);
+  }
+  rT = (ryc - (real)y1) / ryc;
+  if (rT < -1.0)    // Roundoff may put it slightly outside Acos range.
+    rT = -1.0;
+  else if (rT > 1.0)
+    rT = 1.0;
+  lat0 = RAcosD(rT);
+  n = xc; n2 = yc - y1;
+  if (xc > yc)
+    n2 = n2 * xc / yc;
+  else if (yc > xc)
+    n = n * yc / xc;
+  rT = (real)(Sq(n) - Sq(n2));
+  rLen = rT >= 0.0 ? RSqr(rT) : rSmall;
+  if (rLen < rSmall)
+    rLen = 1.0;
+  sina = RSinD(rDegQuad - lat0);
+  cosa = RCosD(rDegQuad - lat0);
+  for (x1 = 0; x1 < gs.xWin; x1++, pr += 2) {
+    xi = !FOdd(gs.xWin) && x1 > xc;
+    n  = xc - x1 + xi;
+    n2 = yc - y1 + yi;
+    if (xc > yc)
+      n2 = n2 * xc / yc;
+    else if (yc > xc)
+      n = n * yc / xc;
+    n = Sq(n) + Sq(n2);
+    if (n > Sq(zc)) {
+      pr[1] = -1.0;
+      continue;
+    }
+    lon = (rxc - (real)x1) / rxc;
+    rT = lon / rLen * rzc;
+    if (rT < -1.0)    // Roundoff may put it slightly outside Acos range.
+      rT = -1.0;
+    else if (rT > 1.0)
+      rT = 1.0;
+    lon = Mod(RAcosD(rT));
+    lat = lat0;
+    if (gs.rTilt != 0.0) {
+      lat = rDegQuad - lat;
+      CoorXformFast(&lon, &lat, RSinD(lon), RCosD(lon),
+        sina, cosa, sint, cost);
+      lat = rDegQuad - lat;
+    }
+    pr[0] = lon;
+    pr[1] = lat;
+  }
+}
+
+
+// Make sure the table of Earth coordinates for each pixel of a -XP polar or
+// -XG globe map bitmap is up to date with the window size and projection, so
+// redrawing the window (as when animating) doesn't have to recompute them.
+// The table is only made for windows and not for one time file output, and
+// stores floats to keep it small. Returns whether the table is available,
+// using the row buffer pr as temporary space to compute it in.
+
+flag FEnsureMapProj(real *pr)
+{
+  float *pf;
+  int y1, x1;
+
+  if (gi.nModeProj == gi.nMode &&
+    gi.xProj == gs.xWin && gi.yProj == gs.yWin && (gi.nMode == gGlobe ?
+    gi.rTiltProj == gs.rTilt : gi.fSouthProj == gs.fSouth))
+    return gi.rgfProj != NULL;
+  if (gi.fFile)
+    return fFalse;
+  DeallocatePIf(gi.rgfProj);
+  gi.nModeProj = gi.nMode; gi.xProj = gs.xWin; gi.yProj = gs.yWin;
+  gi.rTiltProj = gs.rTilt; gi.fSouthProj = gs.fSouth;
+  gi.rgfProj = RgAllocate(gs.xWin * gs.yWin * 2, float, "map projection");
+  if (gi.rgfProj == NULL)
+    return fFalse;
+  pf = gi.rgfProj;
+  for (y1 = 0; y1 < gs.yWin; y1++) {
+    MapProjRow(y1, pr, fFalse);
+    for (x1 = 0; x1 < gs.xWin * 2; x1++)
+      *pf++ = (float)pr[x1];
+  }
+  return fTrue;
+}
+
+
 // Draw the world map bitmap upon the specified 24 bit bitmap. This draws the
 // world in the appropriate projection for various Astrolog charts.
 
 flag FBmpDrawMap()
 {
   Bitmap *bmp = &gi.bmp;
-  int nScl = 1, yWin2, xc, yc, zc, x1, x2, y1, y2, xi, yi, n, n2;
-  real deg = Mod(rDegMax - gs.rRot), lonS, latS, rxc, ryc, rzc,
-    lon, lat, lat0, rT, rLen, sint, cost, sina, cosa;
+  int nScl = 1, yWin2, xc, x1, x2, y1, y2, n, n2;
+  real deg = Mod(rDegMax - gs.rRot), lonS, latS, lon, lat, rT, *rgr, *pr;
+  flag fTable;
   KV kv;
-  flag fDoEclipse = fFalse;
+  SH sh, *psh = NULL;
 
   // Do nothing if not drawing bitmaps, or if the Earth bitmap fails to load.
   if (!gi.fBmp || (gi.fFile && gs.ft != ftBmp))
@@ -692,14 +940,16 @@ flag FBmpDrawMap()
     bmp = &wi.bmpWin;
   }
 #endif
+#ifdef SWISS
+  // Set up the shadow of any solar eclipse once for all pixels.
   if (gs.fMollweide && us.fEclipse &&
-    NCheckEclipseSolar(oEar, oMoo, oSun, NULL) > etNone)
-    fDoEclipse = fTrue;
+    NCheckEclipseSolar(oEar, oMoo, oSun, NULL) > etNone &&
+    FInitSolarShadow(&sh))
+    psh = &sh;
+#endif
 
-  // Compute center coordinates and horizontal map dimensions.
-  xc = (gs.xWin >> 1) - !FOdd(gs.xWin); yc = (gs.yWin >> 1) - !FOdd(gs.yWin);
-  zc = Max(xc, yc);
-  rxc = (real)xc; ryc = (real)yc; rzc = (real)zc;
+  // Compute center coordinate and horizontal map dimensions.
+  xc = (gs.xWin >> 1) - !FOdd(gs.xWin);
   x1 = (int)((real)gi.bmpWorld.x * deg / rDegMax);
   x2 = (int)((real)gs.xWin       * deg / rDegMax);
 
@@ -740,28 +990,22 @@ flag FBmpDrawMap()
   } else if (gi.nMode == gPolar) {
     if (!FBmpDrawBack(bmp))
       BmpSetAll(bmp, KvFromKi(gi.kiOff));
+    rgr = RgAllocate(gs.xWin * 2, real, "map row");
+    if (rgr == NULL)
+      return fFalse;
+    fTable = FEnsureMapProj(rgr);
     lonS = Tropical(planet[oSun]);
     latS = planetalt[oSun];
     EclToEqu(&lonS, &latS);
     lonS = Mod(lonS - cp0.lonMC + rDegHalf - Lon);
     for (y1 = 0; y1 < gs.yWin; y1++) {
-      yi = !FOdd(gs.yWin) && y1 > yc;
-      for (x1 = 0; x1 < gs.xWin; x1++) {
-        xi = !FOdd(gs.xWin) && x1 > xc;
-        n  = xc - x1 + xi;
-        n2 = yc - y1 + yi;
-        if (xc > yc)
-          n2 = n2 * xc / yc;
-        else if (yc > xc)
-          n = n * yc / xc;
-        n = Sq(n) + Sq(n2);
-        if (n > Sq(zc))
+      MapProjRow(y1, rgr, fTable);
+      pr = rgr;
+      for (x1 = 0; x1 < gs.xWin; x1++, pr += 2) {
+        lat = pr[1];
+        if (lat < 0.0)
           continue;
-        lat = RAsinD(RSqr((real)n) / rzc) * 2.0;
-        if (gs.fSouth)
-          lat = rDegHalf - lat;
-        lon = RAngleD(x1 - xc, y1 - yc);
-        lon = Mod(270.0 - gs.rRot + (!gs.fSouth ? -lon : lon));
+        lon = Mod(270.0 - gs.rRot + pr[0]);
         if (gs.fEcliptic) {
           lon = Tropical(lon);
           lat = rDegQuad - lat;
@@ -773,68 +1017,32 @@ flag FBmpDrawMap()
         y2 = (int)(lat * ((real)gi.bmpWorld.y - rSmall) / rDegHalf);
         kv = _GetXY(&gi.bmpWorld, x2, y2);
         if (gs.fMollweide)
-          BmpDarkenKv(lon, lat, lonS, latS, fDoEclipse, &kv);
+          BmpDarkenKv(lon, lat, lonS, latS, psh, &kv);
         BmpSetXY(bmp, x1, y1, kv);
       }
     }
+    DeallocateP(rgr);
 
   // Draw map on a -XG globe.
   } else if (gi.nMode == gGlobe) {
     if (!FBmpDrawBack(bmp))
       BmpSetAll(bmp, KvFromKi(gi.kiOff));
-    if (gs.rTilt != 0.0) {
-      sint = RSinD(-gs.rTilt);
-      cost = RCosD(-gs.rTilt);
-    }
+    rgr = RgAllocate(gs.xWin * 2, real, "map row");
+    if (rgr == NULL)
+      return fFalse;
+    fTable = FEnsureMapProj(rgr);
     lonS = Tropical(planet[oSun]);
     latS = planetalt[oSun];
     EclToEqu(&lonS, &latS);
     lonS = Mod(lonS - cp0.lonMC + rDegHalf - Lon);
     for (y1 = 0; y1 < gs.yWin; y1++) {
-      yi = !FOdd(gs.yWin) && y1 > yc;
-      rT = (ryc - (real)y1) / ryc;
-      if (rT < -1.0)    // Roundoff may put it slightly outside Acos range.
-        rT = -1.0;
-      else if (rT > 1.0)
-        rT = 1.0;
-      lat0 = RAcosD(rT);
-      n = xc; n2 = yc - y1;
-      if (xc > yc)
-        n2 = n2 * xc / yc;
-      else if (yc > xc)
-        n = n * yc / xc;
-      rT = (real)(Sq(n) - Sq(n2));
-      rLen = rT >= 0.0 ? RSqr(rT) : rSmall;
-      if (rLen < rSmall)
-        rLen = 1.0;
-      sina = RSinD(rDegQuad - lat0);
-      cosa = RCosD(rDegQuad - lat0);
-      for (x1 = 0; x1 < gs.xWin; x1++) {
-        xi = !FOdd(gs.xWin) && x1 > xc;
-        n  = xc - x1 + xi;
-        n2 = yc - y1 + yi;
-        if (xc > yc)
-          n2 = n2 * xc / yc;
-        else if (yc > xc)
-          n = n * yc / xc;
-        n = Sq(n) + Sq(n2);
-        if (n > Sq(zc))
+      MapProjRow(y1, rgr, fTable);
+      pr = rgr;
+      for (x1 = 0; x1 < gs.xWin; x1++, pr += 2) {
+        lat = pr[1];
+        if (lat < 0.0)
           continue;
-        lon = (rxc - (real)x1) / rxc;
-        rT = lon / rLen * rzc;
-        if (rT < -1.0)    // Roundoff may put it slightly outside Acos range.
-          rT = -1.0;
-        else if (rT > 1.0)
-          rT = 1.0;
-        lon = Mod(RAcosD(rT));
-        lat = lat0;
-        if (gs.rTilt != 0.0) {
-          lat = rDegQuad - lat;
-          CoorXformFast(&lon, &lat, RSinD(lon), RCosD(lon),
-            sina, cosa, sint, cost);
-          lat = rDegQuad - lat;
-        }
-        lon = Mod(lon - gs.rRot);
+        lon = Mod(pr[0] - gs.rRot);
         if (gs.fEcliptic) {
           lon = Tropical(lon);
           lat = rDegQuad - lat;
@@ -869,10 +1077,11 @@ flag FBmpDrawMap()
         }
 #endif
         if (gs.fMollweide)
-          BmpDarkenKv(lon, lat, lonS, latS, fDoEclipse, &kv);
+          BmpDarkenKv(lon, lat, lonS, latS, psh, &kv);
         BmpSetXY(bmp, x1, y1, kv);
       }
     }
+    DeallocateP(rgr);
   }
 
 #ifdef WINANY
@@ -1139,6 +1348,535 @@ void WriteBmp(FILE *file)
 }
 
 
+/*
+******************************************************************************
+** PNG Compression Routines.
+******************************************************************************
+*/
+
+#define cbDefWin  32768  // Size of sliding window matches can be found in.
+#define cbDefHash 32768  // Number of entries in table of 3 byte sequences.
+#define cchDefMin 3      // Shortest and longest matches that can be coded.
+#define cchDefMax 258
+#define csymDef   16384  // Number of symbols compressed in each block.
+#define cLitDef   286    // Number of literal/length and distance codes.
+#define cDistDef  30
+#define cbCodeMax 15     // Longest Huffman code allowed for symbols.
+#define DefHash(pb) ((((int)(pb)[0] << 10) ^ ((int)(pb)[1] << 5) ^ \
+  (int)(pb)[2]) & (cbDefHash-1))
+
+CONST int rgnLenBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23,
+  27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+CONST int rgnLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+CONST int rgnDistBase[cDistDef] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49,
+  65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577};
+CONST int rgnDistExtra[cDistDef] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5,
+  6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+CONST int rgnCodeOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3,
+  13, 2, 14, 1, 15};
+
+// Number of hash chain links to follow, and length of match considered good
+// enough to stop looking, for each compression level (-YXz).
+CONST int rgnDefChain[10] = {0, 4, 8, 16, 16, 32, 128, 256, 1024, 4096};
+CONST int rgnDefNice[10]  = {0, 8, 16, 32, 32, 64, 128, 128, 258, 258};
+
+// State of a DEFLATE compressor, as used by FDeflateRgb().
+
+typedef struct _DeflateState {
+  CONST byte *pbIn;    // Data being compressed.
+  int cbIn;            // Size of data being compressed.
+  int nLevel;          // Compression level, from 1 to 9.
+  byte *pbOut;         // Buffer compressed data is written to.
+  int ibOut;           // Bytes written to output buffer so far.
+  dword dwBits;        // Bits waiting to be written to output buffer.
+  int cBits;           // Number of bits waiting to be written.
+  int *rgHead;         // Most recent position of each 3 byte sequence.
+  int *rgPrev;         // Previous position with same sequence as each one.
+  word *rgwLen;        // Byte or match length of each symbol in block.
+  word *rgwDist;       // Match distance of each symbol, or 0 for a byte.
+  int csym;            // Number of symbols in block so far.
+  int ibBlock;         // Position in data that block starts at.
+  int cbStored;        // Most bytes to put in each stored block.
+} DFS;
+
+
+// Append bits to a DEFLATE compressed stream, least significant bit first.
+
+void PutDeflateBits(DFS *pdfs, dword dw, int cBit)
+{
+  pdfs->dwBits |= dw << pdfs->cBits;
+  pdfs->cBits += cBit;
+  while (pdfs->cBits >= 8) {
+    pdfs->pbOut[pdfs->ibOut++] = (byte)pdfs->dwBits;
+    pdfs->dwBits >>= 8;
+    pdfs->cBits -= 8;
+  }
+}
+
+
+// Given the frequency of each symbol in an alphabet, compute the length of
+// the Huffman code for each symbol, such that no code is longer than the
+// given limit. At least two symbols are always given codes, so that the
+// code is complete.
+
+void ComputeHuffLen(CONST int *rgFreq, int csym, int cbMax, byte *rgLen)
+{
+  int rgnFreq[cLitDef*3], rgnUp[cLitDef*2], rgnLeaf[cLitDef], cLeaf, cNode,
+    isym, i, i1, i2, n, nMax;
+
+  for (isym = 0; isym < csym; isym++)
+    rgnFreq[isym] = rgFreq[isym];
+  loop {
+    // Gather symbols used, making sure there are at least two of them.
+    cLeaf = 0;
+    for (isym = 0; isym < csym; isym++) {
+      rgLen[isym] = 0;
+      if (rgnFreq[isym] > 0)
+        rgnLeaf[cLeaf++] = isym;
+    }
+    for (isym = 0; cLeaf < 2; isym++)
+      if (rgnFreq[isym] == 0) {
+        rgnFreq[isym] = 1;
+        rgnLeaf[cLeaf++] = isym;
+      }
+
+    // Build the tree by repeatedly joining the two least frequent nodes.
+    for (i = 0; i < cLeaf; i++) {
+      rgnFreq[csym + i] = rgnFreq[rgnLeaf[i]];
+      rgnUp[i] = -1;
+    }
+    for (cNode = cLeaf; ; cNode++) {
+      i1 = i2 = -1;
+      for (i = 0; i < cNode; i++) {
+        if (rgnUp[i] >= 0)
+          continue;
+        if (i1 < 0 || rgnFreq[csym + i] < rgnFreq[csym + i1]) {
+          i2 = i1; i1 = i;
+        } else if (i2 < 0 || rgnFreq[csym + i] < rgnFreq[csym + i2])
+          i2 = i;
+      }
+      if (i2 < 0)
+        break;
+      rgnFreq[csym + cNode] = rgnFreq[csym + i1] + rgnFreq[csym + i2];
+      rgnUp[i1] = rgnUp[i2] = cNode;
+      rgnUp[cNode] = -1;
+    }
+
+    // Code length of each symbol is its depth in the tree.
+    nMax = 0;
+    for (i = 0; i < cLeaf; i++) {
+      n = 0;
+      for (i1 = i; rgnUp[i1] >= 0; i1 = rgnUp[i1])
+        n++;
+      rgLen[rgnLeaf[i]] = n;
+      nMax = Max(nMax, n);
+    }
+    if (nMax <= cbMax)
+      break;
+
+    // Some codes are too long, so flatten the frequencies and try again.
+    for (isym = 0; isym < csym; isym++)
+      if (rgnFreq[isym] > 0)
+        rgnFreq[isym] = (rgnFreq[isym] + 1) >> 1;
+  }
+}
+
+
+// Given the length of the Huffman code for each symbol in an alphabet,
+// compute the canonical codes themselves, with their bits reversed for
+// output into a DEFLATE stream.
+
+void ComputeHuffCode(CONST byte *rgLen, int csym, word *rgCode)
+{
+  int rgnCount[cbCodeMax+1], rgnNext[cbCodeMax+1], isym, n, i, nCode, nRev;
+
+  ClearB((pbyte)rgnCount, sizeof(rgnCount));
+  for (isym = 0; isym < csym; isym++)
+    rgnCount[rgLen[isym]]++;
+  rgnCount[0] = 0;
+  nCode = 0;
+  for (n = 1; n <= cbCodeMax; n++) {
+    nCode = (nCode + rgnCount[n-1]) << 1;
+    rgnNext[n] = nCode;
+  }
+  for (isym = 0; isym < csym; isym++) {
+    n = rgLen[isym];
+    if (n == 0)
+      continue;
+    nCode = rgnNext[n]++;
+    nRev = 0;
+    for (i = 0; i < n; i++)
+      nRev = (nRev << 1) | ((nCode >> i) & 1);
+    rgCode[isym] = nRev;
+  }
+}
+
+
+// Return the length code (from 0 to 28) of a match length, and the distance
+// code (from 0 to 29) of a match distance.
+
+int ILenCode(int cch)
+{
+  int i;
+
+  for (i = 28; rgnLenBase[i] > cch; i--)
+    ;
+  return i;
+}
+
+int IDistCode(int dist)
+{
+  int i;
+
+  for (i = cDistDef-1; rgnDistBase[i] > dist; i--)
+    ;
+  return i;
+}
+
+
+// Output the symbols gathered so far as one block of a DEFLATE stream, using
+// Huffman codes computed for them, or stored as is if that would be smaller.
+
+void FlushDeflateBlock(DFS *pdfs, int ibEnd, flag fFinal)
+{
+  int rgnLit[cLitDef], rgnDist[cDistDef], rgnCL[19], rgnRun[cLitDef+cDistDef],
+    rgnRunX[cLitDef+cDistDef], cLit, cDist, cCL, cRun, isym, i, j, n, cb;
+  byte rgLen[cLitDef+cDistDef], rgLenCL[19];
+  word rgCodeLit[cLitDef], rgCodeDist[cDistDef], rgCodeCL[19];
+  long lBits, lBitsStored;
+
+  // Count how often each symbol occurs, and compute codes for them.
+  ClearB((pbyte)rgnLit, sizeof(rgnLit));
+  ClearB((pbyte)rgnDist, sizeof(rgnDist));
+  for (isym = 0; isym < pdfs->csym; isym++) {
+    if (pdfs->rgwDist[isym] == 0)
+      rgnLit[pdfs->rgwLen[isym]]++;
+    else {
+      rgnLit[257 + ILenCode(pdfs->rgwLen[isym])]++;
+      rgnDist[IDistCode(pdfs->rgwDist[isym])]++;
+    }
+  }
+  rgnLit[256] = 1;
+  ComputeHuffLen(rgnLit, cLitDef, cbCodeMax, rgLen);
+  ComputeHuffLen(rgnDist, cDistDef, cbCodeMax, rgLen + cLitDef);
+  for (cLit = cLitDef; rgLen[cLit-1] == 0; cLit--)
+    ;
+  for (cDist = cDistDef; rgLen[cLitDef + cDist-1] == 0; cDist--)
+    ;
+  ComputeHuffCode(rgLen, cLitDef, rgCodeLit);
+  ComputeHuffCode(rgLen + cLitDef, cDistDef, rgCodeDist);
+
+  // Run length encode the code lengths, which are output before the data.
+  if (cLit < cLitDef)
+    CopyRgb(rgLen + cLitDef, rgLen + cLit, cDist);
+  ClearB((pbyte)rgnCL, sizeof(rgnCL));
+  cRun = 0;
+  for (i = 0; i < cLit + cDist; i = j) {
+    n = rgLen[i];
+    for (j = i+1; j < cLit + cDist && rgLen[j] == n; j++)
+      ;
+    j = Min(j, i + (n == 0 ? 138 : 7));
+    if (n == 0 && j - i >= 3) {
+      rgnRun[cRun] = j - i >= 11 ? 18 : 17;
+      rgnRunX[cRun++] = j - i;
+    } else if (n > 0 && j - i >= 4) {
+      rgnRun[cRun] = n; rgnRunX[cRun++] = 0;
+      rgnCL[n]++;
+      rgnRun[cRun] = 16; rgnRunX[cRun++] = j - i - 1;
+    } else {
+      j = i+1;
+      rgnRun[cRun] = n; rgnRunX[cRun++] = 0;
+    }
+    rgnCL[rgnRun[cRun-1]]++;
+  }
+  ComputeHuffLen(rgnCL, 19, 7, rgLenCL);
+  ComputeHuffCode(rgLenCL, 19, rgCodeCL);
+  for (cCL = 19; rgLenCL[rgnCodeOrder[cCL-1]] == 0; cCL--)
+    ;
+  cCL = Max(cCL, 4);
+
+  // Compare number of bits needed with Huffman codes, to storing as is.
+  lBits = 3 + 14 + cCL*3;
+  for (i = 0; i < cRun; i++)
+    lBits += rgLenCL[rgnRun[i]] + (rgnRun[i] == 16 ? 2 :
+      (rgnRun[i] == 17 ? 3 : (rgnRun[i] == 18 ? 7 : 0)));
+  for (isym = 0; isym < cLitDef; isym++) {
+    if (rgnLit[isym] > 0)
+      lBits += (long)rgnLit[isym] * (rgLen[isym] +
+        (isym > 256 ? rgnLenExtra[isym - 257] : 0));
+  }
+  for (isym = 0; isym < cDistDef; isym++)
+    lBits += (long)rgnDist[isym] * (rgLen[cLit + isym] + rgnDistExtra[isym]);
+  cb = ibEnd - pdfs->ibBlock;
+  lBitsStored = ((long)cb + (cb / pdfs->cbStored + 1) * 5) * 8 + 7;
+
+  if (pdfs->nLevel <= 0 || lBits >= lBitsStored) {
+    // Output the data as is, in stored blocks of at most 64K each.
+    while (cb >= 0) {
+      n = Min(cb, pdfs->cbStored);
+      PutDeflateBits(pdfs, fFinal && n == cb, 1);
+      PutDeflateBits(pdfs, 0, 2);
+      if (pdfs->cBits > 0)
+        PutDeflateBits(pdfs, 0, 8 - pdfs->cBits);
+      PutDeflateBits(pdfs, n, 16);
+      PutDeflateBits(pdfs, ~n & 0xffff, 16);
+      CopyRgb((pbyte)pdfs->pbIn + pdfs->ibBlock, pdfs->pbOut + pdfs->ibOut,
+        n);
+      pdfs->ibOut += n;
+      pdfs->ibBlock += n;
+      cb -= n;
+      if (cb == 0)
+        break;
+    }
+  } else {
+    // Output the block header, followed by code lengths.
+    PutDeflateBits(pdfs, fFinal, 1);
+    PutDeflateBits(pdfs, 2, 2);
+    PutDeflateBits(pdfs, cLit - 257, 5);
+    PutDeflateBits(pdfs, cDist - 1, 5);
+    PutDeflateBits(pdfs, cCL - 4, 4);
+    for (i = 0; i < cCL; i++)
+      PutDeflateBits(pdfs, rgLenCL[rgnCodeOrder[i]], 3);
+    for (i = 0; i < cRun; i++) {
+      n = rgnRun[i];
+      PutDeflateBits(pdfs, rgCodeCL[n], rgLenCL[n]);
+      if (n == 16)
+        PutDeflateBits(pdfs, rgnRunX[i] - 3, 2);
+      else if (n == 17)
+        PutDeflateBits(pdfs, rgnRunX[i] - 3, 3);
+      else if (n == 18)
+        PutDeflateBits(pdfs, rgnRunX[i] - 11, 7);
+    }
+
+    // Output the symbols themselves.
+    for (isym = 0; isym < pdfs->csym; isym++) {
+      n = pdfs->rgwLen[isym];
+      if (pdfs->rgwDist[isym] == 0) {
+        PutDeflateBits(pdfs, rgCodeLit[n], rgLen[n]);
+        continue;
+      }
+      i = ILenCode(n);
+      PutDeflateBits(pdfs, rgCodeLit[257 + i], rgLen[257 + i]);
+      PutDeflateBits(pdfs, n - rgnLenBase[i], rgnLenExtra[i]);
+      n = pdfs->rgwDist[isym];
+      i = IDistCode(n);
+      PutDeflateBits(pdfs, rgCodeDist[i], rgLen[cLit + i]);
+      PutDeflateBits(pdfs, n - rgnDistBase[i], rgnDistExtra[i]);
+    }
+    PutDeflateBits(pdfs, rgCodeLit[256], rgLen[256]);
+    pdfs->ibBlock = ibEnd;
+  }
+  pdfs->csym = 0;
+}
+
+
+// Return the length of the longest earlier match for the data at a position,
+// and the distance back to it, by following the chain of earlier positions
+// with the same first three bytes.
+
+int CchDeflateMatch(CONST DFS *pdfs, int ib, int *pdist)
+{
+  CONST byte *pb = pdfs->pbIn + ib, *pbT;
+  int ibT, ibPrev, cchMax, cchBest = 0, cChain, cch;
+
+  cchMax = Min(cchDefMax, pdfs->cbIn - ib);
+  if (cchMax < cchDefMin)
+    return 0;
+  cChain = rgnDefChain[pdfs->nLevel];
+  ibT = pdfs->rgHead[DefHash(pb)];
+  while (ibT >= 0 && ib - ibT <= cbDefWin && cChain-- > 0) {
+    pbT = pdfs->pbIn + ibT;
+    if (pbT[cchBest] == pb[cchBest] && pbT[0] == pb[0]) {
+      for (cch = 0; cch < cchMax && pbT[cch] == pb[cch]; cch++)
+        ;
+      if (cch > cchBest) {
+        cchBest = cch;
+        *pdist = ib - ibT;
+        if (cch >= rgnDefNice[pdfs->nLevel] || cch >= cchMax)
+          break;
+      }
+    }
+    ibPrev = pdfs->rgPrev[ibT & (cbDefWin-1)];
+    if (ibPrev >= ibT)  // Link has since been reused by a later position.
+      break;
+    ibT = ibPrev;
+  }
+  return cchBest >= cchDefMin ? cchBest : 0;
+}
+
+
+// Add a position to the chain of positions with the same first three bytes.
+
+void InsertDeflateHash(DFS *pdfs, int ib)
+{
+  int iHash;
+
+  if (ib + cchDefMin > pdfs->cbIn)
+    return;
+  iHash = DefHash(pdfs->pbIn + ib);
+  pdfs->rgPrev[ib & (cbDefWin-1)] = pdfs->rgHead[iHash];
+  pdfs->rgHead[iHash] = ib;
+}
+
+
+// Compress a buffer of data into a zlib format DEFLATE stream, as used in
+// PNG files, at the given compression level from 0 (none) to 9 (most). Any
+// stored blocks are split on boundaries of the given row size, so level 0
+// is the same as the uncompressed files written before. The stream is
+// returned in an allocated buffer which the caller must free.
+
+flag FDeflateRgb(CONST byte *pbIn, int cbIn, int cbRow, int nLevel,
+  byte **ppbOut, int *pcbOut)
+{
+  DFS dfs;
+  int ib, i, cch, dist, cchNext = -1, distNext = 0, cb;
+  dword s1 = 1, s2 = 0, dwAdler;
+
+  ClearB((pbyte)&dfs, sizeof(DFS));
+  dfs.pbIn = pbIn; dfs.cbIn = cbIn;
+  dfs.nLevel = nLevel = Min(Max(nLevel, 0), 9);
+  dfs.cbStored = FBetween(cbRow, 1, 65535) ? 65535 / cbRow * cbRow : 65535;
+  dfs.pbOut = RgAllocate(cbIn + (cbIn / (csymDef/2) + cbIn / dfs.cbStored +
+    2) * 5 + 16, byte, "PNG data");
+  if (nLevel > 0) {
+    dfs.rgHead = RgAllocate(cbDefHash, int, "PNG hash");
+    dfs.rgPrev = RgAllocate(cbDefWin, int, "PNG hash");
+    dfs.rgwLen = RgAllocate(csymDef, word, "PNG symbols");
+    dfs.rgwDist = RgAllocate(csymDef, word, "PNG symbols");
+  }
+  if (dfs.pbOut == NULL || (nLevel > 0 && (dfs.rgHead == NULL ||
+    dfs.rgPrev == NULL || dfs.rgwLen == NULL || dfs.rgwDist == NULL))) {
+    DeallocatePIf(dfs.pbOut);
+    DeallocatePIf(dfs.rgHead); DeallocatePIf(dfs.rgPrev);
+    DeallocatePIf(dfs.rgwLen); DeallocatePIf(dfs.rgwDist);
+    return fFalse;
+  }
+
+  // Zlib header, indicating the compression level.
+  dfs.pbOut[dfs.ibOut++] = 0x78;
+  dfs.pbOut[dfs.ibOut++] = nLevel <= 1 ? 0x01 : (nLevel <= 5 ? 0x5E :
+    (nLevel == 6 ? 0x9C : 0xDA));
+
+  if (nLevel <= 0) {
+    // No compression, so just output stored blocks.
+    FlushDeflateBlock(&dfs, cbIn, fTrue);
+  } else {
+    for (i = 0; i < cbDefHash; i++)
+      dfs.rgHead[i] = -1;
+    ib = 0;
+    while (ib < cbIn) {
+      if (dfs.csym >= csymDef)
+        FlushDeflateBlock(&dfs, ib, fFalse);
+      if (cchNext >= 0) {
+        cch = cchNext; dist = distNext;
+        cchNext = -1;
+      } else
+        cch = CchDeflateMatch(&dfs, ib, &dist);
+      InsertDeflateHash(&dfs, ib);
+
+      // At higher levels, output a byte instead of a match if there's a
+      // longer match starting at the next byte.
+      if (cch > 0 && nLevel >= 4 && cch < rgnDefNice[nLevel]) {
+        cchNext = CchDeflateMatch(&dfs, ib+1, &distNext);
+        if (cchNext > cch)
+          cch = 0;
+        else
+          cchNext = -1;
+      }
+      if (cch > 0) {
+        dfs.rgwLen[dfs.csym] = cch;
+        dfs.rgwDist[dfs.csym++] = dist;
+        for (i = 1; i < cch; i++)
+          InsertDeflateHash(&dfs, ib + i);
+        ib += cch;
+      } else {
+        dfs.rgwLen[dfs.csym] = pbIn[ib++];
+        dfs.rgwDist[dfs.csym++] = 0;
+      }
+    }
+    FlushDeflateBlock(&dfs, ib, fTrue);
+  }
+  if (dfs.cBits > 0)
+    PutDeflateBits(&dfs, 0, 8 - dfs.cBits);
+
+  // Adler-32 checksum of the uncompressed data. The sums are only reduced
+  // every 5552 bytes, which is as many as can be added without overflow.
+  for (ib = 0; ib < cbIn; ib += cb) {
+    cb = Min(cbIn - ib, 5552);
+    for (i = 0; i < cb; i++) {
+      s1 += pbIn[ib + i];
+      s2 += s1;
+    }
+    s1 %= 65521;
+    s2 %= 65521;
+  }
+  dwAdler = ((dword)s2 << 16) + s1;
+  dfs.pbOut[dfs.ibOut++] = (byte)(dwAdler >> 24);
+  dfs.pbOut[dfs.ibOut++] = (byte)(dwAdler >> 16);
+  dfs.pbOut[dfs.ibOut++] = (byte)(dwAdler >> 8);
+  dfs.pbOut[dfs.ibOut++] = (byte)dwAdler;
+
+  if (nLevel > 0) {
+    DeallocateP(dfs.rgHead); DeallocateP(dfs.rgPrev);
+    DeallocateP(dfs.rgwLen); DeallocateP(dfs.rgwDist);
+  }
+  *ppbOut = dfs.pbOut;
+  *pcbOut = dfs.ibOut;
+  return fTrue;
+}
+
+
+// Given one row of pixel bytes in a PNG image, and the row above it (or NULL
+// for the top row), pick the PNG filter which will compress best, and output
+// the filter type byte followed by the filtered row.
+
+void FilterPNGRow(CONST byte *pbRow, CONST byte *pbPrev, int cb, int cbPixel,
+  byte *pbOut)
+{
+  int rgnSum[5], nFilter, i, nA, nB, nC, nP, pA, pB, pC, n;
+
+  ClearB((pbyte)rgnSum, sizeof(rgnSum));
+  for (i = 0; i < cb; i++) {
+    nA = i >= cbPixel ? pbRow[i - cbPixel] : 0;
+    nB = pbPrev != NULL ? pbPrev[i] : 0;
+    nC = i >= cbPixel && pbPrev != NULL ? pbPrev[i - cbPixel] : 0;
+    nP = nA + nB - nC;
+    pA = NAbs(nP - nA); pB = NAbs(nP - nB); pC = NAbs(nP - nC);
+    nP = pA <= pB && pA <= pC ? nA : (pB <= pC ? nB : nC);
+    // Score each filter by the sum of its output as signed bytes.
+    rgnSum[0] += NAbs((signed char)pbRow[i]);
+    rgnSum[1] += NAbs((signed char)(pbRow[i] - nA));
+    rgnSum[2] += NAbs((signed char)(pbRow[i] - nB));
+    rgnSum[3] += NAbs((signed char)(pbRow[i] - ((nA + nB) >> 1)));
+    rgnSum[4] += NAbs((signed char)(pbRow[i] - nP));
+  }
+  nFilter = 0;
+  for (i = 1; i < 5; i++)
+    if (rgnSum[i] < rgnSum[nFilter])
+      nFilter = i;
+
+  *pbOut++ = nFilter;
+  for (i = 0; i < cb; i++) {
+    nA = i >= cbPixel ? pbRow[i - cbPixel] : 0;
+    nB = pbPrev != NULL ? pbPrev[i] : 0;
+    nC = i >= cbPixel && pbPrev != NULL ? pbPrev[i - cbPixel] : 0;
+    switch (nFilter) {
+    case 0: n = 0;                 break;
+    case 1: n = nA;                break;
+    case 2: n = nB;                break;
+    case 3: n = (nA + nB) >> 1;    break;
+    default:
+      nP = nA + nB - nC;
+      pA = NAbs(nP - nA); pB = NAbs(nP - nB); pC = NAbs(nP - nC);
+      n = pA <= pB && pA <= pC ? nA : (pB <= pC ? nB : nC);
+    }
+    pbOut[i] = (byte)(pbRow[i] - n);
+  }
+}
+
+
 #define LFlipB(l) ((((l) & 0xff) << 24) | (((l) & 0xff00) << 8) | \
   (((l) & 0xff0000) >> 8) | (((l) & 0xff000000) >> 24))
 
@@ -1150,10 +1888,10 @@ void WritePNGChunk(FILE *file, CONST char szType[5], byte *rgb, dword cb,
   dword dwT, crc, n;
 
   dwT = LFlipB(cb);
-  fwrite(&dwT, 1, 4, file);
-  fwrite(szType, 1, 4, file);
+  PutRgb(file, (pbyte)&dwT, 4);
+  PutRgb(file, (CONST byte *)szType, 4);
   if (cb > 0)
-    fwrite(rgb, 1, cb, file);
+    PutRgb(file, rgb, cb);
 
   // Compute CRC for this chunk.
   crc = 0xffffffffL;
@@ -1163,19 +1901,24 @@ void WritePNGChunk(FILE *file, CONST char szType[5], byte *rgb, dword cb,
     crc = rglCrc[(crc ^ rgb[n])    & 0xff] ^ (crc >> 8);
   crc ^= 0xffffffffL;
   crc = LFlipB(crc);
-  fwrite(&crc, 1, 4, file);
+  PutRgb(file, (pbyte)&crc, 4);
 }
 
 
-// Output a bitmap to file in Portable Network Graphics (PNG) format. Note
-// that the PNG file produced will not be compressed any.
+// Output a bitmap to file in Portable Network Graphics (PNG) format. If the
+// bitmap contains 256 or fewer colors, it's written as a 4 or 8 bit indexed
+// image with a color palette, otherwise each row of RGB values is passed
+// through a PNG filter. The image is then compressed with DEFLATE at the
+// level specified with -YXz (where 0 means no compression).
 
 flag WritePNG(CONST Bitmap *b, FILE *file)
 {
-  dword rglCrc[256], crc, dwT, dwAdler;
-  int n, k, ib = 0, x, y, s1 = 1, s2 = 0, i;
-  byte rgbHead[13], *rgb;
-  KV kv;
+  dword rglCrc[256], crc, dwT;
+  int n, k, x, y, cbRow, cbData, ckv;
+  byte rgbHead[13], rgbPal[256*3], *rgb, *rgbRow, *pbRow, *pbOut,
+    *rgbIndex = NULL, *pbIndex;
+  CONST byte *pbIn;
+  KV rgkv[256];
 
   // Initialize CRC table for chunk CRC's.
   for (n = 0; n < 256; n++) {
@@ -1187,71 +1930,79 @@ flag WritePNG(CONST Bitmap *b, FILE *file)
 
   // PNG signature
   CONST byte png_signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
-  fwrite(png_signature, 1, 8, file);
+  PutRgb(file, png_signature, 8);
 
   // IHDR chunk
   dwT = LFlipB(b->x);
   CopyRgb((pbyte)&dwT, rgbHead, 4);
   dwT = LFlipB(b->y);
   CopyRgb((pbyte)&dwT, rgbHead + 4, 4);
-  rgbHead[8]  = 8;  // Bit depth
-  rgbHead[9]  = 2;  // Color type: Truecolor (RGB)
+  ckv = CkvBmpPalette(b, rgkv, 256, &rgbIndex);
+  rgbHead[8]  = ckv <= 0 ? 8 : (ckv <= 16 ? 4 : 8);  // Bit depth
+  rgbHead[9]  = ckv <= 0 ? 2 : 3;  // Color type: Truecolor (RGB) or indexed
   rgbHead[10] = 0;  // Compression method
   rgbHead[11] = 0;  // Filter method
   rgbHead[12] = 0;  // Interlace method
   WritePNGChunk(file, "IHDR", rgbHead, 13, rglCrc);
 
-  // Deflate block (no compression)
-  int cbRow, cbDataBmp, cRowBlock, cBlock, iBlock, cbBlock;
-  cbRow = b->x*cbPixelK + 1;
-  cbDataBmp = cbRow * b->y;
-  cRowBlock = 65535 / cbRow;
-  cBlock = (b->y + (cRowBlock - 1)) / cRowBlock;
+  // PLTE chunk
+  if (ckv > 0) {
+    for (n = 0; n < ckv; n++) {
+      rgbPal[n*3]   = RgbR(rgkv[n]);
+      rgbPal[n*3+1] = RgbG(rgkv[n]);
+      rgbPal[n*3+2] = RgbB(rgkv[n]);
+    }
+    WritePNGChunk(file, "PLTE", rgbPal, ckv*3, rglCrc);
+  }
 
-  rgb = PAllocate(2 + 5*cBlock + cbDataBmp + 4,
-    "PNG data"); // zlib header + deflate + data + adler32
-  if (rgb == NULL)
+  // Fill out image data, with a filter type byte at the start of each row.
+  cbRow = ckv <= 0 ? b->x*cbPixelK : (b->x*rgbHead[8] + 7) >> 3;
+  rgb = RgAllocate((cbRow + 1) * b->y, byte, "PNG data");
+  rgbRow = RgAllocate(cbRow * 2, byte, "PNG row");
+  if (rgb == NULL || rgbRow == NULL) {
+    DeallocatePIf(rgb);
+    DeallocatePIf(rgbRow);
+    DeallocatePIf(rgbIndex);
     return fFalse;
-  rgb[ib++] = 0x78;  // Zlib header for no compression
-  rgb[ib++] = 0x01;
-
-  for (iBlock = 0; iBlock < cBlock; iBlock++) {
-    // Uncompressed deflate block
-    cbBlock = cbRow * ((iBlock+1)*cRowBlock <= b->y ? cRowBlock :
-      b->y - iBlock*cRowBlock);
-    rgb[ib++] = (iBlock >= cBlock-1);  // 0x1 for final block, no compression
-    rgb[ib++] = cbBlock & 0xff;
-    rgb[ib++] = (cbBlock >> 8) & 0xff;
-    rgb[ib++] = ~cbBlock & 0xff;
-    rgb[ib++] = (~cbBlock >> 8) & 0xff;
-
-    for (y = iBlock*cRowBlock; y < (iBlock+1)*cRowBlock && y < b->y; y++) {
-      rgb[ib++] = 0;
-      for (x = 0; x < b->x; x++) {
-        kv = BmpGetXY(b, x, y);
-        rgb[ib++] = RgbR(kv);
-        rgb[ib++] = RgbG(kv);
-        rgb[ib++] = RgbB(kv);
+  }
+  for (y = 0; y < b->y; y++) {
+    pbRow = pbOut = rgbRow + (y & 1)*cbRow;
+    pbIndex = ckv > 0 ? rgbIndex + y*b->x : NULL;
+    if (ckv > 16)
+      CopyRgb(pbIndex, pbOut, b->x);
+    else if (ckv > 0) {
+      for (x = 0; x < b->x; x += 2)
+        *pbOut++ = (pbIndex[x] << 4) | (x+1 < b->x ? pbIndex[x+1] : 0);
+    } else {
+      // Convert row of BGR pixels in memory to the RGB order PNG uses.
+      pbIn = _PbXY(b, 0, y);
+      for (x = 0; x < b->x; x++, pbIn += cbPixelK) {
+        *pbOut++ = pbIn[2];
+        *pbOut++ = pbIn[1];
+        *pbOut++ = pbIn[0];
       }
     }
-    // Compute Adler-32 checksum for this block
-    for (i = 0; i < cbBlock; i++) {
-      s1 = (s1 + rgb[ib - cbBlock + i]) % 65521;
-      s2 = (s2 + s1) % 65521;
-    }
+    // Indexed images compress best without filtering.
+    pbOut = rgb + (cbRow + 1)*y;
+    if (gs.nPngLevel <= 0 || ckv > 0) {
+      *pbOut = 0;
+      CopyRgb(pbRow, pbOut + 1, cbRow);
+    } else
+      FilterPNGRow(pbRow, y <= 0 ? NULL : rgbRow + (~y & 1)*cbRow, cbRow,
+        cbPixelK, pbOut);
   }
-
-  // Output Adler-32 checksum
-  dwAdler = (s2 << 16) + s1;
-  rgb[ib++] = (dwAdler >> 24) & 0xff;
-  rgb[ib++] = (dwAdler >> 16) & 0xff;
-  rgb[ib++] = (dwAdler >> 8) & 0xff;
-  rgb[ib++] = dwAdler & 0xff;
-  Assert(ib == 2 + 5*cBlock + cbDataBmp + 4);
+  DeallocateP(rgbRow);
+  DeallocatePIf(rgbIndex);
 
   // IDAT chunk
-  WritePNGChunk(file, "IDAT", rgb, ib, rglCrc);
+  if (!FDeflateRgb(rgb, (cbRow + 1) * b->y, cbRow + 1, gs.nPngLevel, &pbOut,
+    &cbData)) {
+    DeallocateP(rgb);
+    return fFalse;
+  }
   DeallocateP(rgb);
+  WritePNGChunk(file, "IDAT", pbOut, cbData, rglCrc);
+  DeallocateP(pbOut);
 
   // IEND chunk
   WritePNGChunk(file, "IEND", NULL, 0, rglCrc);
@@ -1373,6 +2124,7 @@ void EndFileX()
     WriteWire(gi.file);
   }
 #endif
+  FlushOutBuf(gi.file);
   fclose(gi.file);
 #ifdef WIN
   if (wi.fAutoSave && wi.hMutex != NULL)
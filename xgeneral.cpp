@@ -2065,9 +2065,6 @@ int KiCity(int iae)
   KI ki = kOrangeB;
   int i;
   CI ci;
-#ifdef WIN
-  flag fSav;
-#endif
 
   if (!FEnsureAtlas())
     return fFalse;
@@ -2081,16 +2078,10 @@ int KiCity(int iae)
           return ~0;
       }
       ci = ciMain;
-#ifdef WIN
-      fSav = wi.fNoPopup; wi.fNoPopup = fTrue;
-#endif
       for (i = 0; i < iznMax; i++) {
-        DisplayTimezoneChanges(i, 0, &ci);
+        FZoneDstFromIzn(&ci, i, fFalse);
         is.rgzonCol[i] = ci.zon - ci.dst;
       }
-#ifdef WIN
-      wi.fNoPopup = fSav;
-#endif
     }
     return ki;
   }
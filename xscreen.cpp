@@ -2043,6 +2043,16 @@ int NProcessSwitchesRareX(int argc, char **argv, int pos,
     darg++;
     break;
 
+  case 'z':
+    if (FErrorArgc("YXz", argc, 1))
+      return tcError;
+    i = NFromSz(argv[1]);
+    if (FErrorValN("YXz", !FBetween(i, 0, 9), i, 0))
+      return tcError;
+    gs.nPngLevel = i;
+    darg++;
+    break;
+
 #ifdef SWISS
   case 'U':
     if (ch1 != '1') {